@@ -0,0 +1,51 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "benchutils.h"
+#include "anytimeoptimization.h"
+
+// quality against budget: how far above the converged optimum the returned speed is and how far off it lands
+void benchAnytimeCase(const char *label, const AnytimeResult &r, double optimum)
+{
+    std::cout << "    " << label << ": " << r.seconds * 1e3 << "ms, " << r.evaluations << " ground angles, ";
+    if (!r.found)
+    {
+        std::cout << "nothing landed yet" << std::endl;
+        return;
+    }
+    std::cout << "speed " << r.best[0] << "m/s (" << std::showpos << r.best[0] - optimum << std::noshowpos << "), landing error " << r.error << "m at step " << r.stepSize << "s"
+              << (r.converged ? ", converged" : "") << std::endl;
+}
+
+void runAnytimeBenchmarks()
+{
+    for (const Geometry &g : benchmarkGeometries())
+    {
+        const Vector3<double> initialPos = surfacePoint(g.lat1, g.lon1);
+        const Vector3<double> finalPos = surfacePoint(g.lat2, g.lon2);
+        auto run = [&](const OptimizationBudget &budget)
+        {
+            SilenceCout silence;
+            return optimizeTrajectoryAnytime(initialPos, finalPos, 1.0, budget);
+        };
+        const AnytimeResult full = run(OptimizationBudget());
+        const double optimum = full.best[0];
+        std::cout << "  " << g.name << std::endl;
+        for (double ms : {10.0, 20.0, 50.0, 100.0, 200.0, 500.0, 1000.0, 2000.0})
+        {
+            OptimizationBudget budget;
+            budget.seconds = ms / 1e3;
+            const std::string label = "budget " + std::to_string((int)ms) + "ms";
+            benchAnytimeCase(label.c_str(), run(budget), optimum);
+        }
+        for (int evaluations : {1, 4, 16, 24})
+        {
+            OptimizationBudget budget;
+            budget.evaluations = evaluations;
+            const std::string label = "budget " + std::to_string(evaluations) + " ground angles";
+            benchAnytimeCase(label.c_str(), run(budget), optimum);
+        }
+        benchAnytimeCase("no budget", full, optimum);
+    }
+}
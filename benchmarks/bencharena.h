@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "benchutils.h"
+#include "arena.h"
+#include "physics.h"
+
+// matrix temporaries from the heap against the thread arena, on one thread and on every core (where a shared
+// allocator would be contended), then a whole flight
+void runArenaBenchmarks()
+{
+    const int iterations = 200000;
+
+    // a typical step's worth of small-matrix expressions
+    auto work = [&](bool arena)
+    {
+        Matrix<double> y(1, 6), sum(1, 6);
+        for (int i = 0; i < 6; i++)
+            y(0, i) = i + 1;
+        for (int it = 0; it < iterations; it++)
+        {
+            if (arena)
+            {
+                ArenaScope scope;
+                sum = sum + (y * 0.5 + y * 0.25) * 1e-6;
+            }
+            else
+                sum = sum + (y * 0.5 + y * 0.25) * 1e-6;
+        }
+        return sum(0, 0);
+    };
+
+    const int threads = std::max(1u, std::thread::hardware_concurrency());
+    for (bool arena : {false, true})
+    {
+        const long long before = matrixHeapAllocations();
+        Stopwatch single;
+        double sink = work(arena);
+        const double singleSeconds = single.seconds();
+        const long long allocations = matrixHeapAllocations() - before;
+
+        std::vector<std::thread> workers;
+        Stopwatch parallel;
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([&]() { work(arena); });
+        for (std::thread &w : workers)
+            w.join();
+        const double parallelSeconds = parallel.seconds();
+
+        std::cout << "  " << (arena ? "arena" : "heap ") << ": " << 1e9 * singleSeconds / iterations << "ns per expression, "
+                  << allocations << " heap allocations, " << threads << " threads "
+                  << 1e9 * parallelSeconds / ((double)iterations * threads) << "ns per expression"
+                  << (sink == 0 ? " " : "") << std::endl;
+    }
+
+    const double lat = 0.5;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    const long long before = matrixHeapAllocations();
+    Stopwatch flight;
+    RK4Solution<double> sol = getFinalPosition<RK4>(pos, v, 1e-3);
+    const double seconds = flight.seconds();
+    std::cout << "  RK4 flight: " << sol.steps / seconds / 1e6 << "M steps/s, " << matrixHeapAllocations() - before
+              << " heap allocations for " << sol.steps << " steps" << std::endl;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include "benchutils.h"
+#include "asyncsolve.h"
+
+// how long a running solve takes to stop once cancelled, over a few cancellation points
+void benchCancelLatency(const Geometry &g)
+{
+    const Vector3<double> initialPos = surfacePoint(g.lat1, g.lon1);
+    const Vector3<double> finalPos = surfacePoint(g.lat2, g.lon2);
+    double worst = 0, total = 0;
+    const int trials = 5;
+    {
+        SilenceCout silence;
+        SolveExecutor executor(1);
+        for (int i = 0; i < trials; i++)
+        {
+            SolveHandle<Vector3<double>> handle = optimizeTrajectoryAsync(executor, initialPos, finalPos, 1.0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(50 + 70 * i));
+            Stopwatch watch;
+            handle.cancel();
+            handle.wait();
+            const double latency = watch.seconds();
+            worst = std::max(worst, latency);
+            total += latency;
+        }
+    }
+    std::cout << "    cancel latency: mean " << total / trials * 1e3 << "ms, worst " << worst * 1e3 << "ms" << std::endl;
+}
+
+// a service that gets a new request for the same launch before the old ones finished: without cancellation every
+// superseded solve still runs to the end ahead of the one that matters
+void benchSupersededSolves(const Geometry &g, int requests)
+{
+    const Vector3<double> initialPos = surfacePoint(g.lat1, g.lon1);
+    const Vector3<double> finalPos = surfacePoint(g.lat2, g.lon2);
+    for (bool cancel : {false, true})
+    {
+        double elapsed;
+        {
+            SilenceCout silence;
+            SolveExecutor executor(1);
+            std::vector<SolveHandle<Vector3<double>>> handles;
+            Stopwatch watch;
+            for (int i = 0; i < requests; i++)
+            {
+                if (cancel and !handles.empty())
+                    handles.back().cancel();
+                handles.push_back(optimizeTrajectoryAsync(executor, initialPos, finalPos, 1.0));
+            }
+            handles.back().wait();
+            elapsed = watch.seconds();
+        }
+        std::cout << "    " << requests << " requests, " << (cancel ? "superseded ones cancelled" : "all run                  ") << ": latest answered after " << elapsed << "s"
+                  << std::endl;
+    }
+}
+
+void runAsyncBenchmarks()
+{
+    const Geometry g = benchmarkGeometries()[0];
+    std::cout << "  " << g.name << std::endl;
+    benchCancelLatency(g);
+    benchSupersededSolves(g, 4);
+}
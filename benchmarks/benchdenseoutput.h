@@ -0,0 +1,48 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include "benchutils.h"
+#include "physics.h"
+#include "denseoutput.h"
+
+// state queries on a finished flight: one at a time (bisection), sorted batches (knot walk), apogee search
+void runDenseOutputBenchmarks()
+{
+    const double lat = 0.5, stepSize = 1e-2;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+
+    DenseTrajectory<double> flight;
+    Stopwatch integrate;
+    getFinalPosition<RK4, double>(pos, v, stepSize, RK4Constants::MAX_FLIGHT_TIME, flight);
+    const double integrateSeconds = integrate.seconds();
+
+    const int queries = 1000000;
+    std::vector<double> sorted(queries), shuffled(queries), out;
+    for (int i = 0; i < queries; i++)
+    {
+        sorted[i] = flight.endTime() * i / queries;
+        shuffled[i] = flight.endTime() * ((i * 7919LL) % queries) / queries;
+    }
+    double sink = 0, y[6];
+    Stopwatch single;
+    for (double t : shuffled)
+    {
+        flight.state(t, y);
+        sink += y[0];
+    }
+    const double singleSeconds = single.seconds();
+    Stopwatch batch;
+    flight.states(sorted, out);
+    const double batchSeconds = batch.seconds();
+    Stopwatch apogee;
+    Apogee<double> top = findApogee(flight);
+    const double apogeeSeconds = apogee.seconds();
+
+    std::cout << "  " << flight.size() << " knots (" << flight.endTime() << "s flight, integrated in " << 1e3 * integrateSeconds << "ms)" << std::endl;
+    std::cout << "  random queries: " << 1e9 * singleSeconds / queries << "ns each, sorted batch: " << 1e9 * batchSeconds / queries << "ns each"
+              << (sink == 0 ? " " : "") << std::endl;
+    std::cout << "  apogee " << top.altitude / 1e3 << "km at " << top.time << "s found in " << 1e6 * apogeeSeconds << "us" << std::endl;
+}
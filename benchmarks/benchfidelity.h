@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+#include "benchutils.h"
+#include "benchprecision.h"
+#include "trajectoryoptimization.h"
+
+void runFidelityBenchmarks()
+{
+    TargetingOptions fixedStep, scheduled;
+    fixedStep.multiFidelity = false;
+    scheduled.multiFidelity = true;
+    for (const Geometry &g : benchmarkGeometries())
+    {
+        std::cout << "  " << g.name << std::endl;
+        benchTargetingCase("double, fixed step    ", g, getInputs<double>, fixedStep);
+        benchTargetingCase("double, multi-fidelity", g, getInputs<double>, scheduled);
+        benchTargetingCase("mixed, fixed step     ", g, getInputsMixedPrecision, fixedStep);
+        benchTargetingCase("mixed, multi-fidelity ", g, getInputsMixedPrecision, scheduled);
+    }
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <iostream>
+#include <cstdio>
+#include <thread>
+#include "benchutils.h"
+#include "footprint.h"
+
+void runFootprintBenchmarks()
+{
+    // 8 x 8 x 4 launches from the first benchmark site, sweeping up to escape speed
+    const Geometry g = benchmarkGeometries()[0];
+    FootprintGrid grid = {g.lat1, g.lon1, {500, 12000, 8}, {0, 315, 8}, {20, 80, 4}};
+    const char *path = "benchfootprint.bin";
+    const int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads : {1, hardware})
+    {
+        std::remove(path);
+        Stopwatch watch;
+        generateFootprint(path, grid, threads);
+        double seconds = watch.seconds();
+        std::cout << "  " << threads << " thread(s): " << grid.cells() << " cells, " << seconds << "s, "
+                  << grid.cells() / seconds << " cells/s" << std::endl;
+        if (hardware == 1)
+            break;
+    }
+    std::remove(path);
+}
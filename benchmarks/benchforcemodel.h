@@ -0,0 +1,74 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <functional>
+#include "benchutils.h"
+#include "forcemodel.h"
+
+// what each force term costs: derivative calls through std::function as the solvers make them, then whole flights,
+// the point mass model against gravitationalDerivatives
+void runForceModelBenchmarks()
+{
+    const int calls = 2000000;
+    Matrix<double> state(1, 6), derivatives(1, 6);
+    const double values[6] = {4.1e6, -2.3e6, 4.4e6, 1200, -300, 2500};
+    for (int i = 0; i < 6; i++)
+        state(0, i) = values[i];
+
+    // best of three runs, the differences between terms are a few nanoseconds
+    double baseline = 0;
+    auto time = [&](const std::string &name, const std::function<void(const Matrix<double> &, Matrix<double> &)> &f)
+    {
+        double sink = 0, ns = 1e300;
+        for (int run = 0; run < 3; run++)
+        {
+            Stopwatch watch;
+            for (int i = 0; i < calls; i++)
+            {
+                state(0, 0) = values[0] + i;
+                f(state, derivatives);
+                sink += derivatives(0, 3);
+            }
+            ns = std::min(ns, 1e9 * watch.seconds() / calls);
+        }
+        if (baseline == 0)
+            baseline = ns;
+        std::cout << "  " << name << ": " << ns << "ns per call (+" << ns - baseline << "ns)" << (sink == 0 ? " " : "") << std::endl;
+    };
+    ForceModel<double, PointMass> pointMass;
+    ForceModel<double, PointMass, J2> withJ2;
+    ForceModel<double, PointMass, ExponentialDrag> withDrag;
+    ForceModel<double, PointMass, J2, ExponentialDrag> everything;
+    pointMass.prepare();
+    withJ2.prepare();
+    withDrag.prepare();
+    everything.prepare();
+    time("gravitationalDerivatives", gravitationalDerivatives<double>);
+    time("PointMass", pointMass);
+    time("PointMass + J2", withJ2);
+    time("PointMass + ExponentialDrag", withDrag);
+    time("PointMass + J2 + ExponentialDrag", everything);
+
+    const double lat = 0.5, stepSize = 1e-3;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    Stopwatch plain;
+    const RK4Solution<double> reference = getFinalPosition<RK4>(pos, v, stepSize);
+    std::cout << "  flight, gravitationalDerivatives: " << 1e3 * plain.seconds() << "ms" << std::endl;
+    auto flight = [&](const std::string &name, auto model)
+    {
+        Stopwatch watch;
+        const RK4Solution<double> sol = getFinalPosition<RK4>(model, pos, v, stepSize);
+        const double seconds = watch.seconds();
+        const double shift = std::sqrt(std::pow(sol.solutions(0, 0) - reference.solutions(0, 0), 2) +
+                                       std::pow(sol.solutions(0, 1) - reference.solutions(0, 1), 2) +
+                                       std::pow(sol.solutions(0, 2) - reference.solutions(0, 2), 2));
+        std::cout << "  flight, " << name << ": " << 1e3 * seconds << "ms, impact moved " << shift / 1e3 << "km" << std::endl;
+    };
+    flight("PointMass", pointMass);
+    flight("PointMass + J2", withJ2);
+    flight("PointMass + ExponentialDrag", withDrag);
+    flight("PointMass + J2 + ExponentialDrag", everything);
+}
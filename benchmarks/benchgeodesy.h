@@ -0,0 +1,112 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include <algorithm>
+#include "benchutils.h"
+#include "linalg.h"
+#include "geodesy.h"
+
+// best of a few runs of a conversion over all the points, in millions of points per second
+template <typename Convert>
+double geodesyThroughput(std::size_t points, Convert convert)
+{
+    double best = 0;
+    for (int run = 0; run < 5; run++)
+    {
+        Stopwatch watch;
+        convert();
+        best = std::max(best, points / watch.seconds() / 1e6);
+    }
+    return best;
+}
+
+void benchGeodesyCase(const char *label, double scalar, double batch)
+{
+    std::cout << "  " << label << ": scalar " << scalar << "M points/s, batch " << batch << "M points/s (" << batch / scalar << "x)" << std::endl;
+}
+
+// the batch kernels against the same conversions one point at a time through Vector3 and the std functions
+void runGeodesyBenchmarks()
+{
+    const std::size_t n = 1 << 20;
+    std::mt19937 generator(13);
+    std::uniform_real_distribution<double> radius(Physics::EARTH_RADIUS, Physics::EARTH_RADIUS + 1e6), theta(-Math::pi, Math::pi), phi(0, Math::pi),
+        height(-1e3, 1e6);
+    std::vector<double> a(n), b(n), c(n), x(n), y(n), z(n), d(n), e(n), f(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        a[i] = radius(generator);
+        b[i] = theta(generator);
+        c[i] = phi(generator);
+    }
+
+    double scalar = geodesyThroughput(n, [&]
+                                      {
+                                          for (std::size_t i = 0; i < n; i++)
+                                          {
+                                              const Vector3<double> v = Vector3<double>::fromSpherical(a[i], b[i], c[i]);
+                                              x[i] = v[0];
+                                              y[i] = v[1];
+                                              z[i] = v[2];
+                                          } });
+    double batch = geodesyThroughput(n, [&]
+                                     { sphericalToCartesian(a.data(), b.data(), c.data(), x.data(), y.data(), z.data(), n); });
+    benchGeodesyCase("spherical to Cartesian", scalar, batch);
+
+    scalar = geodesyThroughput(n, [&]
+                               {
+                                   for (std::size_t i = 0; i < n; i++)
+                                   {
+                                       const Vector3<double> v(x[i], y[i], z[i]);
+                                       d[i] = v.r();
+                                       e[i] = v.theta();
+                                       f[i] = v.phi();
+                                   } });
+    batch = geodesyThroughput(n, [&]
+                              { cartesianToSpherical(x.data(), y.data(), z.data(), d.data(), e.data(), f.data(), n); });
+    benchGeodesyCase("Cartesian to spherical", scalar, batch);
+
+    // geodetic points: latitude, longitude, height
+    for (std::size_t i = 0; i < n; i++)
+    {
+        a[i] = Math::pi / 2 - c[i];
+        c[i] = height(generator);
+    }
+    const double A = GeodesyConstants::WGS84_A, F = GeodesyConstants::WGS84_F, B = A * (1 - F), E2 = F * (2 - F), EP2 = E2 / ((1 - F) * (1 - F));
+    scalar = geodesyThroughput(n, [&]
+                               {
+                                   for (std::size_t i = 0; i < n; i++)
+                                   {
+                                       const double sinLat = std::sin(a[i]), cosLat = std::cos(a[i]);
+                                       const double N = A / std::sqrt(1 - E2 * sinLat * sinLat);
+                                       x[i] = (N + c[i]) * cosLat * std::cos(b[i]);
+                                       y[i] = (N + c[i]) * cosLat * std::sin(b[i]);
+                                       z[i] = (N * (1 - E2) + c[i]) * sinLat;
+                                   } });
+    batch = geodesyThroughput(n, [&]
+                              { geodeticToEcef(a.data(), b.data(), c.data(), x.data(), y.data(), z.data(), n); });
+    benchGeodesyCase("geodetic to ECEF", scalar, batch);
+
+    // the scalar side is the same two step Bowring with the std functions, the usual way it is written
+    scalar = geodesyThroughput(n, [&]
+                               {
+                                   for (std::size_t i = 0; i < n; i++)
+                                   {
+                                       const double p = std::sqrt(x[i] * x[i] + y[i] * y[i]);
+                                       double beta = std::atan2(A * z[i], B * p), lat = 0;
+                                       for (int step = 0; step < 2; step++)
+                                       {
+                                           lat = std::atan2(z[i] + EP2 * B * std::pow(std::sin(beta), 3), p - E2 * A * std::pow(std::cos(beta), 3));
+                                           beta = std::atan((1 - F) * std::tan(lat));
+                                       }
+                                       const double sinLat = std::sin(lat);
+                                       d[i] = lat;
+                                       e[i] = std::atan2(y[i], x[i]);
+                                       f[i] = p * std::cos(lat) + z[i] * sinLat - A * std::sqrt(1 - E2 * sinLat * sinLat);
+                                   } });
+    batch = geodesyThroughput(n, [&]
+                              { ecefToGeodetic(x.data(), y.data(), z.data(), d.data(), e.data(), f.data(), n); });
+    benchGeodesyCase("ECEF to geodetic", scalar, batch);
+}
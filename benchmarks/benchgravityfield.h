@@ -0,0 +1,80 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <random>
+#include "benchutils.h"
+#include "gravityfield.h"
+
+// field evaluations per second by degree (order = degree, Kaula sized coefficients), against the point mass
+void runGravityFieldBenchmarks()
+{
+    const int points = 4096;
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    std::vector<double> positions;
+    while ((int)positions.size() < 3 * points)
+    {
+        const double x = uniform(generator), y = uniform(generator), z = uniform(generator), r = std::sqrt(x * x + y * y + z * z);
+        if (r < 0.1 or r > 1)
+            continue;
+        for (double c : {x, y, z})
+            positions.push_back(c / r * (Physics::EARTH_RADIUS + 1e5));
+    }
+
+    double sink = 0;
+    {
+        const double mu = GravityFieldConstants::MU;
+        const int rounds = 2000;
+        Stopwatch watch;
+        for (int round = 0; round < rounds; round++)
+            for (int p = 0; p < points; p++)
+            {
+                const double *q = &positions[3 * p];
+                const double r = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+                sink += -mu * q[0] / (r * r * r);
+            }
+        std::cout << "  point mass: " << rounds * points / watch.seconds() / 1e6 << "M evaluations/s" << std::endl;
+    }
+    for (int degree : {2, 8, 36, 70})
+    {
+        GravityField<double> field(degree, degree);
+        std::normal_distribution<double> normal(0, 1);
+        for (int n = 2; n <= degree; n++)
+            for (int m = 0; m <= n; m++)
+                field.setCoefficient(n, m, 1e-5 / (n * n) * normal(generator), 1e-5 / (n * n) * normal(generator));
+        const int rounds = std::max(2, 20000 / ((degree + 2) * (degree + 2)));
+        double a[3];
+        Stopwatch watch;
+        for (int round = 0; round < rounds; round++)
+            for (int p = 0; p < points; p++)
+            {
+                field.acceleration(positions[3 * p], positions[3 * p + 1], positions[3 * p + 2], a);
+                sink += a[0];
+            }
+        const double seconds = watch.seconds();
+        std::cout << "  degree " << degree << ": " << rounds * points / seconds / 1e3 << "k evaluations/s, "
+                  << 1e9 * seconds / (rounds * points) << "ns each" << (sink == 0 ? " " : "") << std::endl;
+    }
+
+    // a whole flight, the field's cost against the point mass at the same step
+    const double lat = 0.5, stepSize = 1e-2;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    Stopwatch plain;
+    const RK4Solution<double> reference = getFinalPosition<RK4>(pos, v, stepSize);
+    const double plainSeconds = plain.seconds();
+    for (int degree : {2, 8})
+    {
+        GravityField<double> field(degree, degree);
+        field.setCoefficient(2, 0, -GravityFieldConstants::J2 / std::sqrt(5.0), 0);
+        Stopwatch watch;
+        const RK4Solution<double> sol = getFinalPosition<RK4>(field, pos, v, stepSize);
+        const double shift = std::sqrt(std::pow(sol.solutions(0, 0) - reference.solutions(0, 0), 2) +
+                                       std::pow(sol.solutions(0, 1) - reference.solutions(0, 1), 2) +
+                                       std::pow(sol.solutions(0, 2) - reference.solutions(0, 2), 2));
+        std::cout << "  " << sol.steps << " step flight, degree " << degree << ": " << 1e3 * watch.seconds() << "ms (point mass "
+                  << 1e3 * plainSeconds << "ms), impact moved " << shift / 1e3 << "km" << std::endl;
+    }
+}
@@ -0,0 +1,109 @@
+#include <iostream>
+#include <string>
+#include "benchprecision.h"
+#include "benchfidelity.h"
+#include "benchoptimization.h"
+#include "benchstrategy.h"
+#include "benchfootprint.h"
+#include "benchmontecarlo.h"
+#include "benchrenderer.h"
+#include "benchtrajectoryfile.h"
+#include "benchdenseoutput.h"
+#include "benchobservers.h"
+#include "bencharena.h"
+#include "benchgravityfield.h"
+#include "benchforcemodel.h"
+#include "benchasync.h"
+#include "benchanytime.h"
+#include "benchgeodesy.h"
+
+// usage: benchmarks [name], runs every benchmark when no name is given
+int main(int argc, char **argv)
+{
+    std::string only = (argc > 1) ? argv[1] : "";
+
+    if (only.empty() or only == "precision")
+    {
+        std::cout << "Running precision benchmarks" << std::endl;
+        runPrecisionBenchmarks();
+    }
+    if (only.empty() or only == "fidelity")
+    {
+        std::cout << "Running fidelity benchmarks" << std::endl;
+        runFidelityBenchmarks();
+    }
+    if (only.empty() or only == "optimization")
+    {
+        std::cout << "Running optimization benchmarks" << std::endl;
+        runOptimizationBenchmarks();
+    }
+    if (only.empty() or only == "strategy")
+    {
+        std::cout << "Running strategy benchmarks" << std::endl;
+        runStrategyBenchmarks();
+    }
+    if (only.empty() or only == "footprint")
+    {
+        std::cout << "Running footprint benchmarks" << std::endl;
+        runFootprintBenchmarks();
+    }
+    if (only.empty() or only == "montecarlo")
+    {
+        std::cout << "Running Monte Carlo benchmarks" << std::endl;
+        runMonteCarloBenchmarks();
+    }
+    if (only.empty() or only == "renderer")
+    {
+        std::cout << "Running renderer benchmarks" << std::endl;
+        runRendererBenchmarks();
+        runLineBenchmarks();
+        runTiledRendererBenchmarks();
+        runFrameExportBenchmarks();
+    }
+    if (only.empty() or only == "trajectoryfile")
+    {
+        std::cout << "Running trajectory file benchmarks" << std::endl;
+        runTrajectoryFileBenchmarks();
+    }
+    if (only.empty() or only == "denseoutput")
+    {
+        std::cout << "Running dense output benchmarks" << std::endl;
+        runDenseOutputBenchmarks();
+    }
+    if (only.empty() or only == "observers")
+    {
+        std::cout << "Running observer benchmarks" << std::endl;
+        runObserverBenchmarks();
+    }
+    if (only.empty() or only == "arena")
+    {
+        std::cout << "Running arena benchmarks" << std::endl;
+        runArenaBenchmarks();
+    }
+    if (only.empty() or only == "gravity")
+    {
+        std::cout << "Running gravity field benchmarks" << std::endl;
+        runGravityFieldBenchmarks();
+    }
+    if (only.empty() or only == "forcemodel")
+    {
+        std::cout << "Running force model benchmarks" << std::endl;
+        runForceModelBenchmarks();
+    }
+    if (only.empty() or only == "async")
+    {
+        std::cout << "Running async solve benchmarks" << std::endl;
+        runAsyncBenchmarks();
+    }
+    if (only.empty() or only == "anytime")
+    {
+        std::cout << "Running anytime optimization benchmarks" << std::endl;
+        runAnytimeBenchmarks();
+    }
+    if (only.empty() or only == "geodesy")
+    {
+        std::cout << "Running geodesy benchmarks" << std::endl;
+        runGeodesyBenchmarks();
+    }
+    return 0;
+}
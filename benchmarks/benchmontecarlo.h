@@ -0,0 +1,32 @@
+#pragma once
+
+#include <iostream>
+#include <thread>
+#include "benchutils.h"
+#include "montecarlo.h"
+
+void runMonteCarloBenchmarks()
+{
+    MonteCarloInputs inputs;
+    inputs.latitude = 40;
+    inputs.longitude = 0;
+    inputs.speed = 1160;
+    inputs.eastAngle = 53;
+    inputs.groundAngle = 45;
+    inputs.speedError.spread = 5;
+    inputs.eastAngleError.spread = 0.2;
+    inputs.groundAngleError.spread = 0.2;
+
+    const long long samples = 2000;
+    const int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads : {1, hardware})
+    {
+        Stopwatch watch;
+        DispersionStats stats = runMonteCarlo(inputs, samples, 1, threads);
+        double seconds = watch.seconds();
+        std::cout << "  " << threads << " thread(s): " << samples << " samples, " << seconds << "s, " << samples / seconds
+                  << " samples/s, CEP " << stats.cep() << "m, ellipse " << stats.ellipseMajor() << "m x " << stats.ellipseMinor() << "m" << std::endl;
+        if (hardware == 1)
+            break;
+    }
+}
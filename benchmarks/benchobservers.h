@@ -0,0 +1,58 @@
+#pragma once
+
+#include <iostream>
+#include <functional>
+#include "benchutils.h"
+#include "physics.h"
+#include "observers.h"
+
+// cost of watching a solve: inlined observers against a type-erased one (std::function) doing the same work
+void runObserverBenchmarks()
+{
+    const double lat = 0.5, stepSize = 1e-3;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+
+    Stopwatch plain;
+    RK4Solution<double> sol = getFinalPosition<RK4>(pos, v, stepSize);
+    const double plainSeconds = plain.seconds();
+
+    ApogeeObserver<double> apogee;
+    auto speeds = makeMinMaxObserver<double>(stepSpeed<double>);
+    EnergyObserver<double> energy;
+    DecimatingRecorder<double> track(1000);
+    Stopwatch observed;
+    getFinalPosition<RK4, double>(pos, v, stepSize, RK4Constants::MAX_FLIGHT_TIME, apogee, speeds, energy, track);
+    const double observedSeconds = observed.seconds();
+
+    // the same quantities through a callback the compiler cannot see through
+    struct Hook
+    {
+        std::function<void(const SolverStep<double> &)> call;
+        void onStep(const SolverStep<double> &step)
+        {
+            call(step);
+        }
+    } hook;
+    double maxRadius = 0, maxSpeed = 0, minEnergy = 1e300;
+    long long calls = 0;
+    hook.call = [&](const SolverStep<double> &step)
+    {
+        const Matrix<double> &m = step.state;
+        const double r = std::sqrt(m(0, 0) * m(0, 0) + m(0, 1) * m(0, 1) + m(0, 2) * m(0, 2));
+        const double speed = std::sqrt(m(0, 3) * m(0, 3) + m(0, 4) * m(0, 4) + m(0, 5) * m(0, 5));
+        maxRadius = std::max(maxRadius, r);
+        maxSpeed = std::max(maxSpeed, speed);
+        minEnergy = std::min(minEnergy, speed * speed / 2 - Physics::G * Physics::EARTH_MASS / r);
+        calls++;
+    };
+    Stopwatch hooked;
+    getFinalPosition<RK4, double>(pos, v, stepSize, RK4Constants::MAX_FLIGHT_TIME, hook);
+    const double hookedSeconds = hooked.seconds();
+
+    std::cout << "  " << sol.steps << " steps: no observers " << 1e3 * plainSeconds << "ms, apogee + speed + energy + recorder "
+              << 1e3 * observedSeconds << "ms, std::function " << 1e3 * hookedSeconds << "ms" << std::endl;
+    std::cout << "  apogee " << apogee.altitude() / 1e3 << "km at " << apogee.time << "s, max speed " << speeds.max << "m/s, energy drift "
+              << energy.relativeDrift() << ", " << track.size() << " track points" << (calls == 0 or maxRadius == 0 or minEnergy == maxSpeed ? " " : "") << std::endl;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <iostream>
+#include "benchutils.h"
+#include "trajectoryoptimization.h"
+
+template <typename Optimize>
+void benchOptimizationCase(const char *label, const Geometry &g, Optimize optimize)
+{
+    Vector3<double> initialPos = surfacePoint(g.lat1, g.lon1);
+    Vector3<double> finalPos = surfacePoint(g.lat2, g.lon2);
+    TargetingStats stats;
+    Vector3<double> result;
+    Stopwatch watch;
+    {
+        SilenceCout silence;
+        result = optimize(initialPos, finalPos, 1.0, &stats);
+    }
+    const double elapsed = watch.seconds();
+    std::cout << "    " << label << ": " << stats.iterations << " iterations, " << stats.simulations << " simulations, " << stats.integrationSteps << " steps, " << elapsed << "s, "
+              << "speed " << result[0] << "m/s at ground angle " << result[2] << (stats.converged ? "" : " (not converged)") << std::endl;
+}
+
+void runOptimizationBenchmarks()
+{
+    for (const Geometry &g : benchmarkGeometries())
+    {
+        std::cout << "  " << g.name << std::endl;
+        TargetingOptions warm;
+        warm.continuation = true;
+        benchOptimizationCase("nested, cold starts    ", g, [](Vector3<double> a, Vector3<double> b, double m, TargetingStats *stats)
+                              { return optimizeTrajectory(a, b, m, stats); });
+        benchOptimizationCase("nested, continuation   ", g, [&](Vector3<double> a, Vector3<double> b, double m, TargetingStats *stats)
+                              { return optimizeTrajectory(a, b, m, stats, warm); });
+        benchOptimizationCase("joint (reduced SQP)    ", g, optimizeTrajectoryJoint);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <iostream>
+#include "benchutils.h"
+#include "trajectoryoptimization.h"
+
+double landingErrorMeters(const vAngle &input, double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos)
+{
+    // evaluates a (denormalized) solution at full double fidelity
+    Vector3<double> inertialV, finalSimulatedPos;
+    RK4Solution<double> sol(0, 0, 0, Matrix<double>(1, 1));
+    Matrix<double> m(2, 1), goal(2, 1);
+    goal(0, 0) = Math::pi / 2 - finalPos.phi();
+    goal(1, 0) = finalPos.theta();
+    Matrix<double> y = simulate(vAngle(input.v * Physics::NORM_VEL, input.eastAngle * Physics::NORM_DEG), groundAngle, initialPos, inertialV, sol, finalSimulatedPos, m);
+    return std::sqrt(squaredLocationError(y, goal)) * Physics::EARTH_RADIUS;
+}
+
+template <typename Solve>
+void benchTargetingCase(const char *label, const Geometry &g, Solve solve, const TargetingOptions &options = TargetingOptions())
+{
+    const double groundAngle = 45;
+    Vector3<double> initialPos = surfacePoint(g.lat1, g.lon1);
+    Vector3<double> finalPos = surfacePoint(g.lat2, g.lon2);
+    TargetingStats stats;
+    vAngle x(0, 0);
+    Stopwatch watch;
+    {
+        SilenceCout silence;
+        x = solve(groundAngle, initialPos, finalPos, options, &stats, nullptr);
+    }
+    const double elapsed = watch.seconds();
+    std::cout << "    " << label << ": " << stats.iterations << " iterations, " << stats.simulations << " simulations, " << stats.integrationSteps << " steps, "
+              << elapsed << "s, landing error " << landingErrorMeters(x, groundAngle, initialPos, finalPos) << "m" << std::endl;
+}
+
+void runPrecisionBenchmarks()
+{
+    // fixed steps, the fidelity schedule is measured separately
+    TargetingOptions fixedStep;
+    fixedStep.multiFidelity = false;
+    for (const Geometry &g : benchmarkGeometries())
+    {
+        std::cout << "  " << g.name << std::endl;
+        benchTargetingCase("double", g, getInputs<double>, fixedStep);
+        benchTargetingCase("float ", g, getInputs<float>, fixedStep);
+        benchTargetingCase("mixed ", g, getInputsMixedPrecision, fixedStep);
+    }
+}
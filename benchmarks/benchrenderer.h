@@ -0,0 +1,211 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <fstream>
+#include "benchutils.h"
+#include "renderer.h"
+#include "framewriter.h"
+
+// the line rasterizer used to test every pixel of each segment's bounding box, kept here to compare against
+inline void boundingBoxLine(std::vector<int> &data, int width, int height, double x1, double y1, double x2, double y2)
+{
+    for (int j = std::max(0, (int)std::floor(std::min(y1, y2)) - 1); j < std::min(height, (int)std::ceil(std::max(y1, y2)) + 1); j++)
+    {
+        for (int i = std::max(0, (int)std::floor(std::min(x1, x2)) - 1); i < std::min(width, (int)std::ceil(std::max(x1, x2)) + 1); i++)
+        {
+            const double frac = ((x2 - x1) * (i + 0.5 - x1) + (y2 - y1) * (j + 0.5 - y1)) / ((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+            if (frac < 0 or frac > 1)
+                continue;
+            const double closestx = x1 + frac * (x2 - x1);
+            const double closesty = y1 + frac * (y2 - y1);
+            const double dist2 = (closestx - i - 0.5) * (closestx - i - 0.5) + (closesty - j - 0.5) * (closesty - j - 0.5);
+            if (dist2 <= 0.25)
+                data[j * width + i] = 3;
+            else if (dist2 <= 0.75)
+                data[j * width + i] = 4;
+        }
+    }
+}
+
+// 100k point trajectories (an orbit-like spiral across the screen) drawn as one multiline
+void runLineBenchmarks()
+{
+    const int points = 100000;
+    for (int size : {200, 1000})
+    {
+        const int w = size, h = size / 2;
+        std::vector<double> x(points), y(points), rndt(points);
+        for (int i = 0; i < points; i++)
+        {
+            const double angle = 12 * Math::pi * i / points, radius = 0.45 * h * (0.3 + 0.7 * i / points);
+            x[i] = w / 2 + 2 * radius * std::cos(angle);
+            y[i] = h / 2 + radius * std::sin(angle);
+            rndt[i] = 10 + std::sin(angle);
+        }
+        RenderObject path = RenderObject::Multiline(w, h, x, y, rndt);
+        Canvas canvas(w, h);
+        Stopwatch dda;
+        path.draw(canvas);
+        const double ddaSeconds = dda.seconds();
+
+        std::vector<int> data(w * h, 0);
+        Stopwatch box;
+        for (int i = 1; i < points; i++)
+            boundingBoxLine(data, w, h, x[i - 1], y[i - 1], x[i], y[i]);
+        const double boxSeconds = box.seconds();
+
+        // a star of long segments, where bounding boxes are largest
+        std::vector<double> sx, sy, sr;
+        for (int i = 0; i < 200; i++)
+        {
+            sx.push_back(i % 2 ? w / 2 : w / 2 + 0.48 * w * std::cos(i * 0.1));
+            sy.push_back(i % 2 ? h / 2 : h / 2 + 0.48 * h * std::sin(i * 0.1));
+            sr.push_back(10);
+        }
+        RenderObject star = RenderObject::Multiline(w, h, sx, sy, sr);
+        Stopwatch starDda;
+        star.draw(canvas);
+        const double starDdaSeconds = starDda.seconds();
+        Stopwatch starBox;
+        for (int i = 1; i < 200; i++)
+            boundingBoxLine(data, w, h, sx[i - 1], sy[i - 1], sx[i], sy[i]);
+        const double starBoxSeconds = starBox.seconds();
+        long long covered = 0;
+        for (int d : data)
+            covered += d != 0;
+
+        std::cout << "  " << w << "x" << h << ": 100k point trajectory " << 1e3 * ddaSeconds << "ms (bounding box scan "
+                  << 1e3 * boxSeconds << "ms), 200 long segments " << 1e3 * starDdaSeconds << "ms (bounding box scan "
+                  << 1e3 * starBoxSeconds << "ms), " << covered << " pixels covered" << std::endl;
+    }
+}
+
+// trajectory style animation: a fixed planet and a path that grows by one point every frame
+// full redraws (what every frame used to cost) against differential frames
+void runRendererBenchmarks()
+{
+    const int w = 100, h = 50, frames = 200;
+    RenderObject planet = RenderObject::Sphere(w, h, 50, 45, 20, 100);
+    std::vector<double> x, y, rndt;
+    for (int i = 0; i < frames; i++)
+    {
+        const double angle = Math::pi * i / frames;
+        x.push_back(50 - 40 * std::cos(angle));
+        y.push_back(30 - 25 * std::sin(angle));
+        rndt.push_back(50);
+    }
+
+    for (bool differential : {false, true})
+    {
+        Renderer renderer(w, h);
+        size_t bytes = 0;
+        Stopwatch watch;
+        for (int i = 1; i < frames; i++)
+        {
+            std::vector<double> px(x.begin(), x.begin() + i + 1), py(y.begin(), y.begin() + i + 1), pr(rndt.begin(), rndt.begin() + i + 1);
+            RenderObject path = RenderObject::Multiline(w, h, px, py, pr);
+            renderer.addObjectToBuffer(&planet);
+            renderer.addObjectToBuffer(&path);
+            if (!differential)
+                renderer.invalidate();
+            bytes += renderer.composeFrame().size();
+        }
+        double seconds = watch.seconds();
+        std::cout << "  " << (differential ? "differential" : "full redraw ") << ": " << bytes / (frames - 1) << " bytes/frame, "
+                  << 1e3 * seconds / (frames - 1) << "ms/frame (compose only)" << std::endl;
+    }
+}
+
+// a large offscreen sized canvas (planet, long trajectory, grid of circles) drawn serially and in tiles
+void runTiledRendererBenchmarks()
+{
+    const int w = 1920, h = 1080, frames = 10;
+    RenderObject planet = RenderObject::Sphere(w, h, w / 2, h, 500, 1000);
+    std::vector<double> x, y, rndt;
+    for (int i = 0; i < 20000; i++)
+    {
+        x.push_back(w / 2 + 900 * std::cos(i * 3e-4) * std::cos(i * 1e-3));
+        y.push_back(h / 2 + 500 * std::sin(i * 3e-4));
+        rndt.push_back(100);
+    }
+    RenderObject path = RenderObject::Multiline(w, h, x, y, rndt);
+    RenderObject circles = RenderObject::Circle(w, h, 50, 50, 40, 50);
+    for (int i = 1; i < 60; i++)
+    {
+        RenderObject c = RenderObject::Circle(w, h, 50 + (i % 10) * 190, 50 + (i / 10) * 170, 40, 50 + i);
+        circles.merge(&c);
+    }
+
+    const int hardware = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads : {1, std::max(2, hardware)})
+    {
+        Renderer renderer(w, h);
+        renderer.setThreads(threads);
+        Stopwatch watch;
+        for (int f = 0; f < frames; f++)
+        {
+            renderer.addObjectToBuffer(&planet);
+            renderer.addObjectToBuffer(&circles);
+            renderer.addObjectToBuffer(&path);
+            renderer.composeFrame();
+        }
+        std::cout << "  " << w << "x" << h << ", " << threads << " thread(s)" << (threads > 1 ? " (tiled)" : " (serial)") << ": "
+                  << 1e3 * watch.seconds() / frames << "ms/frame" << std::endl;
+    }
+}
+
+// thousands of frames of a trajectory animation rendered offline, into memory and into frame files
+void runFrameExportBenchmarks()
+{
+    const int w = 320, h = 180, frames = 2000, trail = 300;
+    const char *path = "benchframes.bin";
+    RenderObject planet = RenderObject::Sphere(w, h, w / 2, h / 2, 60, 200);
+    std::vector<double> x, y, rndt;
+    for (int i = 0; i < frames + trail; i++)
+    {
+        const double angle = 2 * Math::pi * i / 700;
+        x.push_back(w / 2 + 140 * std::cos(angle));
+        y.push_back(h / 2 + 80 * std::sin(angle) * std::cos(angle * 0.3));
+        rndt.push_back(200 + 150 * std::sin(angle));
+    }
+
+    for (FrameFileFormat format : {FrameFileFormat::Packed, FrameFileFormat::PGM, FrameFileFormat::PPM})
+    {
+        for (int threads : {1, 0})
+        {
+            std::remove(path);
+            Renderer renderer(w, h);
+            renderer.setThreads(threads);
+            FramebufferTarget memory;
+            Stopwatch watch;
+            {
+                FrameFileWriter writer(path, format);
+                for (int f = 0; f < frames; f++)
+                {
+                    std::vector<double> px(x.begin() + f, x.begin() + f + trail), py(y.begin() + f, y.begin() + f + trail),
+                        pr(rndt.begin() + f, rndt.begin() + f + trail);
+                    RenderObject orbit = RenderObject::Multiline(w, h, px, py, pr);
+                    renderer.addObjectToBuffer(&planet);
+                    renderer.addObjectToBuffer(&orbit);
+                    const Framebuffer &frame = renderer.drawFrame();
+                    writer.present(frame);
+                    if (format == FrameFileFormat::Packed)
+                        memory.present(frame);
+                }
+            }
+            const double seconds = watch.seconds();
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            const double megabytes = file.tellg() / 1e6;
+            std::cout << "  " << w << "x" << h << ", " << frames << " frames, "
+                      << (format == FrameFileFormat::Packed ? "packed" : format == FrameFileFormat::PGM ? "PGM   " : "PPM   ")
+                      << (threads == 1 ? " (serial)" : " (tiled) ") << ": " << frames / seconds << " frames/s, "
+                      << megabytes / seconds << " MB/s (" << megabytes << " MB)" << std::endl;
+        }
+    }
+    std::remove(path);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <iostream>
+#include "benchutils.h"
+#include "benchprecision.h"
+#include "trajectoryoptimization.h"
+
+void runStrategyBenchmarks()
+{
+    const char *labels[] = {"newton ", "broyden", "lm     "};
+    const TargetingStrategy strategies[] = {TargetingStrategy::Newton, TargetingStrategy::Broyden, TargetingStrategy::LevenbergMarquardt};
+    for (const Geometry &g : benchmarkGeometries())
+    {
+        std::cout << "  " << g.name << std::endl;
+        for (int i = 0; i < 3; i++)
+        {
+            TargetingOptions options;
+            options.strategy = strategies[i];
+            benchTargetingCase(labels[i], g, getInputsMixedPrecision, options);
+        }
+    }
+}
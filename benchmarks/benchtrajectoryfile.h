@@ -0,0 +1,87 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <cstdio>
+#include <fstream>
+#include "benchutils.h"
+#include "trajectoryfile.h"
+
+// a flight recorded at millisecond resolution: compressed chunks against raw doubles, in size, write and decode speed
+void runTrajectoryFileBenchmarks()
+{
+    const char *path = "benchtrajectory.bin";
+    const char *rawPath = "benchtrajectory.raw";
+    const double lat = 0.5, stepSize = 1e-3;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+
+    // the states, kept in memory so both formats write the same thing
+    struct Keep
+    {
+        std::vector<double> samples;
+        void onStep(const SolverStep<double> &step)
+        {
+            samples.push_back(step.time);
+            for (int i = 0; i < 6; i++)
+                samples.push_back(step.state(0, i));
+        }
+    } keep;
+    getFinalPosition<RK4, double>(pos, v, stepSize, RK4Constants::MAX_FLIGHT_TIME, keep);
+    const std::vector<double> &samples = keep.samples;
+    const long long states = samples.size() / 7;
+    const double rawBytes = states * 7.0 * sizeof(double);
+
+    Stopwatch rawWrite;
+    {
+        std::ofstream raw(rawPath, std::ios::binary);
+        raw.write(reinterpret_cast<const char *>(samples.data()), samples.size() * sizeof(double));
+    }
+    const double rawWriteSeconds = rawWrite.seconds();
+    Stopwatch rawRead;
+    std::vector<double> back(samples.size());
+    {
+        std::ifstream raw(rawPath, std::ios::binary);
+        raw.read(reinterpret_cast<char *>(back.data()), back.size() * sizeof(double));
+    }
+    const double rawReadSeconds = rawRead.seconds();
+
+    Stopwatch write;
+    {
+        TrajectoryWriter writer(path);
+        for (long long k = 0; k < states; k++)
+            writer.append(samples[7 * k], &samples[7 * k + 1]);
+    }
+    const double writeSeconds = write.seconds();
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    const double bytes = (double)file.tellg();
+
+    TrajectoryReader reader(path);
+    std::vector<double> times, decoded;
+    Stopwatch decode;
+    for (int c = 0; c < reader.chunks(); c++)
+        reader.readChunk(c, times, decoded);
+    const double decodeSeconds = decode.seconds();
+    bool exact = (long long)times.size() == states;
+    for (long long k = 0; exact and k < states; k++)
+        exact = times[k] == samples[7 * k] and decoded[6 * k] == samples[7 * k + 1];
+
+    const int seeks = 1000;
+    double sink = 0;
+    Stopwatch seek;
+    for (int i = 0; i < seeks; i++)
+        sink += reader.stateAt(reader.endTime() * ((i * 7919) % seeks) / seeks)[0];
+    const double seekSeconds = seek.seconds();
+
+    std::cout << "  " << states << " states (" << states * stepSize << "s at 1ms), raw doubles " << rawBytes / 1e6 << " MB, compressed "
+              << bytes / 1e6 << " MB (" << rawBytes / bytes << "x)" << (exact ? "" : " MISMATCH") << std::endl;
+    std::cout << "  write: raw " << rawBytes / 1e6 / rawWriteSeconds << " MB/s, compressed " << rawBytes / 1e6 / writeSeconds
+              << " MB/s (of raw data)" << std::endl;
+    std::cout << "  read: raw " << rawBytes / 1e6 / rawReadSeconds << " MB/s, full decode " << rawBytes / 1e6 / decodeSeconds << " MB/s ("
+              << states / decodeSeconds / 1e6 << "M states/s)" << std::endl;
+    std::cout << "  random state lookup: " << 1e6 * seekSeconds / seeks << "us (decodes one " << TrajectoryFileConstants::CHUNK_STATES
+              << " state chunk)" << (sink == 0 ? " " : "") << std::endl;
+    std::remove(path);
+    std::remove(rawPath);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <iostream>
+#include <sstream>
+#include <chrono>
+#include <vector>
+#include "linalg.h"
+#include "constants.h"
+
+// wall clock in seconds since construction
+class Stopwatch
+{
+private:
+    std::chrono::steady_clock::time_point start;
+
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    double seconds() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// the solvers report progress on std::cout, this swallows it while alive
+class SilenceCout
+{
+private:
+    std::ostringstream sink;
+    std::streambuf *previous;
+
+public:
+    SilenceCout() : previous(std::cout.rdbuf(sink.rdbuf())) {}
+    ~SilenceCout()
+    {
+        std::cout.rdbuf(previous);
+    }
+};
+
+struct Geometry
+{
+    const char *name;
+    double lat1, lon1, lat2, lon2; // degrees
+};
+
+inline Vector3<double> surfacePoint(double lat, double lon)
+{
+    return Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, lon * Math::pi / 180, Math::pi / 2 - lat * Math::pi / 180);
+}
+
+// launch/target pairs used across benchmarks
+inline std::vector<Geometry> benchmarkGeometries()
+{
+    return {{"short (~140km)", 40, 0, 41, 1},
+            {"long (~780km)", 10, 10, 15, 15},
+            {"southern (~350km)", -20, 30, -17, 31}};
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "linalg.h"
+#include "rk4.h"
+#include "constants.h"
+
+// Adams-Bashforth-Moulton predictor-corrector integrator
+// same interface as RK4 so it can be dropped into getFinalPosition<ABM>
+// every step costs 2 derivative calls in PECE mode and 1 in PEC mode, against the 4 of RK4
+// variable order: it starts (and restarts) at order 1 with just the initial derivative and climbs to maxOrder as the
+// history fills, no single step methods needed
+template <typename T = double>
+class ABM
+{
+private:
+    T h;
+    int order; // the highest, reached once the history is full
+    bool evaluateCorrector; // PECE if true, PEC if false
+
+    // derivative history, newest first once accessed through past(j)
+    std::vector<Matrix<T>> history;
+    int newest = 0;
+    int stored = 0;
+
+    // coefficients (newest derivative first), index is order - 1
+    static constexpr double AB[4][4] = {{1.0, 0.0, 0.0, 0.0},
+                                        {3.0 / 2, -1.0 / 2, 0.0, 0.0},
+                                        {23.0 / 12, -16.0 / 12, 5.0 / 12, 0.0},
+                                        {55.0 / 24, -59.0 / 24, 37.0 / 24, -9.0 / 24}};
+    // first coefficient multiplies the predicted derivative f(n+1)
+    static constexpr double AM[4][4] = {{1.0, 0.0, 0.0, 0.0},
+                                        {1.0 / 2, 1.0 / 2, 0.0, 0.0},
+                                        {5.0 / 12, 8.0 / 12, -1.0 / 12, 0.0},
+                                        {9.0 / 24, 19.0 / 24, -5.0 / 24, 1.0 / 24}};
+    // Milne's device: local error of the corrector ~ MILNE * |corrected - predicted|
+    static constexpr double MILNE[4] = {1.0 / 2, 1.0 / 6, 1.0 / 10, 19.0 / 270};
+
+    Matrix<T> &past(int j)
+    {
+        return history[(newest - j + order) % order];
+    }
+
+    Matrix<T> &push()
+    {
+        // returns the slot for the next derivative
+        newest = (newest + 1) % order;
+        stored = std::min(stored + 1, order);
+        return history[newest];
+    }
+
+public:
+    ABM(T stepSize, int maxOrder = ABMConstants::MAX_ORDER, bool pece = true) : h(stepSize), order(maxOrder), evaluateCorrector(pece)
+    {
+        if (order < 1 or order > 4)
+            throw std::invalid_argument("ABM order must be between 1 and 4");
+    }
+
+    T getStepSize() const
+    {
+        return h;
+    }
+
+    // the multistep formulas assume equally spaced history, so a step change forces a restart
+    void setStepSize(T stepSize)
+    {
+        if (stepSize == h)
+            return;
+        h = stepSize;
+        restart();
+    }
+
+    // forgets every derivative but the newest one (which is still valid at the current state), back to order 1
+    void restart()
+    {
+        if (stored == 0)
+            return;
+        if (newest != 0)
+            history[0] = history[newest];
+        newest = 0;
+        stored = 1;
+    }
+
+    template <typename... Observers>
+    RK4Solution<T> solve(const Matrix<T> &initialConditions, const std::function<void(const Matrix<T> &, Matrix<T> &)> &derivatives, int maxSteps, const std::function<bool(Matrix<T>)> &endCondition,
+                         Observers &...observers)
+    {
+        // same contract as RK4::solve: derivatives must not depend on time explicitly
+        // when endCondition becomes true the last step is redone with a finer step (EVENT_REFINEMENTS times),
+        // so the event is located more precisely than the base step size allows
+        // observers (see SolverStep) see the accepted states only, with the derivative kept in the history
+        // cancellation as in RK4::solve
+        const int n = initialConditions.getCols();
+        const T baseStep = h;
+        Matrix<T> y(initialConditions), next(1, n), predicted(1, n), fp(1, n);
+
+        {
+            // the history outlives this call, so it must not come from whatever arena scope the caller has open
+            HeapScope heap;
+            history.assign(order, Matrix<T>(1, n));
+        }
+        newest = 0;
+        stored = 0;
+        derivatives(y, push());
+        if constexpr (sizeof...(Observers) > 0)
+        {
+            const SolverStep<T> accepted = {0, (T)0, y, past(0), maxSteps <= 0};
+            (observers.onStep(accepted), ...);
+        }
+
+        int step = 0;
+        int refinements = 0;
+        T t = 0.0;
+        T error = 0.0;
+        SolutionStatus status = SolutionStatus::MaxSteps;
+        const std::atomic<bool> *cancel = activeCancelFlag();
+        while (step < maxSteps)
+        {
+            if (cancel and cancel->load(std::memory_order_relaxed))
+            {
+                status = SolutionStatus::Cancelled;
+                break;
+            }
+            // the order grows with the history: the predictor uses every stored derivative, the corrector one more
+            // (the predicted f(n+1)), so the first step is Euler/trapezoid and maxOrder is reached after maxOrder - 1
+            const int predictorOrder = stored;
+            const int correctorOrder = std::min(stored + 1, order);
+            // predict
+            for (int i = 0; i < n; i++)
+            {
+                T sum = 0.0;
+                for (int j = 0; j < predictorOrder; j++)
+                    sum += (T)AB[predictorOrder - 1][j] * past(j)(0, i);
+                predicted(0, i) = y(0, i) + h * sum;
+            }
+            // evaluate
+            derivatives(predicted, fp);
+            // correct
+            T diff2 = 0.0;
+            for (int i = 0; i < n; i++)
+            {
+                T sum = (T)AM[correctorOrder - 1][0] * fp(0, i);
+                for (int j = 1; j < correctorOrder; j++)
+                    sum += (T)AM[correctorOrder - 1][j] * past(j - 1)(0, i);
+                next(0, i) = y(0, i) + h * sum;
+                diff2 += (next(0, i) - predicted(0, i)) * (next(0, i) - predicted(0, i));
+            }
+            error = std::max(error, (T)MILNE[predictorOrder - 1] * std::sqrt(diff2));
+
+            bool event;
+            {
+                // endCondition takes its state by value, that copy comes from the arena
+                ArenaScope temporaries;
+                event = endCondition(next);
+            }
+            if (event and refinements < ABMConstants::EVENT_REFINEMENTS)
+            {
+                // the event lies inside this step: stay at y and approach it again with a smaller step
+                setStepSize(h / (T)ABMConstants::EVENT_REFINEMENT_FACTOR);
+                refinements++;
+                continue;
+            }
+
+            // (evaluate) the derivative at the accepted state becomes history, PEC reuses the predicted one
+            if (!evaluateCorrector)
+                push() = fp;
+            else
+                derivatives(next, push());
+
+            y = next;
+            t += h;
+            if constexpr (sizeof...(Observers) > 0)
+            {
+                const SolverStep<T> accepted = {step + 1, t, y, past(0), event or step + 1 >= maxSteps};
+                (observers.onStep(accepted), ...);
+            }
+            if (event)
+            {
+                status = SolutionStatus::EndCondition;
+                break;
+            }
+            step++;
+        }
+
+        // leave the solver as it was built
+        h = baseStep;
+        RK4Solution<T> solution(step, baseStep, error, t, y);
+        solution.status = status;
+        return solution;
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cmath>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include "cancellation.h"
+#include "trajectoryoptimization.h"
+
+// optimizeTrajectory for callers with a latency budget: it can be stopped at any point and then returns the best
+// landing it has seen so far; the work is ordered so that a cheap answer comes first and only gets better:
+//   1. the ground angle search with float solves only (coarse and cheap, lands within ~200m)
+//   2. a mixed precision solve at the angle that search found, the first converged answer
+//   3. the full optimizeTrajectory, which then has the final say
+// landings are ranked: converged (full fidelity, within tolerance) before feasible (Physics::FEASIBLE_LANDING_ERROR)
+// before the rest; the first two by energy, the rest by landing error
+
+// how much an anytime optimization may spend, whichever runs out first; 0 for no limit
+struct OptimizationBudget
+{
+    double seconds = 0;  // wall time
+    int evaluations = 0; // ground angles solved
+};
+
+struct AnytimeResult
+{
+    bool found = false;                              // anything landed
+    Vector3<double> best = Vector3<double>(0, 0, 0); // speed (m/s), eastAngle (deg), groundAngle (deg) as optimizeTrajectory has them
+    double error = 0;                                // landing error of best (m)
+    double stepSize = 0;                             // of the simulation that measured it
+    double energy = 0;                               // m v^2 / 2
+    bool converged = false;                          // the full optimization finished within the budget and converged
+    int evaluations = 0;                             // ground angles solved
+    double seconds = 0;
+};
+
+// 0 converged, 1 feasible, 2 neither
+inline int landingRank(double error, double stepSize)
+{
+    if (stepSize == Precision<double>::STEP_SIZE and error <= std::sqrt(Precision<double>::LOCATION_TOLERANCE) * Physics::EARTH_RADIUS)
+        return 0;
+    return error <= Physics::FEASIBLE_LANDING_ERROR ? 1 : 2;
+}
+
+inline AnytimeResult optimizeTrajectoryAnytime(Vector3<double> initialPos, Vector3<double> finalPos, double m, const OptimizationBudget &budget,
+                                               const TargetingOptions &options = TargetingOptions(), TargetingStats *stats = nullptr)
+{
+    const auto start = std::chrono::steady_clock::now();
+    AnytimeResult result;
+    int rank = 3;
+    // the budget is enforced by cancelling the solves, at the deadline or once the last evaluation is done
+    CancelToken token;
+    std::unique_ptr<CancelAfter> deadline;
+    if (budget.seconds > 0)
+        deadline = std::make_unique<CancelAfter>(token, budget.seconds);
+
+    int finished = 0, phase = 0; // evaluations of the finished phases and of the current one
+    TargetingOptions observed = options;
+    observed.onProgress = [&](const TargetingProgress &progress)
+    {
+        const double energy = m * progress.current.v * progress.current.v / 2;
+        const int r = landingRank(progress.error, progress.stepSize);
+        if (r < rank or (r == rank and (r < 2 ? energy < result.energy : progress.error < result.error)))
+        {
+            rank = r;
+            result.found = true;
+            result.best = Vector3<double>(progress.current.v, progress.current.eastAngle, progress.groundAngle);
+            result.error = progress.error;
+            result.stepSize = progress.stepSize;
+            result.energy = energy;
+        }
+        phase = std::max(phase, progress.groundAngles);
+        result.evaluations = finished + phase;
+        if (budget.evaluations > 0 and result.evaluations >= budget.evaluations)
+            token.cancel();
+        if (options.onProgress)
+            options.onProgress(progress);
+    };
+    auto nextPhase = [&](int evaluations)
+    {
+        finished += std::max(phase, evaluations);
+        phase = 0;
+        result.evaluations = finished;
+        if (budget.evaluations > 0 and result.evaluations >= budget.evaluations)
+            token.cancel();
+    };
+
+    try
+    {
+        CancellationScope scope(token);
+        TargetingOptions coarse = observed;
+        coarse.floatOnly = true;
+        const Vector3<double> rough = optimizeTrajectory(initialPos, finalPos, m, stats, coarse);
+        nextPhase(0);
+
+        TargetingSeed seed;
+        seed.x = vAngle(rough[0] * Physics::NORM_VEL, rough[1] * Physics::NORM_DEG);
+        getInputsMixedPrecision(rough[2], initialPos, finalPos, observed, stats, &seed);
+        nextPhase(1);
+
+        TargetingStats last;
+        optimizeTrajectory(initialPos, finalPos, m, &last, observed);
+        result.converged = last.converged;
+        if (stats)
+        {
+            stats->iterations += last.iterations;
+            stats->simulations += last.simulations;
+            stats->integrationSteps += last.integrationSteps;
+            stats->solves += last.solves;
+            stats->converged = last.converged;
+        }
+    }
+    catch (const SolveCancelled &)
+    {
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
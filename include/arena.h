@@ -0,0 +1,156 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include "constants.h"
+
+// monotonic arena: hands out memory from large blocks and frees nothing, the whole of it goes back at once by
+// rewinding to an earlier mark; blocks are kept, so once warmed up an arena no longer touches the heap
+class MonotonicArena
+{
+private:
+    struct Block
+    {
+        std::unique_ptr<unsigned char[]> memory;
+        std::size_t size;
+    };
+    std::vector<Block> blocks;
+    std::size_t blockSize;
+    std::size_t current = 0; // block being filled
+    std::size_t used = 0;    // bytes used in it
+
+public:
+    struct Mark
+    {
+        std::size_t block, used;
+    };
+
+    MonotonicArena(std::size_t blockSize = ArenaConstants::BLOCK_SIZE) : blockSize(blockSize) {}
+
+    MonotonicArena(const MonotonicArena &) = delete;
+    MonotonicArena &operator=(const MonotonicArena &) = delete;
+
+    // alignment must be a power of two no larger than alignof(std::max_align_t)
+    void *allocate(std::size_t bytes, std::size_t alignment = alignof(std::max_align_t))
+    {
+        while (true)
+        {
+            if (current < blocks.size())
+            {
+                const std::size_t start = (used + alignment - 1) & ~(alignment - 1);
+                if (start + bytes <= blocks[current].size)
+                {
+                    used = start + bytes;
+                    return blocks[current].memory.get() + start;
+                }
+                if (current + 1 < blocks.size())
+                {
+                    current++;
+                    used = 0;
+                    continue;
+                }
+            }
+            const std::size_t size = std::max(blockSize, bytes);
+            blocks.push_back({std::unique_ptr<unsigned char[]>(new unsigned char[size]), size});
+            current = blocks.size() - 1;
+            used = 0;
+        }
+    }
+
+    Mark mark() const
+    {
+        return {current, used};
+    }
+
+    // everything allocated after m is given back
+    void rewind(const Mark &m)
+    {
+        current = m.block;
+        used = m.used;
+    }
+
+    void reset()
+    {
+        rewind({0, 0});
+    }
+
+    // bytes held from the heap
+    std::size_t capacity() const
+    {
+        std::size_t total = 0;
+        for (const Block &b : blocks)
+            total += b.size;
+        return total;
+    }
+};
+
+// the arena of the calling thread, threads never share one
+inline MonotonicArena &threadArena()
+{
+    thread_local MonotonicArena arena;
+    return arena;
+}
+
+// the arena new matrices of this thread are allocated in, nullptr for the heap
+inline MonotonicArena *&activeArena()
+{
+    thread_local MonotonicArena *arena = nullptr;
+    return arena;
+}
+
+// while alive, matrices created on this thread live in arena (the thread's own by default); when it ends they are all
+// given back at once, so none of them may outlive the scope (copy results into matrices created before it)
+// scopes nest: typically one per Newton iteration or integration step
+class ArenaScope
+{
+private:
+    MonotonicArena &arena;
+    MonotonicArena *previous;
+    MonotonicArena::Mark start;
+
+public:
+    ArenaScope(MonotonicArena &arena = threadArena()) : arena(arena), previous(activeArena()), start(arena.mark())
+    {
+        activeArena() = &arena;
+    }
+
+    ArenaScope(const ArenaScope &) = delete;
+    ArenaScope &operator=(const ArenaScope &) = delete;
+
+    ~ArenaScope()
+    {
+        arena.rewind(start);
+        activeArena() = previous;
+    }
+};
+
+// while alive, matrices created on this thread come from the heap whatever scope is around it, for the ones that have to
+// outlive that scope (solver members and the like)
+class HeapScope
+{
+private:
+    MonotonicArena *previous;
+
+public:
+    HeapScope() : previous(activeArena())
+    {
+        activeArena() = nullptr;
+    }
+
+    HeapScope(const HeapScope &) = delete;
+    HeapScope &operator=(const HeapScope &) = delete;
+
+    ~HeapScope()
+    {
+        activeArena() = previous;
+    }
+};
+
+// matrix buffers taken from the heap by this thread, to check that hot loops stay off it
+inline long long &matrixHeapAllocations()
+{
+    thread_local long long count = 0;
+    return count;
+}
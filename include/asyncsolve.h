@@ -0,0 +1,228 @@
+#pragma once
+
+#include <deque>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include <condition_variable>
+#include "cancellation.h"
+#include "trajectoryoptimization.h"
+
+// solves that run on a shared pool of threads and hand back a SolveHandle right away: the caller polls or is called
+// back with progress, waits for the result when it wants it, and can cancel at any time; a cancelled solve stops at
+// the next integration step (or never starts if it is still queued) and its get() throws SolveCancelled
+
+// fixed pool of worker threads taking tasks in the order they were posted
+class SolveExecutor
+{
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> queue;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+
+    void work()
+    {
+        while (true)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wakeUp.wait(lock, [&] { return stopping or !queue.empty(); });
+                if (queue.empty())
+                    return;
+                task = std::move(queue.front());
+                queue.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    // threads workers (0 -> hardware concurrency)
+    SolveExecutor(int threads = 0)
+    {
+        if (threads <= 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int t = 0; t < threads; t++)
+            workers.emplace_back([this] { work(); });
+    }
+
+    SolveExecutor(const SolveExecutor &) = delete;
+    SolveExecutor &operator=(const SolveExecutor &) = delete;
+
+    // runs what is still queued (cancelled solves finish at once) and joins the workers
+    ~SolveExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeUp.notify_all();
+        for (std::thread &w : workers)
+            w.join();
+    }
+
+    void post(std::function<void()> task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping)
+                throw std::runtime_error("SolveExecutor is shutting down");
+            queue.push_back(std::move(task));
+        }
+        wakeUp.notify_one();
+    }
+
+    int threads() const
+    {
+        return (int)workers.size();
+    }
+};
+
+// what a solve running on an executor shares with its handle
+struct SolveProgressState
+{
+    std::mutex mutex;
+    bool haveProgress = false;
+    TargetingProgress progress;
+    TargetingStats stats; // once finished
+};
+
+template <typename Result>
+class SolveHandle
+{
+private:
+    std::shared_future<Result> result;
+    CancelToken token;
+    std::shared_ptr<SolveProgressState> state;
+
+public:
+    SolveHandle(std::shared_future<Result> result, CancelToken token, std::shared_ptr<SolveProgressState> state)
+        : result(std::move(result)), token(std::move(token)), state(std::move(state)) {}
+
+    // returns at once, the solve stops at its next integration step
+    void cancel()
+    {
+        token.cancel();
+    }
+
+    bool cancelled() const
+    {
+        return token.cancelled();
+    }
+
+    bool ready() const
+    {
+        return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
+    void wait() const
+    {
+        result.wait();
+    }
+
+    template <typename Rep, typename Period>
+    bool waitFor(const std::chrono::duration<Rep, Period> &timeout) const
+    {
+        return result.wait_for(timeout) == std::future_status::ready;
+    }
+
+    // waits, then returns the result or throws what the solve threw (SolveCancelled if it was cancelled)
+    const Result &get() const
+    {
+        return result.get();
+    }
+
+    // the latest progress event, false before the first
+    bool progress(TargetingProgress &latest) const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        latest = state->progress;
+        return state->haveProgress;
+    }
+
+    // counters of the solve, complete once it has finished
+    TargetingStats stats() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->stats;
+    }
+};
+
+// runs solve(options, stats) on executor under a fresh cancel token; options.onProgress keeps the handle's latest
+// event and then calls the one given, on the worker thread
+template <typename Result, typename Solve>
+SolveHandle<Result> submitSolve(SolveExecutor &executor, Solve solve, const TargetingOptions &options)
+{
+    auto promise = std::make_shared<std::promise<Result>>();
+    CancelToken token;
+    auto state = std::make_shared<SolveProgressState>();
+    SolveHandle<Result> handle(promise->get_future().share(), token, state);
+
+    executor.post([promise, token, state, solve, options]()
+                  {
+                      if (token.cancelled())
+                      {
+                          promise->set_exception(std::make_exception_ptr(SolveCancelled()));
+                          return;
+                      }
+                      TargetingOptions observed = options;
+                      observed.onProgress = [&](const TargetingProgress &progress)
+                      {
+                          {
+                              std::lock_guard<std::mutex> lock(state->mutex);
+                              state->progress = progress;
+                              state->haveProgress = true;
+                          }
+                          if (options.onProgress)
+                              options.onProgress(progress);
+                      };
+                      TargetingStats stats;
+                      CancellationScope scope(token);
+                      try
+                      {
+                          Result result = solve(observed, &stats);
+                          {
+                              std::lock_guard<std::mutex> lock(state->mutex);
+                              state->stats = stats;
+                          }
+                          promise->set_value(std::move(result));
+                      }
+                      catch (...)
+                      {
+                          {
+                              std::lock_guard<std::mutex> lock(state->mutex);
+                              state->stats = stats;
+                          }
+                          promise->set_exception(std::current_exception());
+                      } });
+    return handle;
+}
+
+// getInputsMixedPrecision on executor, the result is (speed m/s, eastAngle deg)
+inline SolveHandle<vAngle> getInputsAsync(SolveExecutor &executor, double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos,
+                                          const TargetingOptions &options = TargetingOptions())
+{
+    return submitSolve<vAngle>(
+        executor, [=](const TargetingOptions &observed, TargetingStats *stats)
+        { return getInputsMixedPrecision(groundAngle, initialPos, finalPos, observed, stats); },
+        options);
+}
+
+// optimizeTrajectory on executor, the result is (speed m/s, eastAngle deg, groundAngle deg)
+inline SolveHandle<Vector3<double>> optimizeTrajectoryAsync(SolveExecutor &executor, const Vector3<double> &initialPos, const Vector3<double> &finalPos, double m,
+                                                            const TargetingOptions &options = TargetingOptions())
+{
+    return submitSolve<Vector3<double>>(
+        executor, [=](const TargetingOptions &observed, TargetingStats *stats)
+        { return optimizeTrajectory(initialPos, finalPos, m, stats, observed); },
+        options);
+}
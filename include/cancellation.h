@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <condition_variable>
+
+// cooperative cancellation: whoever owns a CancelToken may cancel it from any thread, the solvers of a thread that has
+// a CancellationScope open on it notice at their next step and return with SolutionStatus::Cancelled; code further up
+// (the targeting loops) turns that into a SolveCancelled exception to unwind whatever it was in the middle of
+
+class SolveCancelled : public std::runtime_error
+{
+public:
+    SolveCancelled() : std::runtime_error("solve cancelled") {}
+};
+
+// copies share the flag
+class CancelToken
+{
+private:
+    std::shared_ptr<std::atomic<bool>> flag = std::make_shared<std::atomic<bool>>(false);
+
+public:
+    void cancel()
+    {
+        flag->store(true, std::memory_order_relaxed);
+    }
+
+    bool cancelled() const
+    {
+        return flag->load(std::memory_order_relaxed);
+    }
+
+    const std::atomic<bool> &state() const
+    {
+        return *flag;
+    }
+};
+
+// the flag the solvers of this thread check, nullptr when nothing can cancel them
+inline const std::atomic<bool> *&activeCancelFlag()
+{
+    thread_local const std::atomic<bool> *flag = nullptr;
+    return flag;
+}
+
+inline bool solveCancelled()
+{
+    const std::atomic<bool> *flag = activeCancelFlag();
+    return flag and flag->load(std::memory_order_relaxed);
+}
+
+// while alive, solves on this thread stop once token is cancelled; scopes nest (the inner token wins), the token must
+// outlive the scope
+class CancellationScope
+{
+private:
+    const std::atomic<bool> *previous;
+
+public:
+    CancellationScope(const CancelToken &token) : previous(activeCancelFlag())
+    {
+        activeCancelFlag() = &token.state();
+    }
+
+    CancellationScope(const CancellationScope &) = delete;
+    CancellationScope &operator=(const CancellationScope &) = delete;
+
+    ~CancellationScope()
+    {
+        activeCancelFlag() = previous;
+    }
+};
+
+// cancels token once seconds have passed, unless it is destroyed first (deadlines)
+class CancelAfter
+{
+private:
+    std::mutex mutex;
+    std::condition_variable stop;
+    bool stopping = false;
+    std::thread timer;
+
+public:
+    CancelAfter(CancelToken token, double seconds)
+    {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+        timer = std::thread([this, token, deadline]() mutable
+                            {
+                                std::unique_lock<std::mutex> lock(mutex);
+                                if (!stop.wait_until(lock, deadline, [this] { return stopping; }))
+                                    token.cancel(); });
+    }
+
+    CancelAfter(const CancelAfter &) = delete;
+    CancelAfter &operator=(const CancelAfter &) = delete;
+
+    ~CancelAfter()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        stop.notify_one();
+        timer.join();
+    }
+};
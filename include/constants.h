@@ -1,9 +1,107 @@
 #pragma once
 
+#include <cstddef>
+
 namespace RK4Constants
 {
     const double STEP_SIZE = 1e-3;
     const int MAX_STEPS = 1e8;
+    // simulated seconds after which a trajectory is given up (MaxSteps status)
+    const double MAX_FLIGHT_TIME = 2e4;
+    // coarsest step used by the targeting loop, as a multiple of the full fidelity step
+    const double MAX_COARSENING = 100;
+}
+
+namespace ABMConstants
+{
+    // highest Adams-Bashforth-Moulton order available (4 -> AB4 predictor, AM4 corrector)
+    const int MAX_ORDER = 4;
+    // when an event (e.g. impact) is crossed the step is divided by this factor and the last step is redone
+    const double EVENT_REFINEMENT_FACTOR = 10;
+    const int EVENT_REFINEMENTS = 2;
+}
+
+namespace ArenaConstants
+{
+    // bytes a MonotonicArena asks the heap for at a time (larger requests get a block of their own)
+    const std::size_t BLOCK_SIZE = 1 << 16;
+}
+
+namespace GravityFieldConstants
+{
+    // EGM2008 gravitational parameter (m^3/s^2) and reference radius (m), for coefficient files that do not give theirs
+    const double MU = 3.986004415e14;
+    const double RADIUS = 6378136.3;
+    // WGS84 J2 (unnormalized, C20 = -J2)
+    const double J2 = 1.08262668e-3;
+}
+
+namespace GeodesyConstants
+{
+    // WGS84 ellipsoid: semi-major axis (m) and flattening
+    const double WGS84_A = 6378137.0;
+    const double WGS84_F = 1 / 298.257223563;
+}
+
+namespace ForceModelConstants
+{
+    // exponential atmosphere: density at the surface (kg/m^3) and scale height (m)
+    const double SEA_LEVEL_DENSITY = 1.225;
+    const double SCALE_HEIGHT = 8500;
+    // mass over drag coefficient times area (kg/m^2) of the default object
+    const double BALLISTIC_COEFFICIENT = 5000;
+}
+
+namespace FootprintConstants
+{
+    // footprint sweeps integrate with ABM at this step (s), coarse enough for dense grids, the impact is still refined
+    const double STEP_SIZE = 1e-2;
+    // flight time written to cells that have not been computed yet
+    const float PENDING = -1;
+}
+
+namespace MonteCarloConstants
+{
+    const double STEP_SIZE = 1e-2;
+    // samples are drawn and accumulated in blocks of this size, which is also the unit of work of a thread
+    const long long BLOCK_SIZE = 64;
+    // the miss distance histogram covers MIN_MISS to MAX_MISS meters in HISTOGRAM_BINS logarithmic bins
+    const double MIN_MISS = 1e-1;
+    const double MAX_MISS = 1e7;
+    const int HISTOGRAM_BINS = 512;
+}
+
+namespace RendererConstants
+{
+    // unchanged pixels between two changes that are resent instead of jumped over (a jump costs ~8 bytes, a pixel 2)
+    const int MAX_UNCHANGED_GAP = 3;
+    // distance from a line within which pixel centers are drawn (half line glyph), sqrt(0.75)
+    const double LINE_REACH = 0.8660254037844386;
+    // segments shorter than this (pixels, along both axes) are tested over their bounding box instead of walked
+    const double SHORT_LINE = 2;
+    // side of the square tiles the screen is split into when rendering on several threads (pixels)
+    const int TILE_SIZE = 32;
+    // bytes gathered by FrameFileWriter before they are written out
+    const std::size_t WRITE_BUFFER = 1 << 22;
+}
+
+namespace TrajectoryFileConstants
+{
+    // states per chunk, a chunk is the unit that is compressed, indexed and decoded
+    const int CHUNK_STATES = 4096;
+}
+
+namespace LiveViewConstants
+{
+    const int WIDTH = 80;
+    const int HEIGHT = 40;
+    const double FRAMES_PER_SECOND = 30;
+    // simulated seconds between the states sent to the renderer
+    const double SAMPLE_INTERVAL = 0.5;
+    const size_t RING_CAPACITY = 1024;
+    // pixels around the picture, and the smallest area shown (meters), so short flights are not blown up
+    const int MARGIN = 3;
+    const double MIN_VIEW_SIZE = 1e4;
 }
 
 namespace Math
@@ -31,5 +129,42 @@ namespace Physics
     const double EARTH_ANGULAR_VELOCITY = 7.29e-5;
     const double G = 6.674e-11;
     const double ENERGY_TOLERANCE = 0.1;
+    // ground angle search interval and resolution of optimizeTrajectory (degrees)
+    const double MIN_GROUND_ANGLE = 15;
+    const double MAX_GROUND_ANGLE = 75;
+    const double GROUND_ANGLE_TOLERANCE = 1e-2;
+    const int MAX_OPTIMIZATION_EVALUATIONS = 30;
+    // joint optimization: iteration cap, largest ground angle move per iteration (degrees)
+    // and squared landing error (radians) below which energy steps are taken
+    const int MAX_OPTIMIZATION_ITERATIONS = 60;
+    const double MAX_GROUND_ANGLE_STEP = 5;
+    const double TANGENT_STEP_THRESHOLD = 1e-6;
+    const double GROUND_ANGLE_DIFFERENTIATION_STEP = 0.5;
     const double LOCATION_TOLERANCE = 1e-12; // in squared degrees
+    const int MAX_TARGETING_ITERATIONS = 50;
+    // step control of the Broyden and Levenberg-Marquardt targeting strategies
+    const int MAX_BACKTRACKS = 6;
+    const double LM_INITIAL_DAMPING = 1e-3;
+    // anytime optimization: landings closer than this (m) count as feasible and are ranked by energy, a little more
+    // than float targeting reaches (Precision<float>::LOCATION_TOLERANCE, ~200m)
+    const double FEASIBLE_LANDING_ERROR = 250;
 }
+
+// settings that depend on the scalar type used to integrate
+template <typename T>
+struct Precision
+{
+    static inline const double STEP_SIZE = RK4Constants::STEP_SIZE;
+    static inline const double DIFFERENTIATION_STEP = Math::eps;
+    static inline const double LOCATION_TOLERANCE = Physics::LOCATION_TOLERANCE;
+};
+
+template <>
+struct Precision<float>
+{
+    // a float cannot resolve millisecond increments on Earth-sized coordinates (ulp ~ 0.5m),
+    // so single precision needs longer steps, wider finite differences and a looser landing tolerance
+    static inline const double STEP_SIZE = 1e-1;
+    static inline const double DIFFERENTIATION_STEP = 1e-1;
+    static inline const double LOCATION_TOLERANCE = 1e-9; // ~200m
+};
@@ -0,0 +1,267 @@
+#pragma once
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+#include "linalg.h"
+#include "rk4.h"
+
+// continuous trajectory from a finished integration: the state and its derivative at every accepted step (knots),
+// joined by cubic Hermite polynomials, so the state can be asked at any time without integrating again
+// it is a solver observer: handed to solve (or getFinalPosition) it gets the knots of that solve
+// knots are stored contiguously as (time, state, derivative), 1 + 2 * dimensions values each
+template <typename T = double>
+class DenseTrajectory
+{
+private:
+    int dims = 0;
+    std::vector<T> knots;
+
+    int stride() const
+    {
+        return 1 + 2 * dims;
+    }
+
+    const T *knot(int k) const
+    {
+        return &knots[(size_t)k * stride()];
+    }
+
+    // Hermite basis on segment k at t, for values (h00, h10, h01, h11) and for derivatives
+    void basis(int k, T t, T *w, T *dw) const
+    {
+        const T t0 = knot(k)[0], h = knot(k + 1)[0] - t0;
+        const T s = h > 0 ? (t - t0) / h : 0, s2 = s * s, s3 = s2 * s;
+        w[0] = 2 * s3 - 3 * s2 + 1;
+        w[1] = (s3 - 2 * s2 + s) * h;
+        w[2] = -2 * s3 + 3 * s2;
+        w[3] = (s3 - s2) * h;
+        if (dw)
+        {
+            const T inv = h > 0 ? 1 / h : 0;
+            dw[0] = (6 * s2 - 6 * s) * inv;
+            dw[1] = 3 * s2 - 4 * s + 1;
+            dw[2] = (-6 * s2 + 6 * s) * inv;
+            dw[3] = 3 * s2 - 2 * s;
+        }
+    }
+
+    void evaluate(int k, T t, T *out) const
+    {
+        if (size() == 1)
+        {
+            std::copy(knot(0) + 1, knot(0) + 1 + dims, out);
+            return;
+        }
+        T w[4];
+        basis(k, t, w, nullptr);
+        const T *a = knot(k), *b = knot(k + 1);
+        for (int i = 0; i < dims; i++)
+            out[i] = w[0] * a[1 + i] + w[1] * a[1 + dims + i] + w[2] * b[1 + i] + w[3] * b[1 + dims + i];
+    }
+
+public:
+    void clear()
+    {
+        knots.clear();
+        dims = 0;
+    }
+
+    void reserve(int n, int dimensions)
+    {
+        knots.reserve((size_t)n * (1 + 2 * dimensions));
+    }
+
+    // y and dy are row matrices, times must not decrease
+    void append(T t, const Matrix<T> &y, const Matrix<T> &dy)
+    {
+        if (knots.empty())
+            dims = y.getCols();
+        else if (y.getCols() != dims or t < endTime())
+            throw std::invalid_argument("Knots must have the same size and non-decreasing times");
+        knots.push_back(t);
+        for (int i = 0; i < dims; i++)
+            knots.push_back(y(0, i));
+        for (int i = 0; i < dims; i++)
+            knots.push_back(dy(0, i));
+    }
+
+    // as an observer, a new solve starts over
+    void onStep(const SolverStep<T> &step)
+    {
+        if (step.index == 0)
+            clear();
+        append(step.time, step.state, step.derivative);
+    }
+
+    int dimensions() const
+    {
+        return dims;
+    }
+
+    // number of knots
+    int size() const
+    {
+        return dims == 0 ? 0 : (int)(knots.size() / stride());
+    }
+
+    bool empty() const
+    {
+        return knots.empty();
+    }
+
+    T startTime() const
+    {
+        return knot(0)[0];
+    }
+
+    T endTime() const
+    {
+        return knot(size() - 1)[0];
+    }
+
+    T knotTime(int k) const
+    {
+        return knot(k)[0];
+    }
+
+    // the state stored at knot k
+    const T *knotState(int k) const
+    {
+        return knot(k) + 1;
+    }
+
+    // the segment [knot k, knot k + 1] holding t, by bisection; times outside the trajectory use the first or last one
+    int segment(T t) const
+    {
+        int lo = 0, hi = size() - 1;
+        if (hi < 1)
+            return 0;
+        while (hi - lo > 1)
+        {
+            const int mid = (lo + hi) / 2;
+            if (knot(mid)[0] <= t)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return lo;
+    }
+
+    // state at t into out (dimensions() values); outside the trajectory the end polynomials are extrapolated
+    void state(T t, T *out) const
+    {
+        if (empty())
+            throw std::out_of_range("Empty dense trajectory");
+        evaluate(segment(t), t, out);
+    }
+
+    Matrix<T> state(T t) const
+    {
+        Matrix<T> m(1, dims);
+        std::vector<T> values(dims);
+        state(t, values.data());
+        for (int i = 0; i < dims; i++)
+            m(0, i) = values[i];
+        return m;
+    }
+
+    // derivative of the interpolated state at t into out
+    void derivative(T t, T *out) const
+    {
+        if (size() < 2)
+            throw std::out_of_range("Dense trajectory needs two knots for derivatives");
+        const int k = segment(t);
+        T w[4], dw[4];
+        basis(k, t, w, dw);
+        const T *a = knot(k), *b = knot(k + 1);
+        for (int i = 0; i < dims; i++)
+            out[i] = dw[0] * a[1 + i] + dw[1] * a[1 + dims + i] + dw[2] * b[1 + i] + dw[3] * b[1 + dims + i];
+    }
+
+    // states at every time of times into out (dimensions() values per time, in the same order)
+    // increasing times are found by walking the knots forward instead of bisecting for each one
+    void states(const std::vector<T> &times, std::vector<T> &out) const
+    {
+        if (empty())
+            throw std::out_of_range("Empty dense trajectory");
+        out.resize(times.size() * dims);
+        const int last = std::max(0, size() - 2);
+        int k = segment(times.empty() ? 0 : times[0]);
+        for (size_t j = 0; j < times.size(); j++)
+        {
+            const T t = times[j];
+            if (j > 0 and t >= times[j - 1])
+            {
+                while (k < last and knot(k + 1)[0] <= t)
+                    k++;
+            }
+            else
+            {
+                k = segment(t);
+            }
+            evaluate(k, t, &out[j * dims]);
+        }
+    }
+
+    // times where f(t, state) changes sign, one per knot segment at most, found to within tolerance by regula falsi
+    // (Illinois variant); only segments where f differs in sign at the knots are searched, so a pair of roots
+    // closer together than a step is missed
+    template <typename F>
+    std::vector<T> roots(F f, T tolerance = 1e-9) const
+    {
+        std::vector<T> found;
+        if (empty())
+            return found;
+        std::vector<T> y(dims);
+        auto g = [&](T t)
+        {
+            state(t, y.data());
+            return f(t, y.data());
+        };
+        T ta = startTime(), fa = f(ta, knotState(0));
+        for (int k = 0; k + 1 < size(); k++)
+        {
+            const T tb = knot(k + 1)[0];
+            const T fb = f(tb, knotState(k + 1));
+            if (fa == 0)
+                found.push_back(ta);
+            else if ((fa < 0) != (fb < 0) and fb != 0)
+            {
+                T a = ta, b = tb, ga = fa, gb = fb;
+                int side = 0;
+                T c = a;
+                for (int i = 0; i < 100 and b - a > tolerance; i++)
+                {
+                    c = (a * gb - b * ga) / (gb - ga);
+                    const T gc = g(c);
+                    if (gc == 0)
+                        break;
+                    if ((gc < 0) == (ga < 0))
+                    {
+                        a = c;
+                        ga = gc;
+                        if (side == -1)
+                            gb /= 2;
+                        side = -1;
+                    }
+                    else
+                    {
+                        b = c;
+                        gb = gc;
+                        if (side == 1)
+                            ga /= 2;
+                        side = 1;
+                    }
+                }
+                found.push_back(c);
+            }
+            ta = tb;
+            fa = fb;
+        }
+        if (size() > 0 and fa == 0)
+            found.push_back(ta);
+        return found;
+    }
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include "linalg.h"
+#include "physics.h"
+#include "constants.h"
+
+// landing footprint of a launch site: where the object lands for every launch in a (speed x east angle x ground angle) grid
+//
+// file layout (native endianness):
+//   header: magic "TJFP", uint32 version, launch latitude and longitude (double, degrees),
+//           then min, max (double) and count (int32) for the speed, east angle and ground angle axes
+//   cells:  3 floats each (latitude, longitude in degrees, flight time in s), speed varies fastest, ground angle slowest
+// a cell with flight time FootprintConstants::PENDING has not been computed yet (that is what lets a sweep resume),
+// a cell with NaN everywhere never lands (escape, orbit or longer than the flight time cap)
+
+struct FootprintAxis
+{
+    double min, max;
+    int count;
+
+    double at(int i) const
+    {
+        return count == 1 ? min : min + (max - min) * i / (count - 1);
+    }
+
+    bool operator==(const FootprintAxis &other) const
+    {
+        return min == other.min and max == other.max and count == other.count;
+    }
+};
+
+struct FootprintGrid
+{
+    double latitude, longitude; // launch site, degrees
+    FootprintAxis speed;        // m/s
+    FootprintAxis eastAngle;    // degrees, 0 facing east, counterclockwise
+    FootprintAxis groundAngle;  // degrees
+
+    // a row is every speed for one launch direction, rows are the unit of work
+    int rows() const
+    {
+        return eastAngle.count * groundAngle.count;
+    }
+
+    long long cells() const
+    {
+        return (long long)rows() * speed.count;
+    }
+
+    bool operator==(const FootprintGrid &other) const
+    {
+        return latitude == other.latitude and longitude == other.longitude and speed == other.speed and
+               eastAngle == other.eastAngle and groundAngle == other.groundAngle;
+    }
+};
+
+struct FootprintCell
+{
+    float latitude, longitude, time;
+
+    bool pending() const
+    {
+        return time == FootprintConstants::PENDING;
+    }
+
+    bool lands() const
+    {
+        return !std::isnan(time) and !pending();
+    }
+};
+
+namespace FootprintFormat
+{
+    const char MAGIC[4] = {'T', 'J', 'F', 'P'};
+    const std::uint32_t VERSION = 1;
+    const std::streamoff HEADER_SIZE = 4 + 4 + 2 * 8 + 3 * (2 * 8 + 4);
+    const std::streamoff CELL_SIZE = 3 * sizeof(float);
+}
+
+inline void writeFootprintHeader(std::ostream &out, const FootprintGrid &grid)
+{
+    out.write(FootprintFormat::MAGIC, 4);
+    out.write(reinterpret_cast<const char *>(&FootprintFormat::VERSION), sizeof(std::uint32_t));
+    out.write(reinterpret_cast<const char *>(&grid.latitude), sizeof(double));
+    out.write(reinterpret_cast<const char *>(&grid.longitude), sizeof(double));
+    for (const FootprintAxis *axis : {&grid.speed, &grid.eastAngle, &grid.groundAngle})
+    {
+        const std::int32_t count = axis->count;
+        out.write(reinterpret_cast<const char *>(&axis->min), sizeof(double));
+        out.write(reinterpret_cast<const char *>(&axis->max), sizeof(double));
+        out.write(reinterpret_cast<const char *>(&count), sizeof(std::int32_t));
+    }
+}
+
+inline FootprintGrid readFootprintHeader(std::istream &in)
+{
+    char magic[4];
+    std::uint32_t version = 0;
+    FootprintGrid grid;
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char *>(&version), sizeof(std::uint32_t));
+    if (!in or std::memcmp(magic, FootprintFormat::MAGIC, 4) != 0 or version != FootprintFormat::VERSION)
+        throw std::runtime_error("Not a footprint file");
+    in.read(reinterpret_cast<char *>(&grid.latitude), sizeof(double));
+    in.read(reinterpret_cast<char *>(&grid.longitude), sizeof(double));
+    for (FootprintAxis *axis : {&grid.speed, &grid.eastAngle, &grid.groundAngle})
+    {
+        std::int32_t count = 0;
+        in.read(reinterpret_cast<char *>(&axis->min), sizeof(double));
+        in.read(reinterpret_cast<char *>(&axis->max), sizeof(double));
+        in.read(reinterpret_cast<char *>(&count), sizeof(std::int32_t));
+        axis->count = count;
+    }
+    if (!in)
+        throw std::runtime_error("Truncated footprint header");
+    return grid;
+}
+
+// reads a (possibly partial) footprint file, cells in file order
+inline std::vector<FootprintCell> readFootprint(const std::string &path, FootprintGrid &grid)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open footprint file " + path);
+    grid = readFootprintHeader(in);
+    std::vector<FootprintCell> cells(grid.cells());
+    for (FootprintCell &cell : cells)
+    {
+        float values[3];
+        in.read(reinterpret_cast<char *>(values), FootprintFormat::CELL_SIZE);
+        if (!in)
+            throw std::runtime_error("Truncated footprint file " + path);
+        cell = {values[0], values[1], values[2]};
+    }
+    return cells;
+}
+
+// lands every launch of one row (fixed direction, increasing speed) into cells
+// the launch frame is shared by the whole row, and since escape speed is exceeded for good once it is reached,
+// the rest of the row is marked without integrating after the first escape
+inline void computeFootprintRow(const FootprintGrid &grid, int row, FootprintCell *cells, double stepSize)
+{
+    const float never = std::numeric_limits<float>::quiet_NaN();
+    const double lat = grid.latitude * Math::pi / 180;
+    const double lon = grid.longitude * Math::pi / 180;
+    const double eastAngle = grid.eastAngle.at(row % grid.eastAngle.count) * Math::pi / 180;
+    const double groundAngle = grid.groundAngle.at(row / grid.eastAngle.count) * Math::pi / 180;
+
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, lon, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, lon);
+    const Vector3<double> direction = localToInertial(lat, lon, Vector3<double>(std::cos(groundAngle) * std::cos(eastAngle),
+                                                                                std::cos(groundAngle) * std::sin(eastAngle),
+                                                                                std::sin(groundAngle))) -
+                                      spin;
+
+    bool escaped = false;
+    for (int i = 0; i < grid.speed.count; i++)
+    {
+        if (escaped)
+        {
+            cells[i] = {never, never, never};
+            continue;
+        }
+        const RK4Solution<double> sol = getFinalPosition<ABM>(initialPos, grid.speed.at(i) * direction + spin, stepSize);
+        if (sol.status != SolutionStatus::EndCondition)
+        {
+            // along an increasing speed axis an escape stays an escape
+            escaped = sol.status == SolutionStatus::Escape and grid.speed.max >= grid.speed.min;
+            cells[i] = {never, never, never};
+            continue;
+        }
+        const Vector3<double> finalPos(sol.solutions(0, 0), sol.solutions(0, 1), sol.solutions(0, 2));
+        double landingLon = std::remainder(finalPos.theta() - Physics::EARTH_ANGULAR_VELOCITY * sol.time, 2 * Math::pi);
+        cells[i] = {(float)(90 - 180 / Math::pi * finalPos.phi()), (float)(180 / Math::pi * landingLon), (float)sol.time};
+    }
+}
+
+// computes the footprint of grid into path, one row per task on threads workers (0 -> hardware concurrency)
+// if path already holds a sweep of the same grid only its pending rows are computed, so an interrupted sweep resumes
+// where it stopped; a file for a different grid is an error
+// returns the number of rows computed
+inline int generateFootprint(const std::string &path, const FootprintGrid &grid, int threads = 0,
+                             double stepSize = FootprintConstants::STEP_SIZE)
+{
+    if (grid.speed.count < 1 or grid.eastAngle.count < 1 or grid.groundAngle.count < 1)
+        throw std::invalid_argument("Footprint axes need at least one value");
+
+    std::vector<int> pendingRows;
+    {
+        std::ifstream existing(path, std::ios::binary);
+        if (existing)
+        {
+            existing.close();
+            FootprintGrid stored;
+            std::vector<FootprintCell> cells = readFootprint(path, stored);
+            if (!(stored == grid))
+                throw std::invalid_argument("Footprint file " + path + " holds a different grid");
+            for (int row = 0; row < grid.rows(); row++)
+                for (int i = 0; i < grid.speed.count; i++)
+                    if (cells[(long long)row * grid.speed.count + i].pending())
+                    {
+                        pendingRows.push_back(row);
+                        break;
+                    }
+        }
+        else
+        {
+            std::ofstream out(path, std::ios::binary);
+            if (!out)
+                throw std::runtime_error("Cannot create footprint file " + path);
+            writeFootprintHeader(out, grid);
+            const float pending[3] = {0, 0, FootprintConstants::PENDING};
+            for (long long i = 0; i < grid.cells(); i++)
+                out.write(reinterpret_cast<const char *>(pending), FootprintFormat::CELL_SIZE);
+            if (!out)
+                throw std::runtime_error("Cannot write footprint file " + path);
+            for (int row = 0; row < grid.rows(); row++)
+                pendingRows.push_back(row);
+        }
+    }
+    if (pendingRows.empty())
+        return 0;
+
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    if (!file)
+        throw std::runtime_error("Cannot open footprint file " + path);
+    std::mutex fileMutex;
+    std::atomic<int> next(0);
+
+    // rows are flushed as soon as they are done, an interruption loses at most the rows in flight
+    auto worker = [&]()
+    {
+        std::vector<FootprintCell> cells(grid.speed.count);
+        std::vector<float> buffer(3 * grid.speed.count);
+        for (int k = next++; k < (int)pendingRows.size(); k = next++)
+        {
+            const int row = pendingRows[k];
+            computeFootprintRow(grid, row, cells.data(), stepSize);
+            for (int i = 0; i < grid.speed.count; i++)
+            {
+                buffer[3 * i] = cells[i].latitude;
+                buffer[3 * i + 1] = cells[i].longitude;
+                buffer[3 * i + 2] = cells[i].time;
+            }
+            std::lock_guard<std::mutex> lock(fileMutex);
+            file.seekp(FootprintFormat::HEADER_SIZE + (std::streamoff)row * grid.speed.count * FootprintFormat::CELL_SIZE);
+            file.write(reinterpret_cast<const char *>(buffer.data()), grid.speed.count * FootprintFormat::CELL_SIZE);
+            file.flush();
+        }
+    };
+
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (int)pendingRows.size());
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread &w : workers)
+        w.join();
+
+    if (!file)
+        throw std::runtime_error("Cannot write footprint file " + path);
+    return (int)pendingRows.size();
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cmath>
+#include <tuple>
+#include <algorithm>
+#include "linalg.h"
+#include "physics.h"
+#include "constants.h"
+
+// the accelerations acting on the object, picked at compile time: ForceModel<double, PointMass, J2, ExponentialDrag>
+// sums its terms in one kernel the compiler inlines whole, so a term that is not listed costs nothing and the point
+// mass alone does exactly what gravitationalDerivatives does
+//
+// a term is a class template over the scalar type with
+//   void prepare()                                             derived constants, once per solve
+//   void accelerate(const ForceState<T> &s, T *a) const        adds its acceleration (inertial frame) to a
+// terms that depend on time explicitly do not fit (the solvers integrate autonomous systems), see gravityfield.h
+
+// what every term may need of the state, worked out once per derivative call
+// the state is read straight from the matrix: a local copy lets the compiler load it in pairs, which stalls on the
+// scalar stores the solver has just made to it
+template <typename T>
+struct ForceState
+{
+    const Matrix<T> &m;
+    T r2, r;
+
+    // x, y, z, vx, vy, vz
+    T operator[](int i) const
+    {
+        return m(0, i);
+    }
+};
+
+template <typename T>
+class PointMass
+{
+private:
+    T mu;
+    T minusMu = 0;
+
+public:
+    PointMass(T mu = (T)(Physics::G * Physics::EARTH_MASS)) : mu(mu) {}
+
+    void prepare()
+    {
+        minusMu = -mu;
+    }
+
+    void accelerate(const ForceState<T> &s, T *a) const
+    {
+        const T factor = minusMu / (s.r * s.r * s.r);
+        a[0] += factor * s[0];
+        a[1] += factor * s[1];
+        a[2] += factor * s[2];
+    }
+};
+
+// Earth's oblateness, the largest departure from a point mass
+template <typename T>
+class J2
+{
+private:
+    T j2, mu, radius;
+    T k = 0; // 3/2 J2 mu R^2
+
+public:
+    J2(T j2 = (T)GravityFieldConstants::J2, T mu = (T)(Physics::G * Physics::EARTH_MASS), T radius = (T)GravityFieldConstants::RADIUS)
+        : j2(j2), mu(mu), radius(radius) {}
+
+    void prepare()
+    {
+        k = (T)1.5 * j2 * mu * radius * radius;
+    }
+
+    void accelerate(const ForceState<T> &s, T *a) const
+    {
+        const T inv2 = 1 / s.r2;
+        const T factor = -k * inv2 * inv2 / s.r;
+        const T zz = 5 * s[2] * s[2] * inv2;
+        a[0] += factor * s[0] * (1 - zz);
+        a[1] += factor * s[1] * (1 - zz);
+        a[2] += factor * s[2] * (3 - zz);
+    }
+};
+
+// drag in an exponential atmosphere that turns with the Earth: -rho(h) |v - w x r| (v - w x r) / (2 ballistic)
+template <typename T>
+class ExponentialDrag
+{
+private:
+    T ballistic, density, scaleHeight, surface;
+    T factor = 0, inverseHeight = 0, omega = 0;
+
+public:
+    // ballistic coefficient is mass / (drag coefficient * area) in kg/m^2
+    ExponentialDrag(T ballisticCoefficient = (T)ForceModelConstants::BALLISTIC_COEFFICIENT, T seaLevelDensity = (T)ForceModelConstants::SEA_LEVEL_DENSITY,
+                    T scaleHeight = (T)ForceModelConstants::SCALE_HEIGHT, T surface = (T)Physics::EARTH_RADIUS)
+        : ballistic(ballisticCoefficient), density(seaLevelDensity), scaleHeight(scaleHeight), surface(surface) {}
+
+    void prepare()
+    {
+        factor = -density / (2 * ballistic);
+        inverseHeight = 1 / scaleHeight;
+        omega = (T)Physics::EARTH_ANGULAR_VELOCITY;
+    }
+
+    void accelerate(const ForceState<T> &s, T *a) const
+    {
+        const T vx = s[3] + omega * s[1], vy = s[4] - omega * s[0], vz = s[5];
+        const T speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+        const T d = factor * std::exp((surface - s.r) * inverseHeight) * speed;
+        a[0] += d * vx;
+        a[1] += d * vy;
+        a[2] += d * vz;
+    }
+};
+
+template <typename T, template <typename> class... Terms>
+class ForceModel
+{
+private:
+    std::tuple<Terms<T>...> terms;
+
+public:
+    ForceModel() = default;
+    ForceModel(const Terms<T> &...terms) : terms(terms...) {}
+
+    // the term of type Term<T>, to change its parameters (prepare again afterwards)
+    template <template <typename> class Term>
+    Term<T> &term()
+    {
+        return std::get<Term<T>>(terms);
+    }
+
+    void prepare()
+    {
+        std::apply([](auto &...term) { (term.prepare(), ...); }, terms);
+    }
+
+    // derivatives of (x, y, z, vx, vy, vz) as gravitationalDerivatives has them
+    void operator()(const Matrix<T> &m, Matrix<T> &derivatives) const
+    {
+        derivatives(0, 0) = m(0, 3);
+        derivatives(0, 1) = m(0, 4);
+        derivatives(0, 2) = m(0, 5);
+
+        const T r2 = m(0, 0) * m(0, 0) + m(0, 1) * m(0, 1) + m(0, 2) * m(0, 2);
+        const ForceState<T> state = {m, r2, std::sqrt(r2)};
+        // the terms add straight into the derivatives, as the matrix might be the state they read they reread it after
+        // every store, just like gravitationalDerivatives; -0 + x is x for every x, so unlike 0 the compiler drops it
+        T *a = &derivatives(0, 3);
+        a[0] = a[1] = a[2] = -(T)0;
+        std::apply([&](const auto &...term) { (term.accelerate(state, a), ...); }, terms);
+    }
+};
+
+// getFinalPosition under the forces of model, prepared here once for the solve
+// escapes and orbits are still recognised from the point mass conic before integrating
+template <template <typename> class Solver = RK4, typename T = double, template <typename> class... Terms>
+RK4Solution<T> getFinalPosition(ForceModel<T, Terms...> model, Vector3<T> initialPos, Vector3<T> initialV, T stepSize = (T)Precision<T>::STEP_SIZE,
+                                double maxFlightTime = RK4Constants::MAX_FLIGHT_TIME)
+{
+    Solver<T> solver(stepSize);
+    Matrix<T> initialConditions(1, 6);
+    for (int i = 0; i < 3; i++)
+    {
+        initialConditions(0, i) = initialPos[i];
+        initialConditions(0, 3 + i) = initialV[i];
+    }
+
+    const SolutionStatus status = keplerianStatus(initialPos, initialV, maxFlightTime);
+    if (status != SolutionStatus::EndCondition)
+    {
+        RK4Solution<T> solution(0, stepSize, (T)0, initialConditions);
+        solution.status = status;
+        return solution;
+    }
+    model.prepare();
+    const int maxSteps = (int)std::min((double)RK4Constants::MAX_STEPS, maxFlightTime / (double)stepSize);
+    return solver.solve(initialConditions, model, maxSteps, objectInsideEarth<T>);
+}
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <fstream>
+#include <stdexcept>
+#include "renderer.h"
+#include "constants.h"
+
+// frame targets that need no terminal: frames kept in memory and frames written to files,
+// so animations can be rendered offline and the renderer measured on its own
+//
+// packed frame files (native endianness):
+//   header: magic "TJFR", uint32 version, int32 width, int32 height
+//   frames: width * height bytes each (pixel classes, row by row), as many as the file holds
+
+// pixel classes to gray levels and colors for PGM and PPM output
+const unsigned char PIXEL_GRAY[] = {0, 255, 128, 224, 112, 192};
+const unsigned char PIXEL_RGB[][3] = {{0, 0, 0}, {255, 255, 255}, {128, 128, 128}, {255, 200, 0}, {128, 100, 0}, {192, 192, 192}};
+
+namespace FrameFormat
+{
+    const char MAGIC[4] = {'T', 'J', 'F', 'R'};
+    const std::uint32_t VERSION = 1;
+    const std::streamoff HEADER_SIZE = 4 + 4 + 2 * 4;
+}
+
+// keeps the last history frames in memory
+class FramebufferTarget : public FrameTarget
+{
+private:
+    std::size_t history;
+    std::deque<Framebuffer> frames;
+    long long presented = 0;
+
+public:
+    FramebufferTarget(std::size_t history = 1) : history(history)
+    {
+        if (history < 1)
+            throw std::invalid_argument("FramebufferTarget needs to keep at least one frame");
+    }
+
+    void present(const Framebuffer &frame) override
+    {
+        if (frames.size() == history)
+        {
+            // reuse the storage of the oldest frame
+            frames.push_back(std::move(frames.front()));
+            frames.pop_front();
+            frames.back().width = frame.width;
+            frames.back().height = frame.height;
+            frames.back().pixels.assign(frame.pixels.begin(), frame.pixels.end());
+        }
+        else
+        {
+            frames.push_back(frame);
+        }
+        presented++;
+    }
+
+    // frames presented so far, including the ones no longer kept
+    long long count() const
+    {
+        return presented;
+    }
+
+    // i = 0 is the newest frame
+    const Framebuffer &frame(std::size_t i = 0) const
+    {
+        if (i >= frames.size())
+            throw std::out_of_range("Frame no longer kept");
+        return frames[frames.size() - 1 - i];
+    }
+};
+
+enum class FrameFileFormat
+{
+    Packed, // raw pixel classes behind one header, the compact one and the one readPackedFrames reads back
+    PGM,    // a binary PGM (P5) per frame, concatenated, gray levels from PIXEL_GRAY
+    PPM     // a binary PPM (P6) per frame, concatenated, colors from PIXEL_RGB
+};
+
+// writes every frame to a file, bytes are gathered in a large buffer so a frame costs no system call
+// all frames of a packed file must have the same size
+class FrameFileWriter : public FrameTarget
+{
+private:
+    std::ofstream out;
+    std::string path;
+    FrameFileFormat format;
+    std::vector<char> buffer;
+    std::size_t used = 0;
+    int width = -1, height = -1;
+    long long written = 0;
+
+    void flushBuffer()
+    {
+        out.write(buffer.data(), used);
+        used = 0;
+        if (!out)
+            throw std::runtime_error("Cannot write frame file " + path);
+    }
+
+    // room for n more bytes, the buffer grows only for frames larger than it
+    char *reserve(std::size_t n)
+    {
+        if (used + n > buffer.size())
+        {
+            flushBuffer();
+            if (n > buffer.size())
+                buffer.resize(n);
+        }
+        char *at = buffer.data() + used;
+        used += n;
+        return at;
+    }
+
+    void append(const void *data, std::size_t n)
+    {
+        std::memcpy(reserve(n), data, n);
+    }
+
+public:
+    FrameFileWriter(const std::string &path, FrameFileFormat format = FrameFileFormat::Packed,
+                    std::size_t bufferSize = RendererConstants::WRITE_BUFFER)
+        : out(path, std::ios::binary), path(path), format(format), buffer(std::max<std::size_t>(bufferSize, 1))
+    {
+        if (!out)
+            throw std::runtime_error("Cannot create frame file " + path);
+    }
+
+    FrameFileWriter(const FrameFileWriter &) = delete;
+    FrameFileWriter &operator=(const FrameFileWriter &) = delete;
+
+    ~FrameFileWriter()
+    {
+        // errors cannot be reported from here, call close() to see them
+        try
+        {
+            close();
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+
+    void present(const Framebuffer &frame) override
+    {
+        const std::size_t n = frame.pixels.size();
+        if (format == FrameFileFormat::Packed)
+        {
+            if (width < 0)
+            {
+                const std::int32_t size[2] = {frame.width, frame.height};
+                append(FrameFormat::MAGIC, 4);
+                append(&FrameFormat::VERSION, sizeof(std::uint32_t));
+                append(size, sizeof(size));
+                width = frame.width;
+                height = frame.height;
+            }
+            else if (frame.width != width or frame.height != height)
+            {
+                throw std::invalid_argument("Frames of a packed file must all have the same size");
+            }
+            append(frame.pixels.data(), n);
+        }
+        else
+        {
+            const bool color = format == FrameFileFormat::PPM;
+            const std::string header = std::string(color ? "P6\n" : "P5\n") + std::to_string(frame.width) + " " +
+                                       std::to_string(frame.height) + "\n255\n";
+            append(header.data(), header.size());
+            unsigned char *p = reinterpret_cast<unsigned char *>(reserve(color ? 3 * n : n));
+            if (color)
+                for (std::size_t k = 0; k < n; k++, p += 3)
+                    std::memcpy(p, PIXEL_RGB[frame.pixels[k]], 3);
+            else
+                for (std::size_t k = 0; k < n; k++)
+                    p[k] = PIXEL_GRAY[frame.pixels[k]];
+        }
+        written++;
+    }
+
+    long long count() const
+    {
+        return written;
+    }
+
+    // writes out what is buffered and closes the file, later frames are an error
+    void close()
+    {
+        if (!out.is_open())
+            return;
+        flushBuffer();
+        out.close();
+        if (!out)
+            throw std::runtime_error("Cannot write frame file " + path);
+    }
+};
+
+// reads back every frame of a packed frame file
+inline std::vector<Framebuffer> readPackedFrames(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("Cannot open frame file " + path);
+    char magic[4];
+    std::uint32_t version = 0;
+    std::int32_t size[2] = {0, 0};
+    in.read(magic, 4);
+    in.read(reinterpret_cast<char *>(&version), sizeof(std::uint32_t));
+    in.read(reinterpret_cast<char *>(size), sizeof(size));
+    if (!in or std::memcmp(magic, FrameFormat::MAGIC, 4) != 0 or version != FrameFormat::VERSION or size[0] < 0 or
+        size[1] < 0)
+        throw std::runtime_error("Not a frame file " + path);
+
+    std::vector<Framebuffer> frames;
+    const std::size_t n = (std::size_t)size[0] * size[1];
+    while (true)
+    {
+        Framebuffer frame;
+        frame.width = size[0];
+        frame.height = size[1];
+        frame.pixels.resize(n);
+        in.read(reinterpret_cast<char *>(frame.pixels.data()), n);
+        if (in.gcount() == 0 or n == 0)
+            break;
+        if ((std::size_t)in.gcount() != n)
+            throw std::runtime_error("Truncated frame file " + path);
+        frames.push_back(std::move(frame));
+    }
+    return frames;
+}
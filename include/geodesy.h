@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <algorithm>
+#include <limits>
+#include "constants.h"
+
+// batch coordinate conversions for post-processing many states at once: structure of arrays in and out (one array per
+// coordinate; an output may be the input array of the same position, e.g. x over r), angles in radians, lengths in
+// metres, finite inputs only
+// the conversions are branch free and inline the fast sin/cos/atan2 below, so the compiler can vectorize them: with gcc
+// 12 the two to Cartesian from angles alone do at -O2, anything taking a square root needs -fno-math-errno (else sqrt
+// may set errno, a branch), and anything taking an atan2 also -O3 to get it inlined; the results are the same either way
+//
+// spherical (r, theta, phi) is Vector3's convention: theta the angle in the xy plane, phi the drop from the z axis;
+// geocentric is (latitude, longitude, radius) with latitude = pi/2 - phi;
+// geodetic is (latitude, longitude, height) over the WGS84 ellipsoid, ECEF the Earth fixed Cartesian frame
+
+namespace FastMath
+{
+    // Cody-Waite split of pi/2: the first two parts end in zero bits, so q * part is exact for |q| < 2^20
+    const double PIO2_1 = 1.57079625129699707031e+00;
+    const double PIO2_2 = 7.54978941586159635335e-08;
+    const double PIO2_3 = 5.39030285815811905290e-15;
+    // what pi/4 loses to rounding (pi/4 = PIO4 + PIO4_LOW)
+    const double PIO4 = 7.85398163397448278999e-01;
+    const double PIO4_LOW = 3.06161699786838294307e-17;
+    // adding and subtracting it rounds a double smaller than 2^51 to the nearest integer
+    const double ROUNDING = 6755399441055744.0;
+    // points per batch pass, small enough for the stack copies to stay in L1
+    const std::size_t BLOCK = 256;
+}
+
+// 1 for x >= +0, 0 below (-0 included), a mask to select with by arithmetic: gcc keeps a select whose side does
+// arithmetic as a branch (the arithmetic could trap), and a comparison turned into 0/1 it folds back into such a select,
+// copysign it leaves alone
+inline double nonNegative(double x)
+{
+    return 0.5 + 0.5 * std::copysign(1.0, x);
+}
+
+// sin and cos of x at once: reduction to [-pi/4, pi/4] around the nearest multiple of pi/2, then the Cephes minimax
+// polynomials; |error| < 2.3e-16 against std::sin/std::cos for |x| <= 1e5 (reduction stays exact up to ~1.6e6)
+inline void fastSinCos(double x, double &s, double &c)
+{
+    const double q = (x * (2 / Math::pi) + FastMath::ROUNDING) - FastMath::ROUNDING;
+    const double r = ((x - q * FastMath::PIO2_1) - q * FastMath::PIO2_2) - q * FastMath::PIO2_3;
+    const double z = r * r;
+    const double sinR = r + r * z * (((((1.58962301576546568060e-10 * z - 2.50507477628578072866e-8) * z + 2.75573136213857245213e-6) * z - 1.98412698295895385996e-4) * z + 8.33333333332211858878e-3) * z - 1.66666666666666307295e-1);
+    const double cosR = 1 - 0.5 * z + z * z * (((((-1.13585365213876817300e-11 * z + 2.08757008419747316778e-9) * z - 2.75573141792967388112e-7) * z + 2.48015872888517045348e-5) * z - 1.38888888888730564116e-3) * z + 4.16666666666665929218e-2);
+
+    // x = q pi/2 + r: odd quadrants swap sin and cos, the signs follow the quadrant; q mod 4 is taken in doubles so the
+    // vector lanes stay doubles
+    const double nearest = (q * 0.25 + FastMath::ROUNDING) - FastMath::ROUNDING;
+    const double fourths = nearest - 1 + nonNegative(q * 0.25 - nearest); // floor(q / 4)
+    const double quadrant = q - 4 * fourths;                              // 0, 1, 2 or 3
+    const bool odd = std::abs(quadrant - 2) == 1; // 1 or 3, without a short circuit (a branch)
+    const double sinA = odd ? cosR : sinR;
+    const double cosA = odd ? sinR : cosR;
+    s = quadrant >= 2 ? -sinA : sinA;
+    c = std::abs(quadrant - 1.5) < 1 ? -cosA : cosA; // 1 or 2
+}
+
+// atan2 from the Cephes rational approximation of atan on [-0.66, 0.66], the octant fixed up by arithmetic on
+// nonNegative masks; |error| < 4.5e-16 rad (one ulp of pi) against std::atan2, atan2(0, 0) = 0 like Vector3::theta
+inline double fastAtan2(double y, double x)
+{
+    const double ax = std::abs(x), ay = std::abs(y);
+    const double high = std::max(ax, ay), low = std::min(ax, ay);
+    // adding the smallest normal double keeps 0 / 0 out and changes nothing above 1e-291 (a max would be a select)
+    const double t = low / (high + std::numeric_limits<double>::min()); // in [0, 1]
+    // above 0.66, atan(t) = pi/4 + atan((t - 1) / (t + 1))
+    const double reduced = 1 - nonNegative(0.66 - t);
+    const double u = (t - reduced) / (1 + reduced * t);
+    const double z = u * u;
+    const double p = (((-8.750608600031904122785e-1 * z - 1.615753718733365076637e1) * z - 7.500855792314704667340e1) * z - 1.228866684490136173410e2) * z - 6.485021904942025371773e1;
+    const double q = ((((z + 2.485846490142306297962e1) * z + 1.650270098316988542046e2) * z + 4.328810604912902668951e2) * z + 4.853903996359136964868e2) * z + 1.945506571482613964425e2;
+    // atan(t) = reduced pi/4 + atan(u), pi/2 minus that when |y| > |x|, pi minus that when x < 0: all in one as
+    // k pi/4 + sign atan(u)
+    const double steep = 1 - nonNegative(ax - ay);
+    const double left = 1 - nonNegative(x); // -0 too, like std::atan2
+    const double k = 4 * left + (1 - 2 * left) * (2 * steep + (1 - 2 * steep) * reduced);
+    const double sign = (1 - 2 * left) * (1 - 2 * steep);
+    const double half = (k * FastMath::PIO4 + sign * (u + u * z * p / q)) + k * FastMath::PIO4_LOW;
+    return std::copysign(half, y);
+}
+
+// runs convert(a, b, c, x, y, z) on each point, a block at a time through arrays on the stack: the compiler then knows
+// the inner loop's inputs and outputs apart, so it needs no aliasing checks to vectorize it, and outputs may overwrite
+// inputs; the inner loop always runs the whole block (a short last block converts stale points it does not copy out),
+// a fixed trip count needs no scalar remainder, which is what gcc's -O2 asks before it vectorizes
+template <typename Convert>
+inline void convertPoints(const double *a, const double *b, const double *c, double *x, double *y, double *z, std::size_t n, Convert convert)
+{
+    double in[3][FastMath::BLOCK] = {}, out[3][FastMath::BLOCK];
+    for (std::size_t start = 0; start < n; start += FastMath::BLOCK)
+    {
+        const std::size_t count = std::min(FastMath::BLOCK, n - start);
+        std::copy(a + start, a + start + count, in[0]);
+        std::copy(b + start, b + start + count, in[1]);
+        std::copy(c + start, c + start + count, in[2]);
+        for (std::size_t i = 0; i < FastMath::BLOCK; i++)
+            convert(in[0][i], in[1][i], in[2][i], out[0][i], out[1][i], out[2][i]);
+        std::copy(out[0], out[0] + count, x + start);
+        std::copy(out[1], out[1] + count, y + start);
+        std::copy(out[2], out[2] + count, z + start);
+    }
+}
+
+// what Vector3::fromSpherical does
+inline void sphericalToCartesian(const double *r, const double *theta, const double *phi, double *x, double *y, double *z, std::size_t n)
+{
+    convertPoints(r, theta, phi, x, y, z, n, [](double radius, double theta, double phi, double &x, double &y, double &z)
+                  {
+                      double sinTheta, cosTheta, sinPhi, cosPhi;
+                      fastSinCos(theta, sinTheta, cosTheta);
+                      fastSinCos(phi, sinPhi, cosPhi);
+                      x = radius * sinPhi * cosTheta;
+                      y = radius * sinPhi * sinTheta;
+                      z = radius * cosPhi; });
+}
+
+// Vector3's r(), theta() and phi(); phi comes from atan2 instead of acos, which is better conditioned near the poles
+inline void cartesianToSpherical(const double *x, const double *y, const double *z, double *r, double *theta, double *phi, std::size_t n)
+{
+    convertPoints(x, y, z, r, theta, phi, n, [](double x, double y, double z, double &r, double &theta, double &phi)
+                  {
+                      const double rho = std::sqrt(x * x + y * y);
+                      r = std::sqrt(x * x + y * y + z * z);
+                      theta = fastAtan2(y, x);
+                      phi = fastAtan2(rho, z); });
+}
+
+inline void geocentricToCartesian(const double *latitude, const double *longitude, const double *radius, double *x, double *y, double *z, std::size_t n)
+{
+    convertPoints(latitude, longitude, radius, x, y, z, n, [](double latitude, double longitude, double radius, double &x, double &y, double &z)
+                  {
+                      double sinLat, cosLat, sinLon, cosLon;
+                      fastSinCos(latitude, sinLat, cosLat);
+                      fastSinCos(longitude, sinLon, cosLon);
+                      x = radius * cosLat * cosLon;
+                      y = radius * cosLat * sinLon;
+                      z = radius * sinLat; });
+}
+
+inline void cartesianToGeocentric(const double *x, const double *y, const double *z, double *latitude, double *longitude, double *radius, std::size_t n)
+{
+    convertPoints(x, y, z, latitude, longitude, radius, n, [](double x, double y, double z, double &latitude, double &longitude, double &radius)
+                  {
+                      const double rho = std::sqrt(x * x + y * y);
+                      radius = std::sqrt(rho * rho + z * z);
+                      latitude = fastAtan2(z, rho);
+                      longitude = fastAtan2(y, x); });
+}
+
+inline void geodeticToEcef(const double *latitude, const double *longitude, const double *height, double *x, double *y, double *z, std::size_t n)
+{
+    const double a = GeodesyConstants::WGS84_A, f = GeodesyConstants::WGS84_F;
+    const double e2 = f * (2 - f);
+    convertPoints(latitude, longitude, height, x, y, z, n, [a, e2](double latitude, double longitude, double h, double &x, double &y, double &z)
+                  {
+                      double sinLat, cosLat, sinLon, cosLon;
+                      fastSinCos(latitude, sinLat, cosLat);
+                      fastSinCos(longitude, sinLon, cosLon);
+                      // prime vertical radius of curvature
+                      const double N = a / std::sqrt(1 - e2 * sinLat * sinLat);
+                      x = (N + h) * cosLat * cosLon;
+                      y = (N + h) * cosLat * sinLon;
+                      z = (N * (1 - e2) + h) * sinLat; });
+}
+
+// Bowring's closed form: no iterations to convergence and no trigonometric calls, the sines and cosines come from
+// normalizing and atan2 only turns the result into angles; one step is within 1e-13 rad at 10km but degrades with
+// height (1e-9 rad, 7mm, at 1000km), two are within 4.5e-16 rad and 3e-8m of the iterated solution from 10km below the
+// ellipsoid to 40000km above it
+inline void ecefToGeodetic(const double *x, const double *y, const double *z, double *latitude, double *longitude, double *height, std::size_t n)
+{
+    const double a = GeodesyConstants::WGS84_A, f = GeodesyConstants::WGS84_F;
+    const double b = a * (1 - f);
+    const double e2 = f * (2 - f);
+    const double ep2 = e2 / ((1 - f) * (1 - f)); // second eccentricity squared
+    convertPoints(x, y, z, latitude, longitude, height, n, [a, b, e2, ep2](double x, double y, double z, double &latitude, double &longitude, double &height)
+                  {
+                      const double p = std::sqrt(x * x + y * y);
+                      double numerator, denominator, sinLat, cosLat;
+                      // Bowring's step from the parametric latitude beta with tan(beta) = u / v
+                      auto step = [&](double u, double v)
+                      {
+                          const double w = std::sqrt(u * u + v * v);
+                          const double inverseW = 1 / (w + std::numeric_limits<double>::min()); // finite at the centre, where u = v = 0 anyway
+                          const double sinBeta = u * inverseW, cosBeta = v * inverseW;
+                          numerator = z + ep2 * b * sinBeta * sinBeta * sinBeta;
+                          denominator = p - e2 * a * cosBeta * cosBeta * cosBeta;
+                          const double hypot = std::sqrt(numerator * numerator + denominator * denominator);
+                          const double inverseHypot = 1 / (hypot + std::numeric_limits<double>::min());
+                          sinLat = numerator * inverseHypot;
+                          cosLat = denominator * inverseHypot;
+                      };
+                      // the point's own parametric latitude (tan(beta) = a z / (b p)), then that of the first answer
+                      // (tan(beta) = b/a tan(lat))
+                      step(z * a, p * b);
+                      step(b * sinLat, a * cosLat);
+                      latitude = fastAtan2(numerator, denominator);
+                      longitude = fastAtan2(y, x);
+                      height = p * cosLat + z * sinLat - a * std::sqrt(1 - e2 * sinLat * sinLat); });
+}
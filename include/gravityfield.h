@@ -0,0 +1,345 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include "linalg.h"
+#include "physics.h"
+#include "constants.h"
+
+// Earth's gravity as a spherical harmonic series, fully normalized Cnm/Snm coefficients (EGM2008, EIGEN, ...)
+//   U = mu / r sum_n (R / r)^n sum_m Pnm(sin lat) (Cnm cos(m lon) + Snm sin(m lon))
+// the acceleration is the gradient of U summed with Cunningham's V/W recursion in its normalized form: the terms
+// are built from the cartesian position alone, cos(m lon) and sin(m lon) come out of the sectoral recursion, so no
+// trig function is called and nothing diverges at the poles
+// positions and accelerations are Earth fixed (z along the spin axis, x through longitude 0)
+template <typename T = double>
+class GravityField
+{
+private:
+    // what the kernel needs at Vnk, in one cache line: the recursion factors to the next degree and the weights of
+    // Vnk and Wnk in the acceleration, summed over the coefficients of degree n - 1 they feed (orders k - 1, k, k + 1)
+    struct Term
+    {
+        T alpha, beta; // Vn+1,k = alpha z0 Vnk - beta rho^2 Vn-1,k
+        T zv, zw, xv, xw, yv, yw;
+    };
+
+    int maxDegree, maxOrder;
+    T mu, radius;
+    std::vector<T> c, s;          // by index(n, m)
+    std::vector<T> sectoral;      // Vmm from Vm-1,m-1, by m
+    std::vector<T> up, down, inZ; // gradient factors of Cnm against Vn+1,m+1, Vn+1,m-1 and Vn+1,m
+    std::vector<Term> terms;      // by index(n, k) of Vnk
+
+    // V and W go one degree and order past the coefficients; an order's degrees are contiguous, the way they are walked
+    int index(int n, int m) const
+    {
+        return m * (maxDegree + 3) + n;
+    }
+
+    T coefficient(const std::vector<T> &values, int n, int m) const
+    {
+        return m < 0 or m > n ? 0 : values[index(n, m)];
+    }
+
+    // weights of Vnk after a coefficient of degree n - 1 changed
+    void refresh(int n, int k)
+    {
+        if (n < 1 or k < 0 or k > n)
+            return;
+        const int d = n - 1;
+        const T fz = k <= d ? inZ[index(d, k)] : 0;
+        const T fd = k + 1 <= d ? down[index(d, k + 1)] : 0;
+        const T fu = k >= 1 ? up[index(d, k - 1)] : 0;
+        const T cd = fd * coefficient(c, d, k + 1), sd = fd * coefficient(s, d, k + 1);
+        const T cu = fu * coefficient(c, d, k - 1), su = fu * coefficient(s, d, k - 1);
+        Term &t = terms[index(n, k)];
+        t.zv = -fz * coefficient(c, d, k);
+        t.zw = -fz * coefficient(s, d, k);
+        t.xv = cd - cu;
+        t.xw = sd - su;
+        t.yv = sd + su;
+        t.yw = -(cd + cu);
+    }
+
+    void precompute()
+    {
+        const int size = (maxDegree + 3) * (maxDegree + 3);
+        c.assign(size, 0);
+        s.assign(size, 0);
+        c[0] = 1;
+        sectoral.assign(maxDegree + 2, 0);
+        up.assign(size, 0);
+        down.assign(size, 0);
+        inZ.assign(size, 0);
+        terms.assign(size, Term{0, 0, 0, 0, 0, 0, 0, 0});
+        for (int m = 1; m <= maxDegree + 1; m++)
+            sectoral[m] = (T)std::sqrt((m == 1 ? 2.0 : 1.0) * (2 * m + 1) / (2.0 * m));
+        for (int n = 1; n <= maxDegree + 1; n++)
+            for (int m = 0; m < n; m++)
+            {
+                const double dn = n, dm = m;
+                Term &t = terms[index(n - 1, m)];
+                t.alpha = (T)std::sqrt((2 * dn - 1) * (2 * dn + 1) / ((dn - dm) * (dn + dm)));
+                if (n - m >= 2)
+                    t.beta = (T)std::sqrt((2 * dn + 1) * (dn + dm - 1) * (dn - dm - 1) / ((2 * dn - 3) * (dn + dm) * (dn - dm)));
+            }
+        for (int n = 0; n <= maxDegree; n++)
+            for (int m = 0; m <= n; m++)
+            {
+                const double dn = n, dm = m, ratio = (2 * dn + 1) / (2 * dn + 3);
+                // the zonal terms have twice the weight against Vn+1,1 (and no Sn0)
+                up[index(n, m)] = (T)std::sqrt((m == 0 ? 0.5 : 0.25) * ratio * (dn + dm + 1) * (dn + dm + 2));
+                down[index(n, m)] = (T)(0.5 * std::sqrt((m == 1 ? 2.0 : 1.0) * ratio * (dn - dm + 2) * (dn - dm + 1)));
+                inZ[index(n, m)] = (T)std::sqrt(ratio * (dn + dm + 1) * (dn - dm + 1));
+            }
+        for (int k = 0; k <= 1; k++)
+            refresh(1, k);
+    }
+
+    // unnormalized coefficients are scaled by sqrt((2 - d0m)(2n + 1)(n - m)! / (n + m)!)
+    static double normalization(int n, int m)
+    {
+        return std::sqrt((m == 0 ? 1.0 : 2.0) * (2 * n + 1) * std::exp(std::lgamma(n - m + 1.0) - std::lgamma(n + m + 1.0)));
+    }
+
+public:
+    // an empty field (C00 = 1, a point mass) of the given degree and order, coefficients are set one by one
+    GravityField(int degree, int order, T mu = (T)GravityFieldConstants::MU, T radius = (T)GravityFieldConstants::RADIUS)
+        : maxDegree(degree), maxOrder(order), mu(mu), radius(radius)
+    {
+        if (degree < 0 or order < 0 or order > degree)
+            throw std::invalid_argument("Gravity field order must be between 0 and its degree");
+        precompute();
+    }
+
+    // reads the coefficients up to degree and order (order < 0 -> the same as degree) from a text file, either ICGEM
+    // (.gfc: a header closed by end_of_head, then "gfc n m C S ..." lines) or plain "n m C S ..." lines as EGM2008
+    // is distributed; Fortran exponents (1.0D-06) are accepted, terms past degree or order are skipped
+    // mu and the reference radius come from the header, GravityFieldConstants (EGM2008) when it has none
+    GravityField(const std::string &path, int degree, int order = -1)
+        : GravityField(degree, order < 0 ? degree : order)
+    {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("Cannot open gravity field " + path);
+        std::string line;
+        bool unnormalized = false;
+        int lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            lineNumber++;
+            std::istringstream fields(line);
+            std::string first;
+            if (!(fields >> first))
+                continue;
+            if (first == "earth_gravity_constant")
+                fields >> mu;
+            else if (first == "radius")
+                fields >> radius;
+            else if (first == "norm")
+            {
+                std::string norm;
+                fields >> norm;
+                unnormalized = norm == "unnormalized";
+            }
+            else if (first == "gfc" or first == "gfct" or std::isdigit((unsigned char)first[0]))
+            {
+                std::string rest = first == "gfc" or first == "gfct" ? line.substr(line.find(first) + first.size()) : line;
+                std::replace(rest.begin(), rest.end(), 'D', 'e');
+                std::replace(rest.begin(), rest.end(), 'd', 'e');
+                std::istringstream values(rest);
+                int n, m;
+                double cnm, snm;
+                if (!(values >> n >> m >> cnm >> snm) or n < 0 or m < 0 or m > n)
+                    throw std::runtime_error("Malformed gravity field line " + std::to_string(lineNumber) + " in " + path);
+                if (n > maxDegree or m > maxOrder)
+                    continue;
+                if (unnormalized)
+                {
+                    cnm /= normalization(n, m);
+                    snm /= normalization(n, m);
+                }
+                setCoefficient(n, m, (T)cnm, (T)snm);
+            }
+        }
+    }
+
+    int degree() const
+    {
+        return maxDegree;
+    }
+
+    int order() const
+    {
+        return maxOrder;
+    }
+
+    T gravitationalParameter() const
+    {
+        return mu;
+    }
+
+    T referenceRadius() const
+    {
+        return radius;
+    }
+
+    void setCoefficient(int n, int m, T cnm, T snm)
+    {
+        if (n < 0 or n > maxDegree or m < 0 or m > std::min(n, maxOrder))
+            throw std::out_of_range("Gravity field coefficient out of degree or order");
+        c[index(n, m)] = cnm;
+        s[index(n, m)] = m == 0 ? 0 : snm;
+        for (int k = m - 1; k <= m + 1; k++)
+            refresh(n + 1, k);
+    }
+
+    T C(int n, int m) const
+    {
+        return c[index(n, m)];
+    }
+
+    T S(int n, int m) const
+    {
+        return s[index(n, m)];
+    }
+
+    // acceleration at the Earth fixed position (x, y, z) into a
+    // V and W are walked one order k at a time, down the degrees, with only the last two of each kept; every Vnk is
+    // used at once, all the coefficients it feeds folded into its Term
+    void acceleration(T x, T y, T z, T *a) const
+    {
+        const T r2 = x * x + y * y + z * z;
+        const T rho = radius / r2;
+        const T x0 = x * rho, y0 = y * rho, z0 = z * rho, rho2 = radius * rho;
+        T ax = 0, ay = 0, az = 0;
+        T vkk = radius / std::sqrt(r2), wkk = 0; // V00, W00
+        for (int k = 0; k <= maxOrder + 1; k++)
+        {
+            if (k > 0)
+            {
+                const T v = sectoral[k] * (x0 * vkk - y0 * wkk);
+                wkk = sectoral[k] * (x0 * wkk + y0 * vkk);
+                vkk = v;
+            }
+            const Term *t = &terms[index(0, k)];
+            T v = vkk, w = wkk, v1 = 0, w1 = 0; // Vnk and Vn-1,k
+            for (int n = k; n <= maxDegree + 1; n++)
+            {
+                const Term &q = t[n];
+                az += q.zv * v + q.zw * w;
+                ax += q.xv * v + q.xw * w;
+                ay += q.yv * v + q.yw * w;
+                const T a1 = q.alpha * z0, b1 = q.beta * rho2;
+                const T nextV = a1 * v - b1 * v1, nextW = a1 * w - b1 * w1;
+                v1 = v;
+                w1 = w;
+                v = nextV;
+                w = nextW;
+            }
+        }
+        const T scale = mu / (radius * radius);
+        a[0] = scale * ax;
+        a[1] = scale * ay;
+        a[2] = scale * az;
+    }
+
+    Vector3<T> acceleration(const Vector3<T> &position) const
+    {
+        T a[3];
+        acceleration(position.x, position.y, position.z, a);
+        return Vector3<T>(a[0], a[1], a[2]);
+    }
+
+    // potential at the Earth fixed position (the same recursion, Vnm Cnm + Wnm Snm summed), for checks
+    T potential(T x, T y, T z) const
+    {
+        const T r2 = x * x + y * y + z * z;
+        const T rho = radius / r2;
+        const T x0 = x * rho, y0 = y * rho, z0 = z * rho, rho2 = radius * rho;
+        T u = 0;
+        T vkk = radius / std::sqrt(r2), wkk = 0;
+        for (int k = 0; k <= maxOrder; k++)
+        {
+            if (k > 0)
+            {
+                const T v = sectoral[k] * (x0 * vkk - y0 * wkk);
+                wkk = sectoral[k] * (x0 * wkk + y0 * vkk);
+                vkk = v;
+            }
+            T v1 = 0, w1 = 0, v2 = 0, w2 = 0;
+            for (int n = k; n <= maxDegree; n++)
+            {
+                T v = vkk, w = wkk;
+                if (n > k)
+                {
+                    const Term &q = terms[index(n - 1, k)];
+                    const T a1 = q.alpha * z0, b2 = q.beta * rho2;
+                    v = a1 * v1 - b2 * v2;
+                    w = a1 * w1 - b2 * w2;
+                }
+                v2 = v1;
+                w2 = w1;
+                v1 = v;
+                w1 = w;
+                u += c[index(n, k)] * v + s[index(n, k)] * w;
+            }
+        }
+        return mu / radius * u;
+    }
+};
+
+// the state is (x, y, z, vx, vy, vz, t): the solvers integrate autonomous systems only, and the field turns with the
+// Earth, so time rides along as a seventh variable (dt/dt = 1); Earth fixed and inertial axes agree at t = 0
+template <typename T>
+void gravityFieldDerivatives(const GravityField<T> &field, const Matrix<T> &m, Matrix<T> &derivatives)
+{
+    derivatives(0, 0) = m(0, 3);
+    derivatives(0, 1) = m(0, 4);
+    derivatives(0, 2) = m(0, 5);
+    derivatives(0, 6) = 1;
+
+    const T angle = (T)Physics::EARTH_ANGULAR_VELOCITY * m(0, 6);
+    const T cosAngle = std::cos(angle), sinAngle = std::sin(angle);
+    T a[3];
+    field.acceleration(cosAngle * m(0, 0) + sinAngle * m(0, 1), -sinAngle * m(0, 0) + cosAngle * m(0, 1), m(0, 2), a);
+    derivatives(0, 3) = cosAngle * a[0] - sinAngle * a[1];
+    derivatives(0, 4) = sinAngle * a[0] + cosAngle * a[1];
+    derivatives(0, 5) = a[2];
+}
+
+// getFinalPosition in a gravity field instead of a point mass; the solutions have the time as a seventh column
+// escapes and orbits are still recognised from the point mass conic, which the field only perturbs slightly
+template <template <typename> class Solver = RK4, typename T = double>
+RK4Solution<T> getFinalPosition(const GravityField<T> &field, Vector3<T> initialPos, Vector3<T> initialV, T stepSize = (T)Precision<T>::STEP_SIZE,
+                                double maxFlightTime = RK4Constants::MAX_FLIGHT_TIME)
+{
+    Solver<T> solver(stepSize);
+    Matrix<T> initialConditions(1, 7);
+    for (int i = 0; i < 3; i++)
+    {
+        initialConditions(0, i) = initialPos[i];
+        initialConditions(0, 3 + i) = initialV[i];
+    }
+
+    const SolutionStatus status = keplerianStatus(initialPos, initialV, maxFlightTime);
+    if (status != SolutionStatus::EndCondition)
+    {
+        RK4Solution<T> solution(0, stepSize, (T)0, initialConditions);
+        solution.status = status;
+        return solution;
+    }
+    const int maxSteps = (int)std::min((double)RK4Constants::MAX_STEPS, maxFlightTime / (double)stepSize);
+    auto derivatives = [&field](const Matrix<T> &m, Matrix<T> &out)
+    {
+        gravityFieldDerivatives(field, m, out);
+    };
+    return solver.solve(initialConditions, derivatives, maxSteps, objectInsideEarth<T>);
+}
@@ -4,7 +4,9 @@
 #include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <type_traits>
 #include "constants.h" // for flags
+#include "arena.h"
 
 template <typename T>
 class Vector3
@@ -178,12 +180,59 @@ private:
     int cols;
     int rows;
     T *data;
+    MonotonicArena *arena = nullptr; // where data lives, nullptr for the heap
+
+    // new matrices live in the active arena of the thread (see ArenaScope) if there is one
+    void allocate(int n, MonotonicArena *in = activeArena())
+    {
+        if constexpr (std::is_trivial_v<T>)
+        {
+            if (in)
+            {
+                data = static_cast<T *>(in->allocate(n * sizeof(T), alignof(T)));
+                arena = in;
+                return;
+            }
+        }
+        data = new T[n];
+        arena = nullptr;
+        matrixHeapAllocations()++;
+    }
+
+    void release()
+    {
+        if (!arena)
+            delete[] data;
+        data = nullptr;
+    }
+
+    void copyFrom(const Matrix &other)
+    {
+        // the buffer is kept when the size does not change, otherwise the new one comes from the heap: an arena
+        // buffer would belong to the current scope, which may end before this matrix does
+        if (rows * cols != other.rows * other.cols)
+        {
+            release();
+            allocate(other.rows * other.cols, nullptr);
+        }
+        rows = other.rows;
+        cols = other.cols;
+        for (int i = 0; i < rows * cols; i++)
+            data[i] = other.data[i];
+    }
 
 public:
     // normal constructor
-    Matrix(int rows, int cols) : rows(rows), cols(cols)
+    Matrix(int rows, int cols) : cols(cols), rows(rows)
     {
-        data = new T[cols * rows];
+        allocate(cols * rows);
+        for (int i = 0; i < cols * rows; i++)
+            data[i] = (T)0;
+    }
+    // same, in a given arena whatever scope is active (the matrix must not outlive the arena's next rewind)
+    Matrix(int rows, int cols, MonotonicArena &in) : cols(cols), rows(rows)
+    {
+        allocate(cols * rows, &in);
         for (int i = 0; i < cols * rows; i++)
             data[i] = (T)0;
     }
@@ -200,7 +249,7 @@ public:
         }
         rows = v.size();
         cols = v[0].size();
-        data = new T[cols * rows];
+        allocate(cols * rows);
         for (int j = 0; j < rows; j++)
             for (int i = 0; i < cols; i++)
                 (*this)(j, i) = v[j][i];
@@ -211,29 +260,60 @@ public:
     {
         rows = other.rows;
         cols = other.cols;
-        data = new T[rows * cols];
+        allocate(rows * cols);
         for (int i = 0; i < rows * cols; i++)
             data[i] = other.data[i];
     }
 
+    // move constructor, takes the buffer over if it is on the heap or in the active arena (where a new matrix would go
+    // anyway), otherwise copies it to the heap: a buffer from another arena may be given back while this matrix lives
+    Matrix(Matrix &&other) noexcept : cols(other.cols), rows(other.rows), data(other.data), arena(other.arena)
+    {
+        if (arena and arena != activeArena())
+        {
+            allocate(rows * cols, nullptr);
+            for (int i = 0; i < rows * cols; i++)
+                data[i] = other.data[i];
+            return;
+        }
+        other.data = nullptr;
+        other.arena = nullptr;
+        other.rows = other.cols = 0;
+    }
+
     // assignment
     Matrix &operator=(const Matrix &other)
     {
         if (this == &other)
             return *this;
-        delete[] data;
+        copyFrom(other);
+        return *this;
+    }
+
+    // move assignment, heap buffers are taken over, arena ones copied (they may not live as long as this matrix)
+    Matrix &operator=(Matrix &&other)
+    {
+        if (this == &other)
+            return *this;
+        if (other.arena)
+        {
+            copyFrom(other);
+            return *this;
+        }
+        release();
         rows = other.rows;
         cols = other.cols;
-        data = new T[rows * cols];
-        for (int i = 0; i < rows * cols; i++)
-            data[i] = other.data[i];
+        data = other.data;
+        arena = nullptr;
+        other.data = nullptr;
+        other.rows = other.cols = 0;
         return *this;
     }
 
     // get rid of the memory held in data
     ~Matrix()
     {
-        delete[] data;
+        release();
     }
 
     // accessing elements (write)
@@ -0,0 +1,245 @@
+#pragma once
+
+#include <cmath>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "linalg.h"
+#include "physics.h"
+#include "renderer.h"
+#include "ringbuffer.h"
+#include "constants.h"
+
+// live animation of a flight while it is being integrated
+// the integrator thread pushes sampled states into a lock-free ring and never waits: when the ring is full the sample
+// is dropped; the render thread drains the ring at a fixed frame rate, and skips frames when it falls behind
+
+struct LiveViewOptions
+{
+    int width = LiveViewConstants::WIDTH;
+    int height = LiveViewConstants::HEIGHT;
+    double framesPerSecond = LiveViewConstants::FRAMES_PER_SECOND;
+    double sampleInterval = LiveViewConstants::SAMPLE_INTERVAL; // simulated seconds between samples
+    size_t ringCapacity = LiveViewConstants::RING_CAPACITY;
+    double stepSize = RK4Constants::STEP_SIZE;
+};
+
+struct LiveViewStats
+{
+    long long samples = 0;        // pushed by the integrator
+    long long droppedSamples = 0; // lost to a full ring
+    int frames = 0;               // rendered
+    int droppedFrames = 0;        // skipped because the renderer was late
+};
+
+// side view of the flight: orthographic projection on the plane of the launch position and velocity,
+// scaled so the path so far fits, with the Earth below as a sphere
+class TrajectoryProjection
+{
+private:
+    int width, height;
+    Vector3<double> up, forward;
+    double scale = 1;                                              // meters per pixel
+    double range = LiveViewConstants::MIN_VIEW_SIZE, altitude = 0; // extent of the points fitted so far
+    size_t fitted = 0;                                             // points of the path looked at by update
+    // the path drawn so far: every segment is rasterized once into its own canvas and the pixels it covers are copied
+    // into the object the renderer draws, only a change of scale draws them all again
+    Canvas trailCanvas;
+    RenderObject trailObject;
+    int trailStamp = 0;
+    size_t drawn = 0; // points of the path in trailCanvas
+
+    double screenX(const Vector3<double> &p) const
+    {
+        return LiveViewConstants::MARGIN + (p * forward) / scale;
+    }
+
+    double screenY(const Vector3<double> &p) const
+    {
+        return height - LiveViewConstants::MARGIN - (p * up - Physics::EARTH_RADIUS) / scale;
+    }
+
+    void drawSegment(const Vector3<double> &a, const Vector3<double> &b)
+    {
+        const double x1 = screenX(a), y1 = screenY(a), x2 = screenX(b), y2 = screenY(b);
+        trailCanvas.line(x1, y1, x2, y2, 1, 1, trailCanvas.area(), trailStamp);
+        // the pixels a line can touch, as RenderObject bounds them
+        const int x0 = std::max(0, (int)std::floor(std::min(x1, x2)) - 1), xEnd = std::min(width, (int)std::ceil(std::max(x1, x2)) + 1);
+        const int y0 = std::max(0, (int)std::floor(std::min(y1, y2)) - 1), yEnd = std::min(height, (int)std::ceil(std::max(y1, y2)) + 1);
+        for (int j = y0; j < yEnd; j++)
+            for (int i = x0; i < xEnd; i++)
+                if (trailCanvas.getRendist(i, j) >= 0)
+                    trailObject.set(i, j, trailCanvas.getData(i, j), trailCanvas.getRendist(i, j));
+    }
+
+public:
+    TrajectoryProjection(int w, int h, const Vector3<double> &initialPos, const Vector3<double> &initialV)
+        : width(w), height(h), trailCanvas(w, h), trailObject(w, h)
+    {
+        up = (1 / initialPos.r()) * initialPos;
+        forward = initialV - (initialV * up) * up;
+        forward = (forward.r() > 0) ? (1 / forward.r()) * forward : cross(Vector3<double>(0, 0, 1), up);
+        forward = (1 / forward.r()) * forward;
+    }
+
+    // takes in the points added to path since the last call (path only ever grows): grows the scale until every point
+    // fits (it never shrinks, so the picture does not jump back and forth) and draws the new segments into trail();
+    // when the scale changed every segment moves, so the whole path is projected and drawn again
+    void update(const std::vector<Vector3<double>> &path)
+    {
+        for (; fitted < path.size(); fitted++)
+        {
+            range = std::max(range, path[fitted] * forward);
+            altitude = std::max(altitude, path[fitted] * up - Physics::EARTH_RADIUS);
+        }
+        const double previous = scale;
+        scale = std::max({scale, range / (width - 2 * LiveViewConstants::MARGIN), altitude / (height - 2 * LiveViewConstants::MARGIN)});
+        if (scale != previous)
+        {
+            trailCanvas.clear();
+            trailStamp = trailCanvas.newStamps(1);
+            trailObject = RenderObject(width, height);
+            drawn = 0;
+        }
+        for (size_t i = std::max<size_t>(drawn, 1); i < path.size(); i++)
+            drawSegment(path[i - 1], path[i]);
+        drawn = path.size();
+    }
+
+    // the Earth, behind everything else
+    RenderObject earth() const
+    {
+        const double r = Physics::EARTH_RADIUS / scale;
+        return RenderObject::Sphere(width, height, LiveViewConstants::MARGIN, height - LiveViewConstants::MARGIN + r, r, r + 10);
+    }
+
+    // the path as of the last update, it stays valid (and unchanged) until the next one
+    RenderObject &trail()
+    {
+        return trailObject;
+    }
+
+    // the object itself, drawn over its path
+    RenderObject head(const Vector3<double> &p) const
+    {
+        return RenderObject::Circle(width, height, screenX(p), screenY(p), 1, 0.5);
+    }
+
+    // a whole path from scratch at the current scale, with the head at its end; looks the same as trail() and head()
+    // after an update with the same points
+    RenderObject path(const std::vector<Vector3<double>> &points) const
+    {
+        std::vector<double> x, y, rndt;
+        for (const Vector3<double> &p : points)
+        {
+            x.push_back(screenX(p));
+            y.push_back(screenY(p));
+            rndt.push_back(1);
+        }
+        RenderObject o = RenderObject::Multiline(width, height, x, y, rndt);
+        if (!points.empty())
+        {
+            RenderObject end = head(points.back());
+            o.merge(&end);
+        }
+        return o;
+    }
+};
+
+// solver observer (see SolverStep) on the integrator thread: pushes the position of the first accepted state at or past
+// every multiple of interval into ring, dropping it when the ring is full
+class LiveViewSampler
+{
+private:
+    SPSCRing<Vector3<double>> &ring;
+    LiveViewStats &stats;
+    double interval;
+    long long sampled = 0; // multiples of interval reached so far
+
+public:
+    LiveViewSampler(SPSCRing<Vector3<double>> &ring, LiveViewStats &stats, double interval) : ring(ring), stats(stats), interval(interval) {}
+
+    void onStep(const SolverStep<double> &step)
+    {
+        const long long reached = (long long)std::floor(step.time / interval + 1e-9);
+        if (reached <= sampled)
+            return;
+        sampled = reached;
+        const Matrix<double> &m = step.state;
+        if (ring.tryPush(Vector3<double>(m(0, 0), m(0, 1), m(0, 2))))
+            stats.samples++;
+        else
+            stats.droppedSamples++;
+    }
+};
+
+// integrates the flight on a separate thread while drawing it, frames go to output (the terminal by default)
+// returns the same solution as getFinalPosition<Solver> with the same step
+template <template <typename> class Solver = RK4>
+RK4Solution<double> animateTrajectory(Vector3<double> initialPos, Vector3<double> initialV, const LiveViewOptions &options = LiveViewOptions(),
+                                      LiveViewStats *stats = nullptr, const std::function<void(const std::string &)> &output = writeToTerminal)
+{
+    LiveViewStats local;
+    LiveViewStats &s = stats ? *stats : local;
+    s = LiveViewStats();
+
+    SPSCRing<Vector3<double>> ring(options.ringCapacity);
+    std::atomic<bool> done(false);
+    RK4Solution<double> solution(0, options.stepSize, 0.0, Matrix<double>(1, 6));
+
+    auto integrate = [&]()
+    {
+        LiveViewSampler sampler(ring, s, options.sampleInterval);
+        solution = getFinalPosition<Solver, double>(initialPos, initialV, options.stepSize, RK4Constants::MAX_FLIGHT_TIME, sampler);
+        done.store(true, std::memory_order_release);
+    };
+    std::thread integrator(integrate);
+
+    Renderer renderer(options.width, options.height);
+    TrajectoryProjection projection(options.width, options.height, initialPos, initialV);
+    std::vector<Vector3<double>> path = {initialPos};
+    const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1 / options.framesPerSecond));
+    auto next = std::chrono::steady_clock::now();
+    while (true)
+    {
+        // done is read before draining, so once it is seen every sample is already in the ring
+        const bool finished = done.load(std::memory_order_acquire);
+        Vector3<double> p;
+        while (ring.tryPop(p))
+            path.push_back(p);
+        if (finished)
+        {
+            // the final state comes from the solution itself, it is never lost to a full ring
+            const Matrix<double> &last = solution.solutions;
+            path.push_back(Vector3<double>(last(0, 0), last(0, 1), last(0, 2)));
+        }
+
+        projection.update(path);
+        RenderObject earth = projection.earth();
+        RenderObject head = projection.head(path.back());
+        renderer.addObjectToBuffer(&earth);
+        renderer.addObjectToBuffer(&projection.trail());
+        renderer.addObjectToBuffer(&head);
+        output(renderer.composeFrame());
+        s.frames++;
+        if (finished)
+            break;
+
+        next += period;
+        const auto now = std::chrono::steady_clock::now();
+        if (now > next)
+        {
+            // late: the frames that should have been shown meanwhile are skipped, not caught up on
+            const int late = (int)((now - next) / period);
+            s.droppedFrames += late;
+            next += late * period;
+        }
+        std::this_thread::sleep_until(next);
+    }
+    integrator.join();
+    return solution;
+}
@@ -0,0 +1,383 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include "linalg.h"
+#include "physics.h"
+#include "constants.h"
+
+// Monte Carlo landing dispersion: the launch speed and angles are perturbed around their nominal values and every
+// sample is landed, the statistics are accumulated on the fly so memory does not grow with the number of samples
+//
+// reproducibility: sample i only depends on (seed, i) through a counter based generator, samples are grouped in
+// fixed blocks and the blocks are merged in block order, so the result is bit for bit the same for any thread count
+
+// counter based random numbers: the k-th draw of sample i is a hash of (seed, i, k), no state is carried between draws
+class CounterRNG
+{
+private:
+    std::uint64_t key;
+
+    static std::uint64_t mix(std::uint64_t z)
+    {
+        // splitmix64 finalizer
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+public:
+    CounterRNG(std::uint64_t seed) : key(mix(seed + 0x9E3779B97F4A7C15ULL)) {}
+
+    std::uint64_t bits(std::uint64_t sample, std::uint64_t draw) const
+    {
+        return mix(mix(key ^ sample) + (draw + 1) * 0x9E3779B97F4A7C15ULL);
+    }
+
+    // uniform in (0, 1), never exactly 0 or 1
+    double uniform(std::uint64_t sample, std::uint64_t draw) const
+    {
+        return ((bits(sample, draw) >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    }
+
+    // standard normal (Box-Muller), uses draws 2 * pair and 2 * pair + 1
+    double normal(std::uint64_t sample, std::uint64_t pair) const
+    {
+        const double u1 = uniform(sample, 2 * pair), u2 = uniform(sample, 2 * pair + 1);
+        return std::sqrt(-2 * std::log(u1)) * std::cos(2 * Math::pi * u2);
+    }
+};
+
+enum class DistributionKind
+{
+    Normal, // spread is the standard deviation
+    Uniform // spread is the half width
+};
+
+struct Dispersion
+{
+    DistributionKind kind = DistributionKind::Normal;
+    double spread = 0;
+
+    double sample(const CounterRNG &rng, std::uint64_t sample, std::uint64_t pair) const
+    {
+        if (spread == 0)
+            return 0;
+        if (kind == DistributionKind::Uniform)
+            return spread * (2 * rng.uniform(sample, 2 * pair) - 1);
+        return spread * rng.normal(sample, pair);
+    }
+};
+
+struct MonteCarloInputs
+{
+    double latitude, longitude;                // launch site, degrees
+    double speed, eastAngle, groundAngle;      // nominal launch, m/s and degrees (0 facing east, counterclockwise)
+    Dispersion speedError, eastAngleError, groundAngleError;
+};
+
+// landing of one sample in the tangent plane of the nominal landing point (meters east and north of it)
+struct LandingSample
+{
+    bool landed;
+    double east, north, time;
+};
+
+// running mean and covariance of (east, north) and mean and variance of the flight time (Welford, merged with Chan's formulas)
+struct LandingMoments
+{
+    long long n = 0;
+    double meanEast = 0, meanNorth = 0, meanTime = 0;
+    double m2East = 0, m2North = 0, cEastNorth = 0, m2Time = 0;
+
+    void add(double east, double north, double time)
+    {
+        n++;
+        const double dEast = east - meanEast, dNorth = north - meanNorth, dTime = time - meanTime;
+        meanEast += dEast / n;
+        meanNorth += dNorth / n;
+        meanTime += dTime / n;
+        m2East += dEast * (east - meanEast);
+        m2North += dNorth * (north - meanNorth);
+        cEastNorth += dEast * (north - meanNorth);
+        m2Time += dTime * (time - meanTime);
+    }
+
+    void merge(const LandingMoments &other)
+    {
+        if (other.n == 0)
+            return;
+        if (n == 0)
+        {
+            *this = other;
+            return;
+        }
+        const double total = n + other.n;
+        const double weight = (double)n * other.n / total;
+        const double dEast = other.meanEast - meanEast, dNorth = other.meanNorth - meanNorth, dTime = other.meanTime - meanTime;
+        m2East += other.m2East + dEast * dEast * weight;
+        m2North += other.m2North + dNorth * dNorth * weight;
+        cEastNorth += other.cEastNorth + dEast * dNorth * weight;
+        m2Time += other.m2Time + dTime * dTime * weight;
+        meanEast += dEast * other.n / total;
+        meanNorth += dNorth * other.n / total;
+        meanTime += dTime * other.n / total;
+        n += other.n;
+    }
+};
+
+// histogram of the miss distance with logarithmic bins, fixed size whatever the sample count
+// percentiles are resolved to a bin, a relative error of about (MAX_MISS / MIN_MISS)^(1 / BINS) ~ 4%
+struct MissHistogram
+{
+    std::vector<long long> counts = std::vector<long long>(MonteCarloConstants::HISTOGRAM_BINS + 2, 0);
+
+    static int bin(double distance)
+    {
+        // bin 0 is below MIN_MISS, the last one above MAX_MISS
+        if (distance < MonteCarloConstants::MIN_MISS)
+            return 0;
+        const double position = std::log(distance / MonteCarloConstants::MIN_MISS) /
+                                std::log(MonteCarloConstants::MAX_MISS / MonteCarloConstants::MIN_MISS);
+        return std::min(MonteCarloConstants::HISTOGRAM_BINS + 1, 1 + (int)(position * MonteCarloConstants::HISTOGRAM_BINS));
+    }
+
+    static double edge(double bins)
+    {
+        return MonteCarloConstants::MIN_MISS *
+               std::pow(MonteCarloConstants::MAX_MISS / MonteCarloConstants::MIN_MISS, bins / MonteCarloConstants::HISTOGRAM_BINS);
+    }
+
+    void add(double distance)
+    {
+        counts[bin(distance)]++;
+    }
+
+    void merge(const MissHistogram &other)
+    {
+        for (size_t i = 0; i < counts.size(); i++)
+            counts[i] += other.counts[i];
+    }
+
+    // distance below which a fraction p of the samples fall, interpolated geometrically inside the bin
+    double percentile(double p) const
+    {
+        long long total = 0;
+        for (long long c : counts)
+            total += c;
+        if (total == 0)
+            return 0;
+        const double target = p * total;
+        double below = 0;
+        for (int i = 0; i < (int)counts.size(); i++)
+        {
+            if (counts[i] > 0 and below + counts[i] >= target)
+            {
+                if (i == 0)
+                    return MonteCarloConstants::MIN_MISS;
+                if (i == (int)counts.size() - 1)
+                    return MonteCarloConstants::MAX_MISS;
+                return edge(i - 1 + (target - below) / counts[i]);
+            }
+            below += counts[i];
+        }
+        return MonteCarloConstants::MAX_MISS;
+    }
+};
+
+struct DispersionStats
+{
+    long long samples = 0;
+    long long landed = 0; // the rest escape, orbit or fly longer than the flight time cap
+    double nominalLatitude = 0, nominalLongitude = 0, nominalTime = 0; // unperturbed landing, degrees and s
+    LandingMoments moments;
+    MissHistogram miss; // distance from the nominal landing point
+
+    double varianceEast() const
+    {
+        return moments.n > 1 ? moments.m2East / (moments.n - 1) : 0;
+    }
+
+    double varianceNorth() const
+    {
+        return moments.n > 1 ? moments.m2North / (moments.n - 1) : 0;
+    }
+
+    double covarianceEastNorth() const
+    {
+        return moments.n > 1 ? moments.cEastNorth / (moments.n - 1) : 0;
+    }
+
+    double stdDevTime() const
+    {
+        return moments.n > 1 ? std::sqrt(moments.m2Time / (moments.n - 1)) : 0;
+    }
+
+    // one sigma dispersion ellipse: semi axes (m) and angle of the major axis (degrees, counterclockwise from east)
+    double ellipseMajor() const
+    {
+        const double mid = (varianceEast() + varianceNorth()) / 2;
+        return std::sqrt(std::max(0.0, mid + ellipseSpread()));
+    }
+
+    double ellipseMinor() const
+    {
+        const double mid = (varianceEast() + varianceNorth()) / 2;
+        return std::sqrt(std::max(0.0, mid - ellipseSpread()));
+    }
+
+    double ellipseAngle() const
+    {
+        return 90 / Math::pi * std::atan2(2 * covarianceEastNorth(), varianceEast() - varianceNorth());
+    }
+
+    // circular error probable: radius around the nominal landing point holding half of the landed samples
+    double cep() const
+    {
+        return miss.percentile(0.5);
+    }
+
+private:
+    double ellipseSpread() const
+    {
+        const double half = (varianceEast() - varianceNorth()) / 2;
+        return std::sqrt(half * half + covarianceEastNorth() * covarianceEastNorth());
+    }
+};
+
+// lands the launch defined by inputs (no perturbation) and the tangent frame at its landing point
+struct DispersionFrame
+{
+    double lat, lon; // launch site, radians
+    Vector3<double> initialPos;
+    bool landed;
+    Vector3<double> landing, east, north; // Earth fixed landing point and its local east and north
+    double time;
+};
+
+inline Vector3<double> launchVelocity(const DispersionFrame &frame, double speed, double eastAngle, double groundAngle)
+{
+    eastAngle *= Math::pi / 180;
+    groundAngle *= Math::pi / 180;
+    return localToInertial(frame.lat, frame.lon, speed * Vector3<double>(std::cos(groundAngle) * std::cos(eastAngle),
+                                                                         std::cos(groundAngle) * std::sin(eastAngle),
+                                                                         std::sin(groundAngle)));
+}
+
+inline Vector3<double> earthFixedLanding(const RK4Solution<double> &sol)
+{
+    // undo the rotation of the Earth during the flight
+    const double angle = -Physics::EARTH_ANGULAR_VELOCITY * sol.time;
+    const double x = sol.solutions(0, 0), y = sol.solutions(0, 1);
+    return Vector3<double>(std::cos(angle) * x - std::sin(angle) * y, std::sin(angle) * x + std::cos(angle) * y, sol.solutions(0, 2));
+}
+
+inline DispersionFrame dispersionFrame(const MonteCarloInputs &inputs, double stepSize)
+{
+    DispersionFrame frame;
+    frame.lat = inputs.latitude * Math::pi / 180;
+    frame.lon = inputs.longitude * Math::pi / 180;
+    frame.initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, frame.lon, Math::pi / 2 - frame.lat);
+    RK4Solution<double> sol = getFinalPosition<ABM>(frame.initialPos, launchVelocity(frame, inputs.speed, inputs.eastAngle, inputs.groundAngle), stepSize);
+    frame.landed = sol.status == SolutionStatus::EndCondition;
+    frame.time = sol.time;
+    frame.landing = earthFixedLanding(sol);
+    const Vector3<double> up = (1 / frame.landing.r()) * frame.landing;
+    frame.east = cross(Vector3<double>(0, 0, 1), up);
+    frame.east = (1 / frame.east.r()) * frame.east;
+    frame.north = cross(up, frame.east);
+    return frame;
+}
+
+// sample i of the analysis, a pure function of (inputs, seed, i)
+inline LandingSample dispersionSample(const MonteCarloInputs &inputs, const DispersionFrame &frame, const CounterRNG &rng,
+                                      std::uint64_t i, double stepSize)
+{
+    const double speed = inputs.speed + inputs.speedError.sample(rng, i, 0);
+    const double eastAngle = inputs.eastAngle + inputs.eastAngleError.sample(rng, i, 1);
+    const double groundAngle = inputs.groundAngle + inputs.groundAngleError.sample(rng, i, 2);
+    RK4Solution<double> sol = getFinalPosition<ABM>(frame.initialPos, launchVelocity(frame, speed, eastAngle, groundAngle), stepSize);
+    if (sol.status != SolutionStatus::EndCondition)
+        return {false, 0, 0, 0};
+    const Vector3<double> offset = earthFixedLanding(sol) - frame.landing;
+    return {true, offset * frame.east, offset * frame.north, sol.time};
+}
+
+// runs samples launches on threads workers (0 -> hardware concurrency)
+inline DispersionStats runMonteCarlo(const MonteCarloInputs &inputs, long long samples, std::uint64_t seed, int threads = 0,
+                                     double stepSize = MonteCarloConstants::STEP_SIZE)
+{
+    const DispersionFrame frame = dispersionFrame(inputs, stepSize);
+    if (!frame.landed)
+        throw std::invalid_argument("The nominal launch does not land");
+
+    const CounterRNG rng(seed);
+    const long long blocks = (samples + MonteCarloConstants::BLOCK_SIZE - 1) / MonteCarloConstants::BLOCK_SIZE;
+
+    DispersionStats stats;
+    stats.samples = samples;
+    const Vector3<double> landing = frame.landing;
+    stats.nominalLatitude = 90 - 180 / Math::pi * landing.phi();
+    stats.nominalLongitude = 180 / Math::pi * landing.theta();
+    stats.nominalTime = frame.time;
+
+    // finished blocks wait here until every block before them is merged, blocks are handed out in order so only
+    // about one block per thread is ever waiting
+    struct Block
+    {
+        long long landed = 0;
+        LandingMoments moments;
+        MissHistogram miss;
+    };
+    std::map<long long, Block> finished;
+    long long nextToMerge = 0;
+    std::mutex mergeMutex;
+    std::atomic<long long> nextBlock(0);
+
+    auto worker = [&]()
+    {
+        for (long long b = nextBlock++; b < blocks; b = nextBlock++)
+        {
+            Block block;
+            const long long end = std::min(samples, (b + 1) * MonteCarloConstants::BLOCK_SIZE);
+            for (long long i = b * MonteCarloConstants::BLOCK_SIZE; i < end; i++)
+            {
+                LandingSample s = dispersionSample(inputs, frame, rng, i, stepSize);
+                if (!s.landed)
+                    continue;
+                block.landed++;
+                block.moments.add(s.east, s.north, s.time);
+                block.miss.add(std::sqrt(s.east * s.east + s.north * s.north));
+            }
+
+            std::lock_guard<std::mutex> lock(mergeMutex);
+            finished.emplace(b, std::move(block));
+            for (auto it = finished.find(nextToMerge); it != finished.end(); it = finished.find(nextToMerge))
+            {
+                stats.landed += it->second.landed;
+                stats.moments.merge(it->second.moments);
+                stats.miss.merge(it->second.miss);
+                finished.erase(it);
+                nextToMerge++;
+            }
+        }
+    };
+
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = (int)std::max(1LL, std::min((long long)threads, blocks));
+    std::vector<std::thread> workers;
+    for (int t = 1; t < threads; t++)
+        workers.emplace_back(worker);
+    worker();
+    for (std::thread &w : workers)
+        w.join();
+    return stats;
+}
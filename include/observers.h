@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include "linalg.h"
+#include "rk4.h"
+#include "constants.h"
+
+// built-in solver observers (see SolverStep): hand any of them to solve or getFinalPosition after endCondition,
+// they start over on every solve (step index 0) and hold their result once it returns
+// states are (x, y, z, vx, vy, vz) as the trajectory solvers use
+
+template <typename T>
+T stepRadius(const SolverStep<T> &step)
+{
+    const Matrix<T> &y = step.state;
+    return std::sqrt(y(0, 0) * y(0, 0) + y(0, 1) * y(0, 1) + y(0, 2) * y(0, 2));
+}
+
+template <typename T>
+T stepSpeed(const SolverStep<T> &step)
+{
+    const Matrix<T> &y = step.state;
+    return std::sqrt(y(0, 3) * y(0, 3) + y(0, 4) * y(0, 4) + y(0, 5) * y(0, 5));
+}
+
+// highest point of the flight; when the radial velocity turns negative between two steps the top is taken from the
+// cubic through both states (radius and radial velocity at each end), so it does not depend on where the steps fall
+template <typename T = double>
+class ApogeeObserver
+{
+private:
+    T previousTime = 0, previousRadius = 0, previousRadialVelocity = 0;
+
+public:
+    T time = 0;
+    T radius = 0;
+
+    T altitude() const
+    {
+        return radius - (T)Physics::EARTH_RADIUS;
+    }
+
+    void onStep(const SolverStep<T> &step)
+    {
+        const Matrix<T> &y = step.state;
+        const T r = stepRadius(step);
+        const T radialVelocity = (y(0, 0) * y(0, 3) + y(0, 1) * y(0, 4) + y(0, 2) * y(0, 5)) / r;
+        if (step.index == 0 or r > radius)
+        {
+            time = step.time;
+            radius = r;
+        }
+        if (step.index > 0 and previousRadialVelocity > 0 and radialVelocity <= 0)
+        {
+            // p(s) = a s^3 + b s^2 + m0 s + r0 on s in [0, 1], its top is where p'(s) = 3a s^2 + 2b s + m0 = 0
+            const T h = step.time - previousTime;
+            const T m0 = previousRadialVelocity * h, m1 = radialVelocity * h;
+            const T a = 2 * (previousRadius - r) + m0 + m1;
+            const T b = 3 * (r - previousRadius) - 2 * m0 - m1;
+            T s;
+            if (std::abs(a) < std::numeric_limits<T>::epsilon() * std::abs(b))
+                s = -m0 / (2 * b);
+            else
+            {
+                // the root where p' goes from positive to negative, written to avoid cancellation
+                const T discriminant = std::max((T)0, b * b - 3 * a * m0);
+                const T q = -(b + std::copysign(std::sqrt(discriminant), b));
+                const T s1 = q / (3 * a), s2 = m0 / q;
+                s = (s1 >= 0 and s1 <= 1) ? s1 : s2;
+            }
+            if (s >= 0 and s <= 1)
+            {
+                const T top = ((a * s + b) * s + m0) * s + previousRadius;
+                if (top > radius)
+                {
+                    radius = top;
+                    time = previousTime + s * h;
+                }
+            }
+        }
+        previousTime = step.time;
+        previousRadius = r;
+        previousRadialVelocity = radialVelocity;
+    }
+};
+
+// smallest and largest value of any quantity of the steps, and when they happen
+// Quantity is called as T(const SolverStep<T> &), e.g. stepSpeed<T> or stepRadius<T>
+template <typename T, typename Quantity>
+class MinMaxObserver
+{
+private:
+    Quantity quantity;
+
+public:
+    T min = 0, max = 0;
+    T minTime = 0, maxTime = 0;
+
+    MinMaxObserver(Quantity q) : quantity(q) {}
+
+    void onStep(const SolverStep<T> &step)
+    {
+        const T value = quantity(step);
+        if (step.index == 0 or value < min)
+        {
+            min = value;
+            minTime = step.time;
+        }
+        if (step.index == 0 or value > max)
+        {
+            max = value;
+            maxTime = step.time;
+        }
+    }
+};
+
+template <typename T = double, typename Quantity>
+MinMaxObserver<T, Quantity> makeMinMaxObserver(Quantity quantity)
+{
+    return MinMaxObserver<T, Quantity>(quantity);
+}
+
+// specific orbital energy (v^2 / 2 - mu / r), which point mass gravity conserves: how far the integration drifts
+template <typename T = double>
+class EnergyObserver
+{
+private:
+    T mu;
+
+public:
+    T initial = 0;
+    T latest = 0;   // at the last step
+    T maxDrift = 0; // largest |energy - initial| seen
+
+    EnergyObserver(T mu = (T)(Physics::G * Physics::EARTH_MASS)) : mu(mu) {}
+
+    void onStep(const SolverStep<T> &step)
+    {
+        const T v = stepSpeed(step);
+        latest = v * v / 2 - mu / stepRadius(step);
+        if (step.index == 0)
+        {
+            initial = latest;
+            maxDrift = 0;
+        }
+        maxDrift = std::max(maxDrift, std::abs(latest - initial));
+    }
+
+    T relativeDrift() const
+    {
+        return maxDrift / std::abs(initial);
+    }
+};
+
+// keeps every n-th state and the last one (ground tracks, plots), times and states row by row
+template <typename T = double>
+class DecimatingRecorder
+{
+private:
+    int every;
+
+public:
+    std::vector<T> times;
+    std::vector<T> states;
+
+    DecimatingRecorder(int every = 1) : every(every)
+    {
+        if (every < 1)
+            throw std::invalid_argument("DecimatingRecorder keeps at least every state");
+    }
+
+    void onStep(const SolverStep<T> &step)
+    {
+        if (step.index == 0)
+        {
+            times.clear();
+            states.clear();
+        }
+        if (step.index % every != 0 and !step.last)
+            return;
+        times.push_back(step.time);
+        for (int i = 0; i < step.state.getCols(); i++)
+            states.push_back(step.state(0, i));
+    }
+
+    int size() const
+    {
+        return (int)times.size();
+    }
+};
@@ -1,40 +1,56 @@
 #pragma once
 
 #include <cmath>
+#include <algorithm>
 #include "linalg.h"
 #include "rk4.h"
+#include "abm.h"
+#include "denseoutput.h"
 #include "constants.h"
 
-Vector3<double> spinningv(double lat, double lon)
+template <typename T>
+Vector3<T> spinningv(T lat, T lon)
 {
     // returns the velocity vector of the point on Earth in the intertial frame of reference
-    return cross(Vector3<double>(0, 0, Physics::EARTH_ANGULAR_VELOCITY),
-                 Physics::EARTH_RADIUS * Vector3<double>(cos(lat) * cos(lon),
-                                                         cos(lat) * sin(lon),
-                                                         sin(lat)));
+    return cross(Vector3<T>(0, 0, (T)Physics::EARTH_ANGULAR_VELOCITY),
+                 (T)Physics::EARTH_RADIUS * Vector3<T>(std::cos(lat) * std::cos(lon),
+                                                       std::cos(lat) * std::sin(lon),
+                                                       std::sin(lat)));
 }
 
-Vector3<double> localToInertial(double lat, double lon, Vector3<double> v)
+template <typename T>
+Matrix<T> localFrame(T lat, T lon)
 {
-    // latitude and longitue in radians
-    Matrix<double> m({{-sin(lon), cos(lon), 0},
-                      {-sin(lat) * cos(lon), -sin(lat) * sin(lon), cos(lat)},
-                      {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)}});
-
-    return m.transpose() * v + spinningv(lat, lon);
+    // rows are the east, north and up unit vectors at (lat, lon) in radians, built in place (no nested vectors)
+    const T sinLat = std::sin(lat), cosLat = std::cos(lat), sinLon = std::sin(lon), cosLon = std::cos(lon);
+    Matrix<T> m(3, 3);
+    m(0, 0) = -sinLon;
+    m(0, 1) = cosLon;
+    m(1, 0) = -sinLat * cosLon;
+    m(1, 1) = -sinLat * sinLon;
+    m(1, 2) = cosLat;
+    m(2, 0) = cosLat * cosLon;
+    m(2, 1) = cosLat * sinLon;
+    m(2, 2) = sinLat;
+    return m;
 }
 
-Vector3<double> inertialToLocal(double lat, double lon, Vector3<double> v)
+template <typename T>
+Vector3<T> localToInertial(T lat, T lon, Vector3<T> v)
 {
     // latitude and longitue in radians
-    Matrix<double> m({{-sin(lon), cos(lon), 0},
-                      {-sin(lat) * cos(lon), -sin(lat) * sin(lon), cos(lat)},
-                      {cos(lat) * cos(lon), cos(lat) * sin(lon), sin(lat)}});
+    return localFrame(lat, lon).transpose() * v + spinningv(lat, lon);
+}
 
-    return m * (v - spinningv(lat, lon));
+template <typename T>
+Vector3<T> inertialToLocal(T lat, T lon, Vector3<T> v)
+{
+    // latitude and longitue in radians
+    return localFrame(lat, lon) * (v - spinningv(lat, lon));
 }
 
-void gravitationalDerivatives(const Matrix<double> &m, Matrix<double> &derivatives)
+template <typename T>
+void gravitationalDerivatives(const Matrix<T> &m, Matrix<T> &derivatives)
 {
     // for x, y and z they are vx, vy and vz
     derivatives(0, 0) = m(0, 3);
@@ -42,24 +58,66 @@ void gravitationalDerivatives(const Matrix<double> &m, Matrix<double> &derivativ
     derivatives(0, 2) = m(0, 5);
 
     // for vx, vy and vz they are the usual ones
-    const double r = sqrt(m(0, 0) * m(0, 0) + m(0, 1) * m(0, 1) + m(0, 2) * m(0, 2));
-    const double factor = -Physics::G * Physics::EARTH_MASS / (r * r * r);
+    const T r = std::sqrt(m(0, 0) * m(0, 0) + m(0, 1) * m(0, 1) + m(0, 2) * m(0, 2));
+    const T factor = (T)(-Physics::G * Physics::EARTH_MASS) / (r * r * r);
     derivatives(0, 3) = factor * m(0, 0);
     derivatives(0, 4) = factor * m(0, 1);
     derivatives(0, 5) = factor * m(0, 2);
 }
 
-bool objectInsideEarth(const Matrix<double> &m)
+template <typename T>
+bool objectInsideEarth(const Matrix<T> &m)
 {
     // matrix to be passed is the one used in rk4
     return m(0, 0) * m(0, 0) + m(0, 1) * m(0, 1) + m(0, 2) * m(0, 2) <
-           Physics::EARTH_RADIUS * Physics::EARTH_RADIUS;
+           (T)(Physics::EARTH_RADIUS * Physics::EARTH_RADIUS);
 }
 
-RK4Solution getFinalPosition(Vector3<double> initialPos, Vector3<double> initialV)
+template <typename T>
+SolutionStatus keplerianStatus(const Vector3<T> &pos, const Vector3<T> &v, double maxFlightTime)
 {
-    RK4 solver(RK4Constants::STEP_SIZE);
-    Matrix<double> initialConditions(1, 6);
+    // under point mass gravity the conic is known from the initial state, so trajectories that never come back down
+    // are recognised before integrating:
+    //   positive specific energy -> Escape
+    //   periapsis above the surface -> Orbit
+    //   surface reached later than maxFlightTime (Kepler's equation) -> MaxSteps
+    const double mu = Physics::G * Physics::EARTH_MASS;
+    const Vector3<double> r((double)pos.x, (double)pos.y, (double)pos.z), vel((double)v.x, (double)v.y, (double)v.z);
+    const double r0 = r.r();
+    const double energy = vel.r2() / 2 - mu / r0;
+    if (energy >= 0)
+        return SolutionStatus::Escape;
+    const double a = -mu / (2 * energy);
+    const double e = std::sqrt(std::max(0.0, 1 + 2 * energy * cross(r, vel).r2() / (mu * mu)));
+    if (a * (1 - e) > Physics::EARTH_RADIUS)
+        return SolutionStatus::Orbit;
+    if (e < 1e-12 or r0 < Physics::EARTH_RADIUS)
+        return SolutionStatus::EndCondition;
+
+    // eccentric anomalies now and at the descending crossing of the surface, r = a (1 - e cos E)
+    double E0 = std::acos(std::clamp((1 - r0 / a) / e, -1.0, 1.0));
+    if (r * vel < 0)
+        E0 = 2 * Math::pi - E0;
+    double E1 = 2 * Math::pi - std::acos(std::clamp((1 - Physics::EARTH_RADIUS / a) / e, -1.0, 1.0));
+    if (E1 < E0)
+        E1 += 2 * Math::pi;
+    const double flightTime = ((E1 - e * std::sin(E1)) - (E0 - e * std::sin(E0))) * std::sqrt(a * a * a / mu);
+    if (flightTime > maxFlightTime)
+        return SolutionStatus::MaxSteps;
+    return SolutionStatus::EndCondition;
+}
+
+// Solver is any integrator with the RK4 interface (RK4, ABM), T the scalar type it integrates in
+// check status before using the final position: escaping, orbiting and too long (> maxFlightTime) trajectories are
+// returned at once, unintegrated, with their initial conditions
+// observers (SolverStep, observers.h, DenseTrajectory) are handed to the solver and see every accepted state; they see
+// nothing when the flight is not integrated
+template <template <typename> class Solver = RK4, typename T = double, typename... Observers>
+RK4Solution<T> getFinalPosition(Vector3<T> initialPos, Vector3<T> initialV, T stepSize = (T)Precision<T>::STEP_SIZE, double maxFlightTime = RK4Constants::MAX_FLIGHT_TIME,
+                                Observers &...observers)
+{
+    Solver<T> solver(stepSize);
+    Matrix<T> initialConditions(1, 6);
     // matrix is (x, y, z, vx, vy, vz) (usual trick for odes)
     initialConditions(0, 0) = initialPos[0];
     initialConditions(0, 1) = initialPos[1];
@@ -67,5 +125,51 @@ RK4Solution getFinalPosition(Vector3<double> initialPos, Vector3<double> initial
     initialConditions(0, 3) = initialV[0];
     initialConditions(0, 4) = initialV[1];
     initialConditions(0, 5) = initialV[2];
-    return solver.solve(initialConditions, gravitationalDerivatives, RK4Constants::MAX_STEPS, objectInsideEarth);
+
+    const SolutionStatus status = keplerianStatus(initialPos, initialV, maxFlightTime);
+    if (status != SolutionStatus::EndCondition)
+    {
+        RK4Solution<T> solution(0, stepSize, (T)0, initialConditions);
+        solution.status = status;
+        return solution;
+    }
+    const int maxSteps = (int)std::min((double)RK4Constants::MAX_STEPS, maxFlightTime / (double)stepSize);
+    return solver.solve(initialConditions, gravitationalDerivatives<T>, maxSteps, objectInsideEarth<T>, observers...);
+}
+
+template <typename T = double>
+struct Apogee
+{
+    T time;
+    T altitude; // above the surface (m)
+};
+
+// highest point of a flight given as a dense trajectory, where the radial velocity (r . v) goes from positive to
+// negative; a flight that only climbs or only descends peaks at one of its ends
+template <typename T>
+Apogee<T> findApogee(const DenseTrajectory<T> &flight, T tolerance = (T)1e-9)
+{
+    if (flight.empty())
+        throw std::invalid_argument("Apogee of an empty trajectory");
+    auto radius = [](const T *y)
+    {
+        return std::sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
+    };
+    auto radialVelocity = [](T, const T *y)
+    {
+        return y[0] * y[3] + y[1] * y[4] + y[2] * y[5];
+    };
+    Apogee<T> best = {flight.startTime(), radius(flight.knotState(0))};
+    const T end = radius(flight.knotState(flight.size() - 1));
+    if (end > best.altitude)
+        best = {flight.endTime(), end};
+    std::vector<T> y(flight.dimensions());
+    for (T t : flight.roots(radialVelocity, tolerance))
+    {
+        flight.state(t, y.data());
+        if (radius(y.data()) > best.altitude)
+            best = {t, radius(y.data())};
+    }
+    best.altitude -= (T)Physics::EARTH_RADIUS;
+    return best;
 }
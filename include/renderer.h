@@ -1,8 +1,21 @@
 #pragma once
 
+#include <iostream>
+#include <string>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <atomic>
 #include <cstring>
 #include <cmath>
+#include <stdexcept>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "constants.h"
 
 // sets all values of array to specified val (n is array size)
 template <typename T>
@@ -12,74 +25,322 @@ inline void defval(std::vector<T> &p, const T val, const int n)
         p[i] = val;
 }
 
-class RenderObject
+// pixel rectangle [x0, x1) x [y0, y1) primitives are restricted to (a tile, or the whole canvas)
+struct Clip
+{
+    int x0, y0, x1, y1;
+};
+
+// depth buffer shared by every primitive of a frame
+// primitives are rasterized straight into it, touching only their bounding box, and the closest pixel wins
+// pixels of different objects only replace each other when strictly closer, so with equal depths the first object drawn stays
+class Canvas
 {
 private:
-    int width;
-    int height;
+    int width = 0;
+    int height = 0;
     std::vector<int> data;
     std::vector<double> rendist;
+    // object (stamp) that wrote each pixel, and object whose own pixels (set) reserve it
+    std::vector<int> owner;
+    std::vector<int> reserved;
+    int stamps = 0;
+
+    void plot(const int i, const int j, const int d, const double rndt, const int stamp, const bool ownTiesWin = false)
+    {
+        const int k = j * width + i;
+        const double current = rendist[k];
+        if (rndt < 0)
+            return;
+        if ((current < 0 or rndt < current or (ownTiesWin and rndt <= current and owner[k] == stamp)) and reserved[k] != stamp)
+        {
+            data[k] = d;
+            rendist[k] = rndt;
+            owner[k] = stamp;
+        }
+    }
+
+public:
+    Canvas() {}
+    Canvas(int w, int h) : width(w), height(h), data(w * h, 0), rendist(w * h, -1.0), owner(w * h, -1), reserved(w * h, -1) {}
+
+    int getWidth() const
+    {
+        return width;
+    }
+
+    int getHeight() const
+    {
+        return height;
+    }
+
+    int getData(const int x, const int y) const
+    {
+        return data[width * y + x];
+    }
+
+    double getRendist(const int x, const int y) const
+    {
+        return rendist[width * y + x];
+    }
+
+    Clip area() const
+    {
+        return {0, 0, width, height};
+    }
+
+    void clear()
+    {
+        clear(area());
+    }
+
+    void clear(const Clip &clip)
+    {
+        for (int j = clip.y0; j < clip.y1; j++)
+        {
+            std::fill(data.begin() + j * width + clip.x0, data.begin() + j * width + clip.x1, 0);
+            std::fill(rendist.begin() + j * width + clip.x0, rendist.begin() + j * width + clip.x1, -1.0);
+        }
+    }
+
+    // hands out n consecutive object stamps, everything drawn with one stamp belongs to one object
+    // stamps keep counting across frames, so owner and reserved never need resetting
+    int newStamps(const int n)
+    {
+        stamps += n;
+        return stamps - n;
+    }
 
-    void addLine(double x1, double y1, double x2, double y2, double rndt1, double rndt2)
+    void pixel(const int x, const int y, const int d, const double rndt, const int stamp)
     {
-        // adds a line with endpoints (x1, y1) and (x2, y2)
+        // a pixel set explicitly hides the rest of its object there, whether it is drawn or transparent (rndt < 0)
+        reserved[y * width + x] = stamp;
+        const int k = y * width + x;
+        if (rndt >= 0 and (rendist[k] < 0 or rndt < rendist[k]))
+        {
+            data[k] = d;
+            rendist[k] = rndt;
+            owner[k] = stamp;
+        }
+    }
+
+    void circle(double x, double y, double r, double rndt, const Clip &clip, const int stamp)
+    {
+        // center(x, y), radius r and rendist rndt
+        // x € [0, w], y € [0, h]
+        // we treat a pixel's location as its midpoint
+        const double reach = std::max(std::abs(r - 0.5), std::abs(r + 0.5));
+        for (int j = std::max(clip.y0, (int)std::floor(y - reach) - 1); j < std::min(clip.y1, (int)std::ceil(y + reach) + 1); j++)
+        {
+            for (int i = std::max(clip.x0, (int)std::floor(x - reach) - 1); i < std::min(clip.x1, (int)std::ceil(x + reach) + 1); i++)
+            {
+                const double d2 = (x - i - 0.5) * (x - i - 0.5) + (y - j - 0.5) * (y - j - 0.5);
+                if (d2 <= (r - 0.5) * (r - 0.5))
+                    plot(i, j, 1, rndt, stamp);
+                else if (d2 <= (r + 0.5) * (r + 0.5))
+                    plot(i, j, 2, rndt, stamp);
+            }
+        }
+    }
+
+    void line(double x1, double y1, double x2, double y2, double rndt1, double rndt2, const Clip &clip, const int stamp)
+    {
+        // line with endpoints (x1, y1) and (x2, y2)
         // rendist varying from rndt1 to rndt2
         // x1, x2 € [0, w], y1, y2 € [0, h]
         // we treat a pixel's location as its midpoint
+        // segments of the same object (a multiline) replace each other at equal depth, the latest wins
         if (x1 == x2 and y1 == y2)
             return;
-        for (int j = std::max(0, (int)std::floor(std::min(y1, y2)) - 1); j < std::min(height, (int)std::ceil(std::max(y1, y2)) + 1); j++)
+
+        // a pixel is covered when its center is within sqrt(0.75) of the segment (perpendicularly, so no round caps)
+        const double dx = x2 - x1, dy = y2 - y1;
+        const double length2 = dx * dx + dy * dy;
+        auto cover = [&](const int i, const int j)
+        {
+            const double frac = (dx * (i + 0.5 - x1) + dy * (j + 0.5 - y1)) / length2;
+            if (frac < 0 or frac > 1)
+                return;
+            const double closestx = x1 + frac * dx;
+            const double closesty = y1 + frac * dy;
+            const double dist2 = (closestx - i - 0.5) * (closestx - i - 0.5) + (closesty - j - 0.5) * (closesty - j - 0.5);
+
+            if (dist2 <= 0.25)
+                plot(i, j, 3, rndt1 + frac * (rndt2 - rndt1), stamp, true);
+            else if (dist2 <= 0.75)
+                plot(i, j, 4, rndt1 + frac * (rndt2 - rndt1), stamp, true);
+        };
+
+        if (std::abs(dx) < RendererConstants::SHORT_LINE and std::abs(dy) < RendererConstants::SHORT_LINE)
         {
-            for (int i = std::max(0, (int)std::floor(std::min(x1, x2)) - 1); i < std::min(width, (int)std::ceil(std::max(x1, x2)) + 1); i++)
+            // short segments (dense trajectories) cover a handful of pixels, testing their small bounding box is cheapest
+            for (int j = std::max(clip.y0, (int)std::floor(std::min(y1, y2)) - 1); j < std::min(clip.y1, (int)std::ceil(std::max(y1, y2)) + 1); j++)
+                for (int i = std::max(clip.x0, (int)std::floor(std::min(x1, x2)) - 1); i < std::min(clip.x1, (int)std::ceil(std::max(x1, x2)) + 1); i++)
+                    cover(i, j);
+            return;
+        }
+
+        // DDA along the major axis: in every column (row) of a flat (steep) segment only the few pixels around the
+        // line can be covered, so those are the only ones tested instead of the whole bounding box
+        const bool flat = std::abs(dx) >= std::abs(dy);
+        const double major1 = flat ? x1 : y1, major2 = flat ? x2 : y2;
+        const double slope = flat ? dy / dx : dx / dy;
+        // half width of the covered band measured across the major axis, and how far the ends of the band (cut
+        // perpendicularly) stick out past the endpoints along it, both padded so the walk never misses a pixel
+        const double length = std::sqrt(length2);
+        const double band = RendererConstants::LINE_REACH * length / std::abs(flat ? dx : dy) + 1e-6;
+        const double overhang = RendererConstants::LINE_REACH * std::abs(flat ? dy : dx) / length + 1e-6;
+        const int majorStart = flat ? clip.x0 : clip.y0, majorEnd = flat ? clip.x1 : clip.y1;
+        const int minorStart = flat ? clip.y0 : clip.x0, minorEnd = flat ? clip.y1 : clip.x1;
+
+        const int first = std::max(majorStart, (int)std::floor(std::min(major1, major2) - overhang - 0.5));
+        const int last = std::min(majorEnd - 1, (int)std::floor(std::max(major1, major2) + overhang - 0.5));
+        double minor = (flat ? y1 : x1) + slope * (first + 0.5 - major1); // line at the center of the column (row)
+        for (int a = first; a <= last; a++, minor += slope)
+        {
+            const int from = std::max(minorStart, (int)std::floor(minor - band - 0.5));
+            const int to = std::min(minorEnd - 1, (int)std::floor(minor + band - 0.5));
+            for (int b = from; b <= to; b++)
             {
-                const double frac = ((x2 - x1) * (i + 0.5 - x1) + (y2 - y1) * (j + 0.5 - y1)) / ((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
-                if (frac < 0 or frac > 1)
-                    continue;
-                const double closestx = x1 + frac * (x2 - x1);
-                const double closesty = y1 + frac * (y2 - y1);
-                const double dist2 = (closestx - i - 0.5) * (closestx - i - 0.5) + (closesty - j - 0.5) * (closesty - j - 0.5);
+                if (flat)
+                    cover(a, b);
+                else
+                    cover(b, a);
+            }
+        }
+    }
 
-                if (rendist[j * width + i] < 0 || rndt1 + frac * (rndt2 - rndt1) <= rendist[j * width + i])
-                {
-                    if (dist2 <= 0.25)
-                    {
-                        data[j * width + i] = 3;
-                        rendist[j * width + i] = rndt1 + frac * (rndt2 - rndt1);
-                    }
-                    else if (dist2 <= 0.75)
-                    {
-                        data[j * width + i] = 4;
-                        rendist[j * width + i] = rndt1 + frac * (rndt2 - rndt1);
-                    }
-                }
+    void sphere(double x, double y, double r, double rndt, const Clip &clip, const int stamp)
+    {
+        // center(x, y), radius r and radius rendist rndt
+        // x € [0, w], y € [0, h]
+        // we treat a pixel's location as its midpoint
+        for (int j = std::max(clip.y0, (int)std::floor(y - r) - 1); j < std::min(clip.y1, (int)std::ceil(y + r) + 1); j++)
+        {
+            for (int i = std::max(clip.x0, (int)std::floor(x - r) - 1); i < std::min(clip.x1, (int)std::ceil(x + r) + 1); i++)
+            {
+                double d2 = (x - i - 0.5) * (x - i - 0.5) + (y - j - 0.5) * (y - j - 0.5);
+
+                if (3 * d2 <= r * r)
+                    plot(i, j, 1, rndt - std::sqrt(r * r - d2), stamp);
+                else if (r * r >= d2 * 1.25)
+                    plot(i, j, 5, rndt - std::sqrt(r * r - d2), stamp);
+                else if ((r + 0.5) * (r + 0.5) >= d2)
+                    plot(i, j, 2, rndt - std::sqrt(r * r - d2), stamp);
             }
         }
     }
+};
 
-public:
-    RenderObject(int w, int h) : width(w), height(h)
+// a drawable: a list of primitives and explicitly set pixels, rasterized into the renderer's canvas when drawn
+class RenderObject
+{
+private:
+    enum class Shape
+    {
+        Circle,
+        Line,
+        Sphere
+    };
+
+    struct Primitive
     {
-        data.resize(width * height);
-        rendist.resize(width * height);
-        defval(data, 0, w * h);
-        defval(rendist, -1.0, w * h);
+        Shape shape;
+        double x1, y1, x2, y2, r, rndt1, rndt2;
+    };
+
+    int width;
+    int height;
+    std::vector<Primitive> primitives;
+    std::map<int, std::pair<int, double>> pixels; // set(), by pixel index
+    std::vector<RenderObject> merged;             // drawn after this one, as separate objects
+
+    // getData and getRendist rasterize the object on its own, only when asked
+    mutable Canvas alone;
+    mutable bool aloneValid = false;
+
+    // pixel bounds a primitive can touch, clipped to the object's screen
+    Clip bounds(const Primitive &p) const
+    {
+        double left, right, top, bottom;
+        if (p.shape == Shape::Line)
+        {
+            left = std::min(p.x1, p.x2);
+            right = std::max(p.x1, p.x2);
+            top = std::min(p.y1, p.y2);
+            bottom = std::max(p.y1, p.y2);
+        }
+        else
+        {
+            const double reach = (p.shape == Shape::Circle) ? std::max(std::abs(p.r - 0.5), std::abs(p.r + 0.5)) : p.r;
+            left = p.x1 - reach;
+            right = p.x1 + reach;
+            top = p.y1 - reach;
+            bottom = p.y1 + reach;
+        }
+        return {std::max(0, (int)std::floor(left) - 1), std::max(0, (int)std::floor(top) - 1),
+                std::min(width, (int)std::ceil(right) + 1), std::min(height, (int)std::ceil(bottom) + 1)};
+    }
+
+    void drawPrimitive(Canvas &canvas, const Primitive &p, const Clip &clip, const int stamp) const
+    {
+        if (p.shape == Shape::Circle)
+            canvas.circle(p.x1, p.y1, p.r, p.rndt1, clip, stamp);
+        else if (p.shape == Shape::Line)
+            canvas.line(p.x1, p.y1, p.x2, p.y2, p.rndt1, p.rndt2, clip, stamp);
+        else
+            canvas.sphere(p.x1, p.y1, p.r, p.rndt1, clip, stamp);
+    }
+
+    void drawPixels(Canvas &canvas, const Clip &clip, const int stamp) const
+    {
+        for (const auto &p : pixels)
+        {
+            const int x = p.first % width, y = p.first / width;
+            if (x >= clip.x0 and x < clip.x1 and y >= clip.y0 and y < clip.y1)
+                canvas.pixel(x, y, p.second.first, p.second.second, stamp);
+        }
     }
 
+    // this object and the ones merged into it, in drawing order, each one is drawn as a separate object
+    void layers(std::vector<const RenderObject *> &out) const
+    {
+        out.push_back(this);
+        for (const RenderObject &o : merged)
+            o.layers(out);
+    }
+
+    const Canvas &rasterized() const
+    {
+        if (!aloneValid)
+        {
+            alone = Canvas(width, height);
+            draw(alone);
+            aloneValid = true;
+        }
+        return alone;
+    }
+
+    friend class Renderer;
+
+public:
+    RenderObject(int w, int h) : width(w), height(h) {}
+
     void set(const int x, const int y, const int d, const double rndt)
     {
         // sets pixel (x, y) to data d and distance rndt
-        data[y * width + x] = d;
-        rendist[y * width + x] = rndt;
+        pixels[y * width + x] = std::make_pair(d, rndt);
+        aloneValid = false;
     }
 
     int getData(const int x, const int y) const
     {
-        return data[width * y + x];
+        return rasterized().getData(x, y);
     }
 
     double getRendist(const int x, const int y) const
     {
-        return rendist[width * y + x];
+        return rasterized().getRendist(x, y);
     }
 
     bool checkCompatibility(const int w, const int h) const
@@ -90,18 +351,22 @@ public:
     // merges passed object to called object. Does not modify the first one but it does the second one
     void merge(RenderObject *o)
     {
-        for (int y = 0; y < height; y++)
+        merged.push_back(*o);
+        aloneValid = false;
+    }
+
+    // rasterizes the object into canvas, depth tested against what is already there
+    void draw(Canvas &canvas) const
+    {
+        std::vector<const RenderObject *> all;
+        layers(all);
+        const int stamp = canvas.newStamps((int)all.size());
+        for (size_t l = 0; l < all.size(); l++)
         {
-            for (int x = 0; x < width; x++)
-            {
-                if (o->rendist[width * y + x] < 0)
-                    continue;
-                if (rendist[width * y + x] < 0 or o->rendist[width * y + x] < rendist[width * y + x])
-                {
-                    data[width * y + x] = o->data[width * y + x];
-                    rendist[width * y + x] = o->rendist[width * y + x];
-                }
-            }
+            // pixels set by hand first, they reserve their place against the rest of the object
+            all[l]->drawPixels(canvas, canvas.area(), stamp + (int)l);
+            for (const Primitive &p : all[l]->primitives)
+                all[l]->drawPrimitive(canvas, p, canvas.area(), stamp + (int)l);
         }
     }
 
@@ -110,19 +375,8 @@ public:
     static RenderObject Circle(int w, int h, double x, double y, double r, double rndt)
     {
         // creates a circle for a renderer of size wxh with center(x, y), radius r and rendist rndt
-        // x € [0, w], y € [0, h]
-        // we treat a pixel's location as its midpoint
         RenderObject circle(w, h);
-        for (int j = 0; j < h; j++)
-        {
-            for (int i = 0; i < w; i++)
-            {
-                if ((x - i - 0.5) * (x - i - 0.5) + (y - j - 0.5) * (y - j - 0.5) <= (r - 0.5) * (r - 0.5))
-                    circle.set(i, j, 1, rndt);
-                else if ((x - i - 0.5) * (x - i - 0.5) + (y - j - 0.5) * (y - j - 0.5) <= (r + 0.5) * (r + 0.5))
-                    circle.set(i, j, 2, rndt);
-            }
-        }
+        circle.primitives.push_back({Shape::Circle, x, y, 0, 0, r, rndt, rndt});
         return circle;
     }
 
@@ -130,10 +384,8 @@ public:
     {
         // creates a line for a renderer of size wxh with endpoints (x1, y1) and (x2, y2)
         // rendist varying from rndt1 to rndt2
-        // x1, x2 € [0, w], y1, y2 € [0, h]
-        // we treat a pixel's location as its midpoint
         RenderObject line(w, h);
-        line.addLine(x1, y1, x2, y2, rndt1, rndt2);
+        line.primitives.push_back({Shape::Line, x1, y1, x2, y2, 0, rndt1, rndt2});
         return line;
     }
 
@@ -145,34 +397,168 @@ public:
 
         RenderObject o(w, h);
         for (size_t i = 1; i < x.size(); i++)
-            o.addLine(x[i - 1], y[i - 1], x[i], y[i], rndt[i - 1], rndt[i]);
+            o.primitives.push_back({Shape::Line, x[i - 1], y[i - 1], x[i], y[i], 0, rndt[i - 1], rndt[i]});
         return o;
     }
 
     static RenderObject Sphere(int w, int h, double x, double y, double r, double rndt)
     {
         // creates a sphere for a renderer of size wxh with center(x, y), radius r and radius rendist rndt
-        // x € [0, w], y € [0, h]
-        // we treat a pixel's location as its midpoint
-        RenderObject sphere(w, h);
         if (r > rndt)
             throw std::invalid_argument("Sphere collides with screen");
+        RenderObject sphere(w, h);
+        sphere.primitives.push_back({Shape::Sphere, x, y, 0, 0, r, rndt, rndt});
+        return sphere;
+    }
+};
+
+// pixel classes (RenderObject data) to terminal glyphs, every pixel is drawn as two equal characters
+// 0 empty, 1 solid, 2 half solid, 3 line, 4 half line, 5 75% solid
+const char PIXEL_GLYPHS[] = {' ', '#', ':', '*', '.', 'x'};
+const int PIXEL_CLASSES = sizeof(PIXEL_GLYPHS);
 
-        for (int j = std::max(0, (int)std::floor(y - r) - 1); j < std::min(h, (int)std::ceil(y + r) + 1); j++)
+// sends bytes to the terminal in a single write call
+inline void writeToTerminal(const std::string &bytes)
+{
+    std::cout.flush();
+    size_t written = 0;
+    while (written < bytes.size())
+    {
+#ifdef _WIN32
+        const int n = _write(1, bytes.data() + written, (unsigned int)(bytes.size() - written));
+#else
+        const ssize_t n = ::write(1, bytes.data() + written, bytes.size() - written);
+#endif
+        if (n <= 0)
+            break;
+        written += n;
+    }
+}
+
+// a rasterized frame: one pixel class (0 to PIXEL_CLASSES - 1) per pixel, row by row
+struct Framebuffer
+{
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels;
+
+    unsigned char at(const int x, const int y) const
+    {
+        return pixels[width * y + x];
+    }
+};
+
+// where finished frames go (terminal, memory, files)
+class FrameTarget
+{
+public:
+    virtual ~FrameTarget() {}
+    virtual void present(const Framebuffer &frame) = 0;
+};
+
+// the terminal: frames are drawn at the top of the screen, in full the first time and as differences afterwards
+class TerminalTarget : public FrameTarget
+{
+private:
+    // the bytes of the last frame, built in one go so it reaches the terminal in a single write
+    std::string stringBuffer;
+    // pixels of the last frame on screen, only the differences are sent
+    std::vector<unsigned char> shown;
+    bool shownValid = false;
+
+    void drawPixel(const unsigned char d)
+    {
+        stringBuffer += PIXEL_GLYPHS[d];
+        stringBuffer += PIXEL_GLYPHS[d];
+    }
+
+    void moveCursor(int row, int column)
+    {
+        // ANSI positions are 1-based
+        stringBuffer += "\033[";
+        stringBuffer += std::to_string(row + 1);
+        stringBuffer += ';';
+        stringBuffer += std::to_string(column + 1);
+        stringBuffer += 'H';
+    }
+
+    void composeFull(const Framebuffer &frame)
+    {
+        for (int j = 0; j < frame.height; j++)
         {
-            for (int i = std::max(0, (int)std::floor(x - r) - 1); i < std::min(w, (int)std::ceil(x + r) + 1); i++)
-            {
-                double d2 = (x - i - 0.5) * (x - i - 0.5) + (y - j - 0.5) * (y - j - 0.5);
+            for (int i = 0; i < frame.width; i++)
+                drawPixel(frame.at(i, j));
+            stringBuffer += "\n";
+        }
+    }
 
-                if (3 * d2 <= r * r)
-                    sphere.set(i, j, 1, rndt - std::sqrt(r * r - d2));
-                else if (r * r >= d2 * 1.25)
-                    sphere.set(i, j, 5, rndt - std::sqrt(r * r - d2));
-                else if ((r + 0.5) * (r + 0.5) >= d2)
-                    sphere.set(i, j, 2, rndt - std::sqrt(r * r - d2));
+    void composeDifferences(const Framebuffer &frame)
+    {
+        // changed pixels are sent in runs, each run starts with a cursor jump
+        // short stretches of unchanged pixels are cheaper to resend than to jump over
+        const int width = frame.width;
+        bool changed = false;
+        for (int j = 0; j < frame.height; j++)
+        {
+            const unsigned char *row = &frame.pixels[width * j];
+            const unsigned char *before = &shown[width * j];
+            int i = 0;
+            while (i < width)
+            {
+                if (row[i] == before[i])
+                {
+                    i++;
+                    continue;
+                }
+                int end = i + 1; // one past the last changed pixel of the run
+                for (int k = end; k < width and k - end <= RendererConstants::MAX_UNCHANGED_GAP; k++)
+                    if (row[k] != before[k])
+                        end = k + 1;
+                moveCursor(j, 2 * i);
+                for (int k = i; k < end; k++)
+                    drawPixel(row[k]);
+                changed = true;
+                i = end;
             }
         }
-        return sphere;
+        // leave the cursor under the frame, as a full redraw does
+        if (changed)
+            moveCursor(frame.height, 0);
+    }
+
+public:
+    // forgets what is on screen, the next frame is drawn in full
+    void invalidate()
+    {
+        shownValid = false;
+    }
+
+    // the bytes that bring the terminal from the last frame to this one
+    // without clearScreenBeforeRendering the whole frame is printed wherever the cursor is
+    const std::string &compose(const Framebuffer &frame, bool clearScreenBeforeRendering = true)
+    {
+        stringBuffer.clear();
+        stringBuffer.reserve(frame.width * frame.height * 2 + frame.height + 16);
+        if (clearScreenBeforeRendering and shownValid and shown.size() == frame.pixels.size())
+        {
+            composeDifferences(frame);
+        }
+        else
+        {
+            if (clearScreenBeforeRendering)
+                stringBuffer += "\033[2J\033[1;1H";
+            composeFull(frame);
+        }
+        shown = frame.pixels;
+        shownValid = clearScreenBeforeRendering;
+        return stringBuffer;
+    }
+
+    void present(const Framebuffer &frame) override
+    {
+        const std::string &bytes = compose(frame);
+        if (!bytes.empty())
+            writeToTerminal(bytes);
     }
 };
 
@@ -181,94 +567,173 @@ class Renderer
 private:
     int width;
     int height;
-    // we use a string buffer to make display smoother
-    std::string stringBuffer;
     std::vector<RenderObject *> buffer;
-    std::vector<int> data;
-    std::vector<double> rendist;
+    Canvas canvas;
+    // tiled rendering (threads > 1): every primitive is binned on submit into the tiles its bounds touch, then
+    // each tile draws its bins in submission order on a worker, so every pixel sees exactly the serial sequence of writes
+    struct BinEntry
+    {
+        int layer;                  // object index in the frame, offset of its stamp
+        const RenderObject *object; // owner of the primitive
+        int primitive;              // index in object->primitives, -1 for the pixels set by hand
+    };
+    int threads = 1;
+    int tilesX = 0, tilesY = 0;
+    std::vector<std::vector<BinEntry>> bins;
+    int layers = 0;
+    Framebuffer frame;
+    TerminalTarget terminal;
 
-    void drawPixel(const int d)
+    bool tiled() const
     {
-        if (d == 5) // 75% solid
-            stringBuffer += "xx";
-        else if (d == 4) // half line
-            stringBuffer += "..";
-        else if (d == 3) // line
-            stringBuffer += "**";
-        else if (d == 2) // half solid
-            stringBuffer += "::";
-        else if (d == 1) // solid
-            stringBuffer += "##";
-        else // empty
-            stringBuffer += "  ";
+        return threads > 1;
     }
 
-    void addObjectToData(RenderObject *o)
+    Clip tile(const int t) const
     {
-        for (int y = 0; y < height; y++)
+        const int x0 = (t % tilesX) * RendererConstants::TILE_SIZE, y0 = (t / tilesX) * RendererConstants::TILE_SIZE;
+        return {x0, y0, std::min(width, x0 + RendererConstants::TILE_SIZE), std::min(height, y0 + RendererConstants::TILE_SIZE)};
+    }
+
+    void binObject(const RenderObject *o)
+    {
+        std::vector<const RenderObject *> all;
+        o->layers(all);
+        for (const RenderObject *object : all)
         {
-            for (int x = 0; x < width; x++)
+            const int layer = layers++;
+            auto bin = [&](const Clip &bounds, const int primitive)
             {
-                if (o->getRendist(x, y) < 0)
-                    continue;
-                if (rendist[width * y + x] < 0)
-                {
-                    data[width * y + x] = o->getData(x, y);
-                    rendist[width * y + x] = o->getRendist(x, y);
-                }
-                else if (o->getRendist(x, y) < rendist[width * y + x])
-                {
-                    data[width * y + x] = o->getData(x, y);
-                    rendist[width * y + x] = o->getRendist(x, y);
-                }
+                for (int ty = bounds.y0 / RendererConstants::TILE_SIZE; ty * RendererConstants::TILE_SIZE < bounds.y1; ty++)
+                    for (int tx = bounds.x0 / RendererConstants::TILE_SIZE; tx * RendererConstants::TILE_SIZE < bounds.x1; tx++)
+                        bins[ty * tilesX + tx].push_back({layer, object, primitive});
+            };
+            if (!object->pixels.empty())
+                bin(canvas.area(), -1);
+            for (size_t p = 0; p < object->primitives.size(); p++)
+                bin(object->bounds(object->primitives[p]), (int)p);
+        }
+    }
+
+    void drawTile(const int t, const int stamp)
+    {
+        const Clip clip = tile(t);
+        canvas.clear(clip);
+        for (const BinEntry &e : bins[t])
+        {
+            if (e.primitive < 0)
+                e.object->drawPixels(canvas, clip, stamp + e.layer);
+            else
+                e.object->drawPrimitive(canvas, e.object->primitives[e.primitive], clip, stamp + e.layer);
+        }
+        bins[t].clear();
+        computePixels(clip);
+    }
+
+    void computePixels(const Clip &clip)
+    {
+        for (int j = clip.y0; j < clip.y1; j++)
+        {
+            for (int i = clip.x0; i < clip.x1; i++)
+            {
+                const int d = (canvas.getRendist(i, j) < 0) ? 0 : canvas.getData(i, j);
+                frame.pixels[width * j + i] = (d > 0 and d < PIXEL_CLASSES) ? d : 0;
             }
         }
     }
 
 public:
-    Renderer(int w, int h)
+    Renderer(int w, int h) : canvas(w, h)
     {
         width = w;
         height = h;
-        data.resize(width * height);
-        rendist.resize(width * height);
+        frame.width = w;
+        frame.height = h;
+        frame.pixels.resize(width * height);
     }
     void clearScreen()
     {
         std::cout << "\033[2J\033[1;1H";
     }
+    // forgets what is on screen, the next frame is drawn in full
+    void invalidate()
+    {
+        terminal.invalidate();
+    }
+    // tiles are drawn on up to n threads (0 -> hardware concurrency), 1 draws the whole screen serially
+    // the result does not depend on n; buffered objects must not change between being added and being drawn
+    void setThreads(int n)
+    {
+        if (n <= 0)
+            n = std::max(1u, std::thread::hardware_concurrency());
+        threads = n;
+        tilesX = (width + RendererConstants::TILE_SIZE - 1) / RendererConstants::TILE_SIZE;
+        tilesY = (height + RendererConstants::TILE_SIZE - 1) / RendererConstants::TILE_SIZE;
+        bins.assign(tiled() ? tilesX * tilesY : 0, std::vector<BinEntry>());
+        layers = 0;
+        if (tiled())
+            for (RenderObject *o : buffer)
+                binObject(o);
+    }
     void drawObjects()
     {
-        defval(data, 0, width * height);
-        defval(rendist, -1.0, width * height);
-        for (size_t i = 0; i < this->buffer.size(); i++)
-            addObjectToData(buffer[i]);
+        if (!tiled())
+        {
+            // every object rasterizes into the shared canvas in the order it was added
+            canvas.clear();
+            for (size_t i = 0; i < this->buffer.size(); i++)
+                buffer[i]->draw(canvas);
+            computePixels(canvas.area());
+        }
+        else
+        {
+            const int stamp = canvas.newStamps(layers);
+            std::atomic<int> next(0);
+            auto worker = [&]()
+            {
+                for (int t = next++; t < tilesX * tilesY; t = next++)
+                    drawTile(t, stamp);
+            };
+            std::vector<std::thread> workers;
+            for (int k = 1; k < std::min(threads, tilesX * tilesY); k++)
+                workers.emplace_back(worker);
+            worker();
+            for (std::thread &w : workers)
+                w.join();
+            layers = 0;
+        }
         this->buffer.resize(0);
     }
-    void render(bool clearScreenBeforeRendering = true)
+    // draws the buffered objects, the frame stays valid until the next one is drawn
+    const Framebuffer &drawFrame()
     {
-        // load the pixels
-        if (clearScreenBeforeRendering)
-            this->clearScreen();
         this->drawObjects();
-
-        // reserve
-        stringBuffer.reserve(width * height * 2 + height);
-
-        // draw the pixels
-        for (int j = 0; j < height; j++)
-        {
-            for (int i = 0; i < width; i++)
-                drawPixel((rendist[width * j + i] < 0) ? 0 : data[width * j + i]);
-            stringBuffer += "\n";
-        }
-        std::cout << stringBuffer;
-        stringBuffer = "";
+        return frame;
+    }
+    // draws the buffered objects and returns the bytes that bring the terminal from the last frame to this one
+    // with clearScreenBeforeRendering the frame is drawn at the top of the screen, in full the first time and as
+    // differences afterwards; without it the whole frame is printed wherever the cursor is
+    const std::string &composeFrame(bool clearScreenBeforeRendering = true)
+    {
+        return terminal.compose(drawFrame(), clearScreenBeforeRendering);
+    }
+    void render(bool clearScreenBeforeRendering = true)
+    {
+        const std::string &bytes = composeFrame(clearScreenBeforeRendering);
+        if (!bytes.empty())
+            writeToTerminal(bytes);
+    }
+    // draws the buffered objects into any other target (memory, files)
+    void render(FrameTarget &target)
+    {
+        target.present(drawFrame());
     }
     void addObjectToBuffer(RenderObject *o)
     {
         if (!(o->checkCompatibility(width, height)))
             throw std::invalid_argument("Object is not compatible with renderer");
         this->buffer.push_back(o);
+        if (tiled())
+            binObject(o);
     }
 };
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <cstddef>
+
+// lock-free single producer / single consumer ring buffer
+// one thread may only push and one other thread may only pop; neither ever waits, a push into a full ring
+// and a pop from an empty one just fail
+template <typename T>
+class SPSCRing
+{
+private:
+    std::vector<T> slots;
+    size_t mask;
+    // head is written by the producer only, tail by the consumer only, kept on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+
+public:
+    // capacity is rounded up to a power of two
+    explicit SPSCRing(size_t capacity) : head(0), tail(0)
+    {
+        size_t size = 1;
+        while (size < capacity)
+            size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const
+    {
+        return slots.size();
+    }
+
+    bool tryPush(const T &value)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == slots.size())
+            return false;
+        slots[h & mask] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &value)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire))
+            return false;
+        value = slots[t & mask];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+};
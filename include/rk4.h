@@ -3,55 +3,129 @@
 #include <vector>
 #include <functional>
 #include "linalg.h"
+#include "cancellation.h"
 
+// how an integration ended
+enum class SolutionStatus
+{
+    EndCondition, // endCondition returned true (impact for trajectories)
+    MaxSteps,     // ran out of steps (or of flight time)
+    Escape,       // not integrated: unbound trajectory (see getFinalPosition)
+    Orbit,        // not integrated: bound but never reaches the surface
+    Cancelled     // stopped early by a CancellationScope's token, the state is wherever it got to
+};
+
+// what observers see of every accepted state, in order from the initial one (index 0) to the last one (last)
+// observers are any objects with a void onStep(const SolverStep<T> &) member, handed to solve after endCondition;
+// they are template parameters, so their calls are inlined and a solve without observers is the plain loop
+template <typename T = double>
+struct SolverStep
+{
+    int index;
+    T time;
+    const Matrix<T> &state;
+    const Matrix<T> &derivative;
+    bool last;
+};
+
+template <typename T = double>
 struct RK4Solution
 {
     int steps = 0;
-    double stepSize;
-    double error = 0.0;
-    Matrix<double> solutions;
-
-    RK4Solution(int _steps, double _stepSize, double _error, const Matrix<double> &_solutions) : steps(_steps),
-                                                                                                 stepSize(_stepSize),
-                                                                                                 error(_error),
-                                                                                                 solutions(_solutions)
+    T stepSize;
+    T error = 0.0;
+    T time = 0.0; // integrated time, not always steps * stepSize (see ABM, and RK4 counts no step for the impact)
+    Matrix<T> solutions;
+    SolutionStatus status = SolutionStatus::EndCondition;
+
+    RK4Solution(int _steps, T _stepSize, T _error, const Matrix<T> &_solutions) : steps(_steps),
+                                                                                  stepSize(_stepSize),
+                                                                                  error(_error),
+                                                                                  time(_steps * _stepSize),
+                                                                                  solutions(_solutions)
+    {
+    }
+
+    RK4Solution(int _steps, T _stepSize, T _error, T _time, const Matrix<T> &_solutions) : steps(_steps),
+                                                                                           stepSize(_stepSize),
+                                                                                           error(_error),
+                                                                                           time(_time),
+                                                                                           solutions(_solutions)
     {
     }
 };
 
+// T is the scalar type of the state (double, float)
+template <typename T = double>
 class RK4
 {
 private:
-    double h;
+    T h;
 
 public:
-    RK4(double stepSize)
+    RK4(T stepSize)
     {
         h = stepSize;
     }
 
-    RK4Solution solve(const Matrix<double> &initialConditions, const std::function<void(const Matrix<double> &, Matrix<double> &)> &derivatives, int maxSteps, const std::function<bool(Matrix<double>)> &endCondition)
+    template <typename... Observers>
+    RK4Solution<T> solve(const Matrix<T> &initialConditions, const std::function<void(const Matrix<T> &, Matrix<T> &)> &derivatives, int maxSteps, const std::function<bool(Matrix<T>)> &endCondition,
+                         Observers &...observers)
     {
         // the solver assumes the derivatives do NOT depend on time explicitly
         // input: Matrix (row vector) with initial conditions, Matrix->Matrix (out-parameter), max steps, Matrix->bool to check if we should stop
-        Matrix<double> y(initialConditions);
+        // observers see each state with the k1 of the step leaving it as its derivative; the last state costs one more
+        // derivative call and is seen at the time it is really at, which is RK4Solution::time
+        // the temporaries of a step live in the thread's arena and are given back when the step ends, so matrices made
+        // by derivatives or endCondition must not be kept past the call
+        // under a CancellationScope the token is checked before every step
+        Matrix<T> y(initialConditions);
         int n = initialConditions.getCols();
-        Matrix<double> k1(1, n), k2(1, n), k3(1, n), k4(1, n);
+        Matrix<T> k1(1, n), k2(1, n), k3(1, n), k4(1, n);
         int step = 0;
+        SolutionStatus status = SolutionStatus::MaxSteps;
+        const std::atomic<bool> *cancel = activeCancelFlag();
         while (step < maxSteps)
         {
+            if (cancel and cancel->load(std::memory_order_relaxed))
+            {
+                status = SolutionStatus::Cancelled;
+                break;
+            }
             derivatives(y, k1);
-            derivatives(y + h * k1 * 0.5, k2);
-            derivatives(y + h * k2 * 0.5, k3);
-            derivatives(y + h * k3, k4);
+            if constexpr (sizeof...(Observers) > 0)
+            {
+                const SolverStep<T> accepted = {step, step * h, y, k1, false};
+                (observers.onStep(accepted), ...);
+            }
+            {
+                ArenaScope temporaries;
+                derivatives(y + h * k1 * (T)0.5, k2);
+                derivatives(y + h * k2 * (T)0.5, k3);
+                derivatives(y + h * k3, k4);
 
-            y = y + h / 6 * (k1 + 2 * k2 + 2 * k3 + k4);
+                // copied into y's own buffer
+                y = y + h / 6 * (k1 + 2 * k2 + 2 * k3 + k4);
 
-            if (endCondition(y))
-                break;
+                if (endCondition(y))
+                {
+                    status = SolutionStatus::EndCondition;
+                    break;
+                }
+            }
             step++;
         }
+        // steps counts the steps before the one that ended the flight, the state returned is at the end of that one
+        const int taken = status == SolutionStatus::EndCondition ? step + 1 : step;
+        if constexpr (sizeof...(Observers) > 0)
+        {
+            derivatives(y, k1);
+            const SolverStep<T> accepted = {taken, taken * h, y, k1, true};
+            (observers.onStep(accepted), ...);
+        }
 
-        return RK4Solution(step, h, 0.0, y);
+        RK4Solution<T> solution(step, h, (T)0, taken * h, y);
+        solution.status = status;
+        return solution;
     }
 };
\ No newline at end of file
@@ -0,0 +1,502 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <stdexcept>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "linalg.h"
+#include "physics.h"
+#include "constants.h"
+
+// recorded trajectories: (time, state) samples split into chunks that are compressed and indexed by time
+//
+// file layout (native endianness):
+//   header: magic "TJTR", uint32 version, int32 dimensions (state size), int32 states per chunk
+//   chunks: compressed samples, one after the other
+//   index:  per chunk double first time, double last time, uint64 offset, uint32 size (bytes), int32 states
+//   footer: uint64 index offset, int32 chunk count, magic "TJTI"
+//
+// every value (time and state) is compressed on its own column, losslessly: its bit pattern is predicted by linear
+// extrapolation of the two values before it in the chunk, and the difference is stored zigzagged as a varint
+// smooth trajectories sampled finely are nearly linear from one step to the next, so most values take 2-3 bytes
+
+struct TrajectoryChunkIndex
+{
+    double first, last; // time of the first and last state
+    std::uint64_t offset;
+    std::uint32_t size;
+    std::int32_t states;
+};
+
+namespace TrajectoryFormat
+{
+    const char MAGIC[4] = {'T', 'J', 'T', 'R'};
+    const char INDEX_MAGIC[4] = {'T', 'J', 'T', 'I'};
+    const std::uint32_t VERSION = 1;
+    const std::size_t HEADER_SIZE = 4 + 4 + 2 * 4;
+    const std::size_t INDEX_ENTRY_SIZE = 2 * 8 + 8 + 4 + 4;
+    const std::size_t FOOTER_SIZE = 8 + 4 + 4;
+}
+
+inline std::uint64_t doubleBits(double d)
+{
+    std::uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(double));
+    return bits;
+}
+
+inline double bitsDouble(std::uint64_t bits)
+{
+    double d;
+    std::memcpy(&d, &bits, sizeof(double));
+    return d;
+}
+
+// prediction of the k-th value of a column from the two before it, in integer arithmetic so decoding is exact
+inline std::uint64_t predictBits(int k, std::uint64_t previous, std::uint64_t beforePrevious)
+{
+    return k == 0 ? 0 : k == 1 ? previous : 2 * previous - beforePrevious;
+}
+
+inline void encodeResidual(std::vector<unsigned char> &out, std::uint64_t residual)
+{
+    // zigzag: small negative differences become small numbers too
+    std::uint64_t z = (residual << 1) ^ (std::uint64_t)((std::int64_t)residual >> 63);
+    while (z >= 0x80)
+    {
+        out.push_back((unsigned char)(z | 0x80));
+        z >>= 7;
+    }
+    out.push_back((unsigned char)z);
+}
+
+inline std::uint64_t decodeResidual(const unsigned char *&p, const unsigned char *end)
+{
+    std::uint64_t z = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (p == end)
+            throw std::runtime_error("Corrupt trajectory chunk");
+        const unsigned char byte = *p++;
+        z |= (std::uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return (z >> 1) ^ (~(z & 1) + 1);
+    }
+    throw std::runtime_error("Corrupt trajectory chunk");
+}
+
+// writes states as they come (e.g. from the integrator), a chunk reaches the file as soon as it is full
+// times must not decrease; the index is written by close(), a file that was never closed cannot be read
+class TrajectoryWriter
+{
+private:
+    std::ofstream out;
+    std::string path;
+    int dimensions;
+    int chunkStates;
+    // the chunk being filled, one (time, state) row per sample
+    std::vector<double> pending;
+    int pendingStates = 0;
+    std::vector<unsigned char> encoded;
+    std::vector<double> row;
+    std::vector<TrajectoryChunkIndex> index;
+    std::uint64_t offset = TrajectoryFormat::HEADER_SIZE;
+    double lastTime = 0;
+    long long written = 0;
+
+    void flushChunk()
+    {
+        if (pendingStates == 0)
+            return;
+        const int columns = dimensions + 1;
+        encoded.clear();
+        for (int k = 0; k < pendingStates; k++)
+        {
+            for (int c = 0; c < columns; c++)
+            {
+                const std::uint64_t previous = k > 0 ? doubleBits(pending[(k - 1) * columns + c]) : 0;
+                const std::uint64_t beforePrevious = k > 1 ? doubleBits(pending[(k - 2) * columns + c]) : 0;
+                encodeResidual(encoded, doubleBits(pending[k * columns + c]) - predictBits(k, previous, beforePrevious));
+            }
+        }
+        out.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+        if (!out)
+            throw std::runtime_error("Cannot write trajectory file " + path);
+        index.push_back({pending[0], pending[(pendingStates - 1) * columns], offset, (std::uint32_t)encoded.size(), pendingStates});
+        offset += encoded.size();
+        pendingStates = 0;
+    }
+
+public:
+    TrajectoryWriter(const std::string &path, int dimensions = 6, int chunkStates = TrajectoryFileConstants::CHUNK_STATES)
+        : out(path, std::ios::binary), path(path), dimensions(dimensions), chunkStates(chunkStates)
+    {
+        if (dimensions < 1 or chunkStates < 1)
+            throw std::invalid_argument("Trajectory files need at least one dimension and one state per chunk");
+        if (!out)
+            throw std::runtime_error("Cannot create trajectory file " + path);
+        const std::int32_t sizes[2] = {dimensions, chunkStates};
+        out.write(TrajectoryFormat::MAGIC, 4);
+        out.write(reinterpret_cast<const char *>(&TrajectoryFormat::VERSION), sizeof(std::uint32_t));
+        out.write(reinterpret_cast<const char *>(sizes), sizeof(sizes));
+        pending.resize((size_t)chunkStates * (dimensions + 1));
+    }
+
+    TrajectoryWriter(const TrajectoryWriter &) = delete;
+    TrajectoryWriter &operator=(const TrajectoryWriter &) = delete;
+
+    ~TrajectoryWriter()
+    {
+        // errors cannot be reported from here, call close() to see them
+        try
+        {
+            close();
+        }
+        catch (const std::exception &)
+        {
+        }
+    }
+
+    void append(double time, const double *state)
+    {
+        if (!out.is_open())
+            throw std::runtime_error("Trajectory file " + path + " is closed");
+        if (written > 0 and time < lastTime)
+            throw std::invalid_argument("Trajectory times must not decrease");
+        double *slot = &pending[(size_t)pendingStates * (dimensions + 1)];
+        slot[0] = time;
+        std::memcpy(slot + 1, state, dimensions * sizeof(double));
+        lastTime = time;
+        written++;
+        if (++pendingStates == chunkStates)
+            flushChunk();
+    }
+
+    // state is a row matrix, as the solvers use
+    void append(double time, const Matrix<double> &state)
+    {
+        if (state.getRows() != 1 or state.getCols() != dimensions)
+            throw std::invalid_argument("State does not match the trajectory dimensions");
+        row.resize(dimensions);
+        for (int i = 0; i < dimensions; i++)
+            row[i] = state(0, i);
+        append(time, row.data());
+    }
+
+    long long states() const
+    {
+        return written;
+    }
+
+    // writes the last chunk and the index
+    void close()
+    {
+        if (!out.is_open())
+            return;
+        flushChunk();
+        for (const TrajectoryChunkIndex &entry : index)
+        {
+            out.write(reinterpret_cast<const char *>(&entry.first), sizeof(double));
+            out.write(reinterpret_cast<const char *>(&entry.last), sizeof(double));
+            out.write(reinterpret_cast<const char *>(&entry.offset), sizeof(std::uint64_t));
+            out.write(reinterpret_cast<const char *>(&entry.size), sizeof(std::uint32_t));
+            out.write(reinterpret_cast<const char *>(&entry.states), sizeof(std::int32_t));
+        }
+        const std::int32_t chunks = (std::int32_t)index.size();
+        out.write(reinterpret_cast<const char *>(&offset), sizeof(std::uint64_t));
+        out.write(reinterpret_cast<const char *>(&chunks), sizeof(std::int32_t));
+        out.write(TrajectoryFormat::INDEX_MAGIC, 4);
+        out.close();
+        if (!out)
+            throw std::runtime_error("Cannot write trajectory file " + path);
+    }
+};
+
+// a whole file mapped read-only into memory
+class MappedFile
+{
+private:
+    const unsigned char *bytes = nullptr;
+    std::size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+public:
+    MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE or !GetFileSizeEx(file, &size))
+            throw std::runtime_error("Cannot open trajectory file " + path);
+        length = (std::size_t)size.QuadPart;
+        if (length > 0)
+        {
+            mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            bytes = mapping ? static_cast<const unsigned char *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        }
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 or fstat(fd, &info) != 0)
+        {
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error("Cannot open trajectory file " + path);
+        }
+        length = (std::size_t)info.st_size;
+        if (length > 0)
+        {
+            void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            bytes = address == MAP_FAILED ? nullptr : static_cast<const unsigned char *>(address);
+        }
+        ::close(fd);
+#endif
+        if (length > 0 and !bytes)
+        {
+            release();
+            throw std::runtime_error("Cannot map trajectory file " + path);
+        }
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        release();
+    }
+
+    void release()
+    {
+#ifdef _WIN32
+        if (bytes)
+            UnmapViewOfFile(bytes);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes)
+            munmap(const_cast<unsigned char *>(bytes), length);
+#endif
+        bytes = nullptr;
+    }
+
+    const unsigned char *data() const
+    {
+        return bytes;
+    }
+
+    std::size_t size() const
+    {
+        return length;
+    }
+};
+
+// reads a trajectory file through a memory mapping, only the chunks asked for are decoded
+class TrajectoryReader
+{
+private:
+    MappedFile file;
+    int dims = 0;
+    std::vector<TrajectoryChunkIndex> index;
+    long long total = 0;
+
+    template <typename V>
+    V readAt(std::size_t at) const
+    {
+        V value;
+        std::memcpy(&value, file.data() + at, sizeof(V));
+        return value;
+    }
+
+public:
+    TrajectoryReader(const std::string &path) : file(path)
+    {
+        const std::size_t size = file.size();
+        if (size < TrajectoryFormat::HEADER_SIZE + TrajectoryFormat::FOOTER_SIZE or
+            std::memcmp(file.data(), TrajectoryFormat::MAGIC, 4) != 0 or readAt<std::uint32_t>(4) != TrajectoryFormat::VERSION)
+            throw std::runtime_error("Not a trajectory file " + path);
+        dims = readAt<std::int32_t>(8);
+        const std::size_t footer = size - TrajectoryFormat::FOOTER_SIZE;
+        const std::uint64_t indexOffset = readAt<std::uint64_t>(footer);
+        const std::int32_t chunks = readAt<std::int32_t>(footer + 8);
+        if (std::memcmp(file.data() + footer + 12, TrajectoryFormat::INDEX_MAGIC, 4) != 0 or chunks < 0 or dims < 1 or
+            indexOffset + (std::uint64_t)chunks * TrajectoryFormat::INDEX_ENTRY_SIZE != footer)
+            throw std::runtime_error("Truncated trajectory file " + path);
+
+        index.resize(chunks);
+        for (int c = 0; c < chunks; c++)
+        {
+            const std::size_t at = indexOffset + c * TrajectoryFormat::INDEX_ENTRY_SIZE;
+            TrajectoryChunkIndex &entry = index[c];
+            entry.first = readAt<double>(at);
+            entry.last = readAt<double>(at + 8);
+            entry.offset = readAt<std::uint64_t>(at + 16);
+            entry.size = readAt<std::uint32_t>(at + 24);
+            entry.states = readAt<std::int32_t>(at + 28);
+            if (entry.offset + entry.size > indexOffset or entry.states < 1)
+                throw std::runtime_error("Corrupt trajectory index in " + path);
+            total += entry.states;
+        }
+    }
+
+    int dimensions() const
+    {
+        return dims;
+    }
+
+    int chunks() const
+    {
+        return (int)index.size();
+    }
+
+    long long states() const
+    {
+        return total;
+    }
+
+    const TrajectoryChunkIndex &chunk(int c) const
+    {
+        return index.at(c);
+    }
+
+    double startTime() const
+    {
+        return index.empty() ? 0 : index.front().first;
+    }
+
+    double endTime() const
+    {
+        return index.empty() ? 0 : index.back().last;
+    }
+
+    // the last chunk that starts at or before t (the first one if t is before the trajectory), -1 for an empty file
+    int findChunk(double t) const
+    {
+        if (index.empty())
+            return -1;
+        auto after = std::upper_bound(index.begin(), index.end(), t, [](double time, const TrajectoryChunkIndex &entry)
+                                      { return time < entry.first; });
+        return std::max(0, (int)(after - index.begin()) - 1);
+    }
+
+    // decodes chunk c, appending its times and its states (dimensions() values each) to times and states
+    void readChunk(int c, std::vector<double> &times, std::vector<double> &states) const
+    {
+        const TrajectoryChunkIndex &entry = index.at(c);
+        const unsigned char *p = file.data() + entry.offset;
+        const unsigned char *end = p + entry.size;
+        const int columns = dims + 1;
+        std::vector<std::uint64_t> previous(columns, 0), beforePrevious(columns, 0);
+        for (int k = 0; k < entry.states; k++)
+        {
+            for (int col = 0; col < columns; col++)
+            {
+                const std::uint64_t bits = predictBits(k, previous[col], beforePrevious[col]) + decodeResidual(p, end);
+                beforePrevious[col] = previous[col];
+                previous[col] = bits;
+                if (col == 0)
+                    times.push_back(bitsDouble(bits));
+                else
+                    states.push_back(bitsDouble(bits));
+            }
+        }
+        if (p != end)
+            throw std::runtime_error("Corrupt trajectory chunk");
+    }
+
+    // every state with from <= time <= to, only the chunks overlapping the interval are decoded
+    void read(double from, double to, std::vector<double> &times, std::vector<double> &states) const
+    {
+        times.clear();
+        states.clear();
+        std::vector<double> chunkTimes, chunkStates;
+        for (int c = std::max(0, findChunk(from)); c < chunks() and index[c].first <= to; c++)
+        {
+            if (index[c].last < from)
+                continue;
+            chunkTimes.clear();
+            chunkStates.clear();
+            readChunk(c, chunkTimes, chunkStates);
+            for (size_t k = 0; k < chunkTimes.size(); k++)
+            {
+                if (chunkTimes[k] < from or chunkTimes[k] > to)
+                    continue;
+                times.push_back(chunkTimes[k]);
+                states.insert(states.end(), chunkStates.begin() + k * dims, chunkStates.begin() + (k + 1) * dims);
+            }
+        }
+    }
+
+    // the last recorded state at or before t (the first state if t is before the trajectory)
+    std::vector<double> stateAt(double t, double *time = nullptr) const
+    {
+        const int c = findChunk(t);
+        if (c < 0)
+            throw std::out_of_range("Empty trajectory file");
+        std::vector<double> times, states;
+        readChunk(c, times, states);
+        const size_t k = std::max<std::ptrdiff_t>(0, std::upper_bound(times.begin(), times.end(), t) - times.begin() - 1);
+        if (time)
+            *time = times[k];
+        return std::vector<double>(states.begin() + k * dims, states.begin() + (k + 1) * dims);
+    }
+};
+
+// solver observer (see SolverStep) writing every accepted state to a trajectory file, at the time the solver gives it
+class TrajectoryRecorder
+{
+private:
+    TrajectoryWriter &writer;
+
+public:
+    long long states = 0; // written so far
+
+    TrajectoryRecorder(TrajectoryWriter &writer) : writer(writer) {}
+
+    void onStep(const SolverStep<double> &step)
+    {
+        writer.append(step.time, step.state);
+        states++;
+    }
+};
+
+// integrates a flight like getFinalPosition<Solver> and records every step of it in a trajectory file at path
+// the states ABM tries while refining the impact are not recorded, the impact itself is
+template <template <typename> class Solver = RK4>
+RK4Solution<double> recordTrajectory(const std::string &path, Vector3<double> initialPos, Vector3<double> initialV,
+                                     double stepSize = RK4Constants::STEP_SIZE, double maxFlightTime = RK4Constants::MAX_FLIGHT_TIME,
+                                     int chunkStates = TrajectoryFileConstants::CHUNK_STATES)
+{
+    TrajectoryWriter writer(path, 6, chunkStates);
+    TrajectoryRecorder recorder(writer);
+    RK4Solution<double> solution = getFinalPosition<Solver, double>(initialPos, initialV, stepSize, maxFlightTime, recorder);
+    if (recorder.states == 0)
+    {
+        // not integrated (see getFinalPosition): the launch state is all there is
+        const double initial[6] = {initialPos[0], initialPos[1], initialPos[2], initialV[0], initialV[1], initialV[2]};
+        writer.append(0.0, initial);
+    }
+    writer.close();
+    return solution;
+}
@@ -3,10 +3,17 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <functional>
+#include <limits>
 #include "linalg.h"
 #include "constants.h"
 #include "physics.h"
 #include "rk4.h"
+#include "cancellation.h"
 
 struct vAngle
 {
@@ -16,13 +23,89 @@ struct vAngle
     vAngle(double _v, double _e) : v(_v), eastAngle(_e) {};
 };
 
-Matrix<double> simulate(vAngle input, double groundAngle, const Vector3<double> &initialPos, Vector3<double> &inertialV, RK4Solution &sol, Vector3<double> &finalPos, Matrix<double> &m)
+// counters filled by the targeting solvers (accumulated, so one object can follow a whole optimization)
+struct TargetingStats
+{
+    int iterations = 0;
+    int simulations = 0;
+    long long integrationSteps = 0;
+    int solves = 0;
+    bool converged = false; // of the last solve
+};
+
+enum class TargetingStrategy
+{
+    Newton,            // finite-difference Jacobian every iteration (2 extra simulations each)
+    Broyden,           // finite differences once, rank-1 updates afterwards, backtracking line search
+    LevenbergMarquardt // finite-difference Jacobian, damped normal equations with trust-region control
+};
+
+// what the targeting solvers report as they go, see TargetingOptions::onProgress
+struct TargetingProgress
+{
+    int iteration = 0;             // Newton iterations of the solve in progress
+    double error = 0;              // its landing error (m)
+    double stepSize = 0;           // of the simulation that error comes from
+    vAngle current = vAngle(0, 0); // its inputs: speed (m/s) and eastAngle (deg)
+    double groundAngle = 0;
+    // optimizeTrajectory only: ground angles solved so far and the lowest energy solution among them
+    // (speed, eastAngle, groundAngle as it returns them)
+    int groundAngles = 0;
+    bool haveBest = false;
+    Vector3<double> best = Vector3<double>(0, 0, 0);
+};
+
+struct TargetingOptions
+{
+    // integrate coarsely while far from the target, see fidelityStepSize
+    bool multiFidelity = true;
+    // Broyden needs the fewest simulations on the strategy benchmark
+    TargetingStrategy strategy = TargetingStrategy::Broyden;
+    // optimizeTrajectory starts every ground angle from the ones already solved instead of the great circle guess
+    // off by default: it saves Newton iterations but not integration steps, the warm solves land differently enough
+    // within the tolerance that Brent needs more ground angles (see the optimization benchmark)
+    bool continuation = false;
+    // getInputsMixedPrecision (and so optimizeTrajectory) stop after the float stage, Precision<float>::LOCATION_TOLERANCE
+    bool floatOnly = false;
+    // called on the solving thread with every new iterate of getInputs and optimizeTrajectory, simulated at whatever
+    // fidelity it was
+    std::function<void(const TargetingProgress &)> onProgress;
+};
+
+// where a targeting solve starts and, once it returns, where it ended: inputs (v, eastAngle) and the Jacobian of the
+// landing point (lat, lon) with respect to them, normalized units; a solve handed a Jacobian skips the finite
+// differences of its first iteration (Broyden, the other strategies rebuild it anyway), one handed the landing error
+// starts at the fidelity that error calls for
+struct TargetingSeed
+{
+    vAngle x = vAngle(0, 0);
+    Matrix<double> J = Matrix<double>(2, 2);
+    bool haveJacobian = false;
+    double squaredError = -1; // squared landing error at x (radians), negative when unknown
+    double stepSize = 0;      // of the simulation a returning solve measured that error with
+};
+
+template <typename T>
+double fidelityStepSize(double squaredError, double tolerance, const TargetingOptions &options)
+{
+    // the landing point of a step-h simulation is only known to ~v*h (the impact step), so there is no point in
+    // integrating finely while the guess is far off: the step grows with the current error and is back to
+    // full fidelity once the error reaches the tolerance
+    const double fullFidelity = Precision<T>::STEP_SIZE;
+    if (!options.multiFidelity)
+        return fullFidelity;
+    return fullFidelity * std::clamp(std::sqrt(squaredError / tolerance), 1.0, RK4Constants::MAX_COARSENING);
+}
+
+template <typename T = double, template <typename> class Solver = RK4>
+Matrix<T> simulate(vAngle input, double groundAngle, const Vector3<T> &initialPos, Vector3<T> &inertialV, RK4Solution<T> &sol, Vector3<T> &finalPos, Matrix<T> &m, double stepSize = Precision<T>::STEP_SIZE)
 {
     // Given v(km/s), eastAngle (deg * norm), groundAngle (deg) and initialPosition, returns latitude and longitude in a matrix
     // Function needed for energy optimization
+    // T is the precision the trajectory is integrated in, stepSize its step, Solver the integrator
 
-    double radLatitude = (Math::pi / 2 - initialPos.phi());
-    double radLongitude = initialPos.theta();
+    T radLatitude = (T)(Math::pi / 2 - initialPos.phi());
+    T radLongitude = (T)initialPos.theta();
 
     input.eastAngle *= Math::pi / 180 / Physics::NORM_DEG;
     groundAngle *= Math::pi / 180;
@@ -30,32 +113,29 @@ Matrix<double> simulate(vAngle input, double groundAngle, const Vector3<double>
     inertialV =
         localToInertial(radLatitude,
                         radLongitude,
-                        input.v / Physics::NORM_VEL * Vector3<double>(cos(groundAngle) * cos(input.eastAngle), cos(groundAngle) * sin(input.eastAngle), sin(groundAngle)));
+                        (T)(input.v / Physics::NORM_VEL) * Vector3<T>(cos(groundAngle) * cos(input.eastAngle), cos(groundAngle) * sin(input.eastAngle), sin(groundAngle)));
 
-    sol = getFinalPosition(initialPos, inertialV);
+    sol = getFinalPosition<Solver>(initialPos, inertialV, (T)stepSize);
     finalPos = Vector3(sol.solutions(0, 0), sol.solutions(0, 1), sol.solutions(0, 2));
 
-    m(0, 0) = (Math::pi / 2 - finalPos.phi());
-    m(1, 0) = (finalPos.theta() - Physics::EARTH_ANGULAR_VELOCITY * sol.steps * RK4Constants::STEP_SIZE);
+    m(0, 0) = (T)(Math::pi / 2 - finalPos.phi());
+    m(1, 0) = (T)(finalPos.theta() - Physics::EARTH_ANGULAR_VELOCITY * sol.time);
     return m;
 }
 
-vAngle getInputs(double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos)
+template <typename T>
+double squaredLocationError(const Matrix<T> &y, const Matrix<T> &goal)
 {
+    // in squared radians, accumulated in double whatever T is
+    const double dlat = (double)y(0, 0) - (double)goal(0, 0);
+    const double dlon = (double)y(1, 0) - (double)goal(1, 0);
+    return dlat * dlat + dlon * dlon;
+}
 
-    std::cout << "\n Evaluating for ground angle " << groundAngle << std::endl;
-    // given a ground angle and initial and final positions, returns the velocity and east angle needed for a trajectory with those properties
-
-    // define all custom-class variables outside of computationally intensive loops
-    Vector3<double> inertialV;
-    RK4Solution sol(0, 0, 0, Matrix<double>(1, 1));
-    Vector3<double> finalSimulatedPos;
-    Matrix<double> m(2, 1);
-    Matrix<double> dv(2, 1);
-    Matrix<double> deA(2, 1);
-    Matrix<double> J(2, 2);
-
+vAngle greatCircleGuess(const Vector3<double> &initialPos, const Vector3<double> &finalPos)
+{
     // initial guess spherical math https://encyclopedai.stavros.io/entries/forward-azimuth/
+    // returns normalized units
     double lat1 = Math::pi / 2 - initialPos.phi();
     double lon1 = initialPos.theta();
     double lat2 = Math::pi / 2 - finalPos.phi();
@@ -64,29 +144,145 @@ vAngle getInputs(double groundAngle, const Vector3<double> &initialPos, const Ve
     double initialAngle = std::fmod(-180 / Math::pi * atan2(sin(dlon) * cos(lat2), cos(lat1) * sin(lat2) - sin(lat1) * cos(lat2) * cos(dlon)) + 450, 360);
 
     // std::cout << "INITIAL ANGLE " << initialAngle << std::endl;
-    vAngle x(1000.0 * Physics::NORM_VEL, initialAngle * Physics::NORM_DEG);
+    return vAngle(1000.0 * Physics::NORM_VEL, initialAngle * Physics::NORM_DEG);
+}
 
-    Matrix<double> y = simulate(x, groundAngle, initialPos, inertialV, sol, finalSimulatedPos, m);
-    Matrix<double> goal(2, 1);
-    goal(0, 0) = (Math::pi / 2 - finalPos.phi());
-    goal(1, 0) = finalPos.theta();
+template <typename T = double>
+vAngle refineInputs(vAngle x, double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos, double tolerance, const TargetingOptions &options = TargetingOptions(), TargetingStats *stats = nullptr,
+                    TargetingSeed *seed = nullptr)
+{
+    // Newton-type iteration on (v, eastAngle) (normalized units, in and out) integrating in precision T
+    // stops once the squared landing error (radians) is below tolerance at full fidelity
+    // options.strategy picks how the Jacobian is obtained and how steps are controlled
+    // seed, if given, supplies the first Jacobian and gets the final inputs and Jacobian back
+    // throws SolveCancelled once the token of the thread's CancellationScope is cancelled
 
+    // define all custom-class variables outside of computationally intensive loops
+    const double eps = Precision<T>::DIFFERENTIATION_STEP;
+    const Vector3<T> start((T)initialPos.x, (T)initialPos.y, (T)initialPos.z);
+    Vector3<T> inertialV;
+    RK4Solution<T> sol(0, 0, 0, Matrix<T>(1, 1));
+    Vector3<T> finalSimulatedPos;
+    Matrix<T> m(2, 1);
+    Matrix<T> dv(2, 1);
+    Matrix<T> deA(2, 1);
+    Matrix<T> J(2, 2);
+    Matrix<T> trial(2, 1);
+
+    Matrix<T> goal(2, 1);
+    goal(0, 0) = (T)(Math::pi / 2 - finalPos.phi());
+    goal(1, 0) = (T)finalPos.theta();
+
+    int simulations = 0;
+    long long integrationSteps = 0;
+    bool impacted = true; // whether the last simulation came back down
+    auto wrap = [](vAngle input)
+    {
+        // handle orbital speed
+        if (input.v > 7909 * Physics::NORM_VEL)
+            std::cout << "Warning: orbital speeds reached\n";
+        // handle negative speed
+        if (input.v < 0)
+        {
+            // trust that our program will not crash
+            std::cout << "Warning: negative speeds reached\n";
+            input.v *= -1;
+            input.eastAngle += 180 * Physics::NORM_DEG;
+        }
+        // handle angle wrapping
+        input.eastAngle = std::fmod(input.eastAngle, 360 * Physics::NORM_DEG);
+        return input;
+    };
+    auto run = [&](vAngle input, double stepSize)
+    {
+        simulations++;
+        Matrix<T> result = simulate(input, groundAngle, start, inertialV, sol, finalSimulatedPos, m, stepSize);
+        integrationSteps += sol.steps;
+        if (sol.status == SolutionStatus::Cancelled)
+            throw SolveCancelled();
+        impacted = sol.status == SolutionStatus::EndCondition;
+        return result;
+    };
+    auto backOff = [&](vAngle from, vAngle to, double stepSize)
+    {
+        // moves from "to" back towards "from" until the trajectory lands again (escape, orbit or too long a flight)
+        Matrix<T> result = run(wrap(to), stepSize);
+        for (int backtrack = 0; !impacted and backtrack < Physics::MAX_BACKTRACKS; backtrack++)
+        {
+            std::cout << "Warning: trajectory does not come back down, backing off\n";
+            to = vAngle((from.v + to.v) / 2, (from.eastAngle + to.eastAngle) / 2);
+            result = run(wrap(to), stepSize);
+        }
+        return std::make_pair(wrap(to), result);
+    };
+    auto column = [&](vAngle plus, vAngle minus, const Matrix<T> &center, double stepSize)
+    {
+        // forward difference, backward when the forward point does not land
+        Matrix<T> difference = run(plus, stepSize) - center;
+        if (!impacted)
+            difference = center - run(minus, stepSize);
+        return difference;
+    };
+
+    // the first guess is assumed to be far away unless the seed knows better
+    const double farAway = tolerance * RK4Constants::MAX_COARSENING * RK4Constants::MAX_COARSENING;
+    double stepSize = fidelityStepSize<T>((seed and seed->squaredError >= 0) ? seed->squaredError : farAway, tolerance, options);
+    Matrix<T> y(2, 1);
+    std::tie(x, y) = backOff(vAngle(0, x.eastAngle), x, stepSize);
+    int iterations = 0;
     int nonInvertibleJacobianCount = 0;
-
-    while (((y - goal).transpose() * (y - goal))(0, 0) > Physics::LOCATION_TOLERANCE)
+    bool haveJacobian = false;
+    if (seed and seed->haveJacobian)
     {
-        // simulate again
-        y = simulate(x, groundAngle, initialPos, inertialV, sol, finalSimulatedPos, m);
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+                J(i, j) = (T)seed->J(i, j);
+        haveJacobian = true;
+    }
+    double damping = Physics::LM_INITIAL_DAMPING;
+    double dampingGrowth = 2;
 
-        // get new guess by assuming linear function
-        dv = simulate(vAngle(x.v + Math::eps, x.eastAngle), groundAngle, initialPos, inertialV, sol, finalSimulatedPos, m) - y;
-        deA = simulate(vAngle(x.v, x.eastAngle + Math::eps), groundAngle, initialPos, inertialV, sol, finalSimulatedPos, m) - y;
-        J(0, 0) = dv(0, 0);
-        J(1, 0) = dv(1, 0);
-        J(0, 1) = deA(0, 0);
-        J(1, 1) = deA(1, 0);
+    while (iterations < Physics::MAX_TARGETING_ITERATIONS)
+    {
+        // the matrices made during an iteration live in the thread's arena and are given back when it ends, whatever
+        // has to be kept (x, y, J, sol...) is copied into the matrices made above
+        ArenaScope iteration;
+        if (options.onProgress)
+        {
+            TargetingProgress progress;
+            progress.iteration = iterations;
+            progress.error = std::sqrt(squaredLocationError(y, goal)) * Physics::EARTH_RADIUS;
+            progress.stepSize = stepSize;
+            progress.current = vAngle(x.v / Physics::NORM_VEL, x.eastAngle / Physics::NORM_DEG);
+            progress.groundAngle = groundAngle;
+            options.onProgress(progress);
+        }
+        // tighten the fidelity as we approach the target, the last simulations always run at full fidelity
+        const double wantedStepSize = fidelityStepSize<T>(squaredLocationError(y, goal), tolerance, options);
+        if (wantedStepSize < stepSize)
+        {
+            stepSize = wantedStepSize;
+            y = run(x, stepSize);
+            continue;
+        }
+        if (squaredLocationError(y, goal) <= tolerance)
+            break;
+        iterations++;
 
-        J = 1 / Math::eps * J;
+        // Broyden keeps its Jacobian between iterations, the others rebuild it
+        if (options.strategy != TargetingStrategy::Broyden or !haveJacobian)
+        {
+            // get new guess by assuming linear function
+            dv = column(vAngle(x.v + eps, x.eastAngle), vAngle(x.v - eps, x.eastAngle), y, stepSize);
+            deA = column(vAngle(x.v, x.eastAngle + eps), vAngle(x.v, x.eastAngle - eps), y, stepSize);
+            J(0, 0) = dv(0, 0);
+            J(1, 0) = dv(1, 0);
+            J(0, 1) = deA(0, 0);
+            J(1, 1) = deA(1, 0);
+
+            J = (T)(1 / eps) * J;
+            haveJacobian = true;
+        }
 
         if (std::abs(J.det()) < Math::DETERMINANT_ZERO) // TODO: add this to constants
         {
@@ -97,6 +293,7 @@ vAngle getInputs(double groundAngle, const Vector3<double> &initialPos, const Ve
                       << std::endl;
             // hopefully just a bad initial guess so we modify it
             x.eastAngle = std::fmod(x.eastAngle + 330.0 * Physics::NORM_DEG, 360 * Physics::NORM_DEG);
+            haveJacobian = false;
 
             nonInvertibleJacobianCount++;
             if (nonInvertibleJacobianCount > 3)
@@ -104,118 +301,560 @@ vAngle getInputs(double groundAngle, const Vector3<double> &initialPos, const Ve
                 std::cout << "Non-invertible Jacobian count exceeded.\n";
                 break;
             }
+            y = run(x, stepSize);
             continue;
         }
 
-        // this helps the process take smaller steps whenever the difference is very large
-        // the jacobian will vary greatly and the linear approximation will take our object to mars
-        double convCoeff = std::max(0.1, exp(-Physics::CONVERGENGE_COEFFICIENT * ((y - goal).transpose() * (y - goal))(0, 0)));
+        const Matrix<T> residual = goal - y;
+        const double error2 = squaredLocationError(y, goal);
+        switch (options.strategy)
+        {
+        case TargetingStrategy::Newton:
+        {
+            // this helps the process take smaller steps whenever the difference is very large
+            // the jacobian will vary greatly and the linear approximation will take our object to mars
+            double convCoeff = std::max(0.1, exp(-Physics::CONVERGENGE_COEFFICIENT * error2));
 
-        Matrix<double> delta = J.inverse() * (goal - y);
-        x.v += delta(0, 0) * convCoeff;
-        x.eastAngle += delta(1, 0) * convCoeff * convCoeff;
+            Matrix<T> delta = J.inverse() * residual;
+            vAngle next = x;
+            next.v += delta(0, 0) * convCoeff;
+            next.eastAngle += delta(1, 0) * convCoeff * convCoeff;
 
-        // handle orbital speed
-        if (x.v > 7909 * Physics::NORM_VEL)
-            std::cout << "Warning: orbital speeds reached\n";
-        // handle negative speed
-        if (x.v < 0)
+            // simulate again
+            std::tie(x, y) = backOff(x, next, stepSize);
+            break;
+        }
+        case TargetingStrategy::Broyden:
         {
-            // trust that our program will not crash
-            std::cout << "Warning: negative speeds reached\n";
-            x.v *= -1;
-            x.eastAngle += 180 * Physics::NORM_DEG;
+            // full quasi-Newton step, halved until the landing error decreases
+            Matrix<T> delta = J.inverse() * residual;
+            double lambda = 1;
+            bool improved = false;
+            vAngle candidate = x;
+            for (int backtrack = 0; backtrack <= Physics::MAX_BACKTRACKS; backtrack++, lambda /= 2)
+            {
+                candidate = wrap(vAngle(x.v + lambda * delta(0, 0), x.eastAngle + lambda * delta(1, 0)));
+                trial = run(candidate, stepSize);
+                if (impacted and squaredLocationError(trial, goal) < error2)
+                {
+                    improved = true;
+                    break;
+                }
+            }
+            if (!improved)
+            {
+                // the secant model is stale, rebuild it from finite differences next iteration
+                haveJacobian = false;
+                break;
+            }
+
+            // rank-1 update so that J maps the step taken onto the change observed
+            const double sx = lambda * delta(0, 0), se = lambda * delta(1, 0);
+            const double s2 = sx * sx + se * se;
+            const double r0 = (double)(trial(0, 0) - y(0, 0)) - (double)(J(0, 0) * sx + J(0, 1) * se);
+            const double r1 = (double)(trial(1, 0) - y(1, 0)) - (double)(J(1, 0) * sx + J(1, 1) * se);
+            J(0, 0) += (T)(r0 * sx / s2);
+            J(0, 1) += (T)(r0 * se / s2);
+            J(1, 0) += (T)(r1 * sx / s2);
+            J(1, 1) += (T)(r1 * se / s2);
+
+            // a step that did not at least halve the squared error means the secant model has drifted, rebuild it rather
+            // than spend more iterations on it
+            if (squaredLocationError(trial, goal) > 0.5 * error2)
+                haveJacobian = false;
+
+            x = candidate;
+            y = trial;
+            break;
         }
-        // handle angle wrapping
-        x.eastAngle = std::fmod(x.eastAngle, 360 * Physics::NORM_DEG);
-
-        /*std::cout << std::endl
-                  << "Goal is \n"
-                  << goal;
-        std::cout
-            << "Guess is \n"
-            << y;
-        std::cout << "Jacobian is \n"
-                  << J; */
-        std::cout << "  Current error: " << std::sqrt(((y - goal).transpose() * (y - goal))(0, 0)) * Physics::EARTH_RADIUS << "m       time: " << sol.steps * RK4Constants::STEP_SIZE << "s" << std::endl;
-        /*std::cout << "New guess is " << x.v / Physics::NORM_VEL << ", " << x.eastAngle / Physics::NORM_DEG << std::endl
-                  << std::endl; */
+        case TargetingStrategy::LevenbergMarquardt:
+        {
+            // (J^T J + mu diag(J^T J)) delta = J^T r, mu follows the ratio of actual to predicted reduction
+            const Matrix<T> JtJ = J.transpose() * J;
+            const Matrix<T> gradient = J.transpose() * residual;
+            for (int attempt = 0; attempt <= Physics::MAX_BACKTRACKS; attempt++)
+            {
+                Matrix<T> damped = JtJ;
+                damped(0, 0) += (T)(damping * JtJ(0, 0));
+                damped(1, 1) += (T)(damping * JtJ(1, 1));
+                Matrix<T> delta = damped.inverse() * gradient;
+
+                const vAngle candidate = wrap(vAngle(x.v + delta(0, 0), x.eastAngle + delta(1, 0)));
+                trial = run(candidate, stepSize);
+
+                // reduction of 1/2 |r|^2 predicted by the linear model
+                const double predicted = 0.5 * (double)(delta(0, 0) * (damping * JtJ(0, 0) * delta(0, 0) + gradient(0, 0)) +
+                                                        delta(1, 0) * (damping * JtJ(1, 1) * delta(1, 0) + gradient(1, 0)));
+                const double actual = 0.5 * (error2 - squaredLocationError(trial, goal));
+                const double ratio = (predicted > 0 and impacted) ? actual / predicted : -1;
+                if (ratio > 0)
+                {
+                    damping *= std::max(1.0 / 3, 1 - std::pow(2 * ratio - 1, 3));
+                    dampingGrowth = 2;
+                    x = candidate;
+                    y = trial;
+                    break;
+                }
+                damping *= dampingGrowth;
+                dampingGrowth *= 2;
+            }
+            break;
+        }
+        }
+
+        std::cout << "  Current error: " << std::sqrt(squaredLocationError(y, goal)) * Physics::EARTH_RADIUS << "m       time: " << sol.time << "s       step: " << stepSize << "s" << std::endl;
+    }
+
+    if (stats)
+    {
+        stats->iterations += iterations;
+        stats->simulations += simulations;
+        stats->integrationSteps += integrationSteps;
+        stats->solves++;
+        stats->converged = squaredLocationError(y, goal) <= tolerance and stepSize == Precision<T>::STEP_SIZE;
+    }
+    if (seed)
+    {
+        seed->x = x;
+        for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+                seed->J(i, j) = (double)J(i, j);
+        seed->haveJacobian = haveJacobian;
+        seed->squaredError = squaredLocationError(y, goal);
+        seed->stepSize = stepSize;
     }
+    return x;
+}
+
+template <typename T = double>
+vAngle getInputs(double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos, const TargetingOptions &options = TargetingOptions(), TargetingStats *stats = nullptr,
+                 TargetingSeed *seed = nullptr)
+{
+
+    std::cout << "\n Evaluating for ground angle " << groundAngle << std::endl;
+    // given a ground angle and initial and final positions, returns the velocity and east angle needed for a trajectory with those properties
+    // T is the precision of the integration, float only reaches Precision<float>::LOCATION_TOLERANCE
+    // without a seed the solve starts from the great circle guess, with one from seed->x (see TargetingSeed)
+    vAngle x = refineInputs<T>(seed ? seed->x : greatCircleGuess(initialPos, finalPos), groundAngle, initialPos, finalPos, Precision<T>::LOCATION_TOLERANCE, options, stats, seed);
+
     x.v /= Physics::NORM_VEL;
     x.eastAngle /= Physics::NORM_DEG;
     std::cout << "Speed is " << x.v << std::endl;
     return x;
 }
 
-Vector3<double> optimizeTrajectory(Vector3<double> initialPos, Vector3<double> finalPos, double m)
+vAngle getInputsMixedPrecision(double groundAngle, const Vector3<double> &initialPos, const Vector3<double> &finalPos, const TargetingOptions &options = TargetingOptions(), TargetingStats *stats = nullptr,
+                               TargetingSeed *seed = nullptr)
+{
+    // same as getInputs, but the coarse iterations run in float (longer steps, cheaper simulations)
+    // and only the final refinement runs in double
+    std::cout << "\n Evaluating for ground angle " << groundAngle << std::endl;
+    TargetingSeed own;
+    if (!seed)
+    {
+        own.x = greatCircleGuess(initialPos, finalPos);
+        seed = &own;
+    }
+    const bool warm = seed->haveJacobian;
+    vAngle x = refineInputs<float>(seed->x, groundAngle, initialPos, finalPos, Precision<float>::LOCATION_TOLERANCE, options, stats, seed);
+    // the double stage starts coarse as always (the float landing error says little about a double simulation) and
+    // keeps the Jacobian only if the solve was handed one, so a cold solve runs just as it does without a seed
+    if (!options.floatOnly)
+    {
+        seed->haveJacobian = warm;
+        seed->squaredError = -1;
+        x = refineInputs<double>(x, groundAngle, initialPos, finalPos, Precision<double>::LOCATION_TOLERANCE, options, stats, seed);
+    }
+
+    x.v /= Physics::NORM_VEL;
+    x.eastAngle /= Physics::NORM_DEG;
+    std::cout << "Speed is " << x.v << std::endl;
+    return x;
+}
+
+template <typename F>
+double brentMinimize(F f, double a, double b, double tolerance, int maxEvaluations, int *evaluations = nullptr)
+{
+    // Brent's method on [a, b]: parabolic interpolation through the three best points, falling back to golden section
+    // whenever the parabola is not trustworthy, so the bracket always shrinks and f is never evaluated outside [a, b]
+    // returns the best point found, which is always one where f was evaluated
+    const double golden = 0.5 * (3 - std::sqrt(5.0));
+    double x = a + golden * (b - a);
+    double w = x, v = x;
+    double fx = f(x);
+    double fw = fx, fv = fx;
+    double d = 0, e = 0;
+    int count = 1;
+
+    while (count < maxEvaluations)
+    {
+        const double xm = 0.5 * (a + b);
+        const double tol1 = tolerance;
+        const double tol2 = 2 * tol1;
+        if (std::abs(x - xm) <= tol2 - 0.5 * (b - a))
+            break;
+
+        bool parabolic = false;
+        if (std::abs(e) > tol1)
+        {
+            double r = (x - w) * (fx - fv);
+            double q = (x - v) * (fx - fw);
+            double p = (x - v) * q - (x - w) * r;
+            q = 2 * (q - r);
+            if (q > 0)
+                p = -p;
+            q = std::abs(q);
+            const double previousE = e;
+            e = d;
+            if (std::abs(p) < std::abs(0.5 * q * previousE) and p > q * (a - x) and p < q * (b - x))
+            {
+                d = p / q;
+                const double u = x + d;
+                // never evaluate too close to the bracket ends
+                if (u - a < tol2 or b - u < tol2)
+                    d = (xm >= x) ? tol1 : -tol1;
+                parabolic = true;
+            }
+        }
+        if (!parabolic)
+        {
+            e = (x >= xm) ? a - x : b - x;
+            d = golden * e;
+        }
+
+        const double u = (std::abs(d) >= tol1) ? x + d : x + ((d >= 0) ? tol1 : -tol1);
+        const double fu = f(u);
+        count++;
+
+        if (fu <= fx)
+        {
+            if (u >= x)
+                a = x;
+            else
+                b = x;
+            v = w;
+            fv = fw;
+            w = x;
+            fw = fx;
+            x = u;
+            fx = fu;
+        }
+        else
+        {
+            if (u < x)
+                a = u;
+            else
+                b = u;
+            if (fu <= fw or w == x)
+            {
+                v = w;
+                fv = fw;
+                w = u;
+                fw = fu;
+            }
+            else if (fu <= fv or v == x or v == w)
+            {
+                v = u;
+                fv = fu;
+            }
+        }
+    }
+
+    if (evaluations)
+        *evaluations = count;
+    return x;
+}
+
+Vector3<double> optimizeTrajectory(Vector3<double> initialPos, Vector3<double> finalPos, double m, TargetingStats *totalStats = nullptr,
+                                   const TargetingOptions &options = TargetingOptions())
 {
     // given positions, returns best velocity
     // slightly cheating by using Vector3 to store coords
-    std::vector<double> bestAngles = {}; // ground angles
-    std::vector<vAngle> inputs = {};     // will store the velocities and eastAngles
-    std::vector<double> energies = {};
-
-    // we make initial guesses
-    bestAngles.push_back(35);
-    inputs.push_back(getInputs(35, initialPos, finalPos));
-    energies.push_back(m * inputs[0].v * inputs[0].v / 2);
-
-    bestAngles.push_back(45);
-    inputs.push_back(getInputs(45, initialPos, finalPos));
-    energies.push_back(m * inputs[1].v * inputs[1].v / 2);
-
-    bestAngles.push_back(65);
-    inputs.push_back(getInputs(65, initialPos, finalPos));
-    energies.push_back(m * inputs[2].v * inputs[2].v / 2);
-
-    // we will iterate through the minimums of the parabolas formed by our 3 best guesses until we sort of converge
-    int maxIndex = 0, minIndex = 0;
-    for (int i = 1; i < 3; i++)
-    {
-        if (energies[i] < energies[minIndex])
-            minIndex = i;
-        if (energies[i] > energies[maxIndex])
-            maxIndex = i;
+    // the energy is minimized over the ground angle with Brent's method, every candidate angle is solved once
+    std::map<double, TargetingSeed> solved; // ground angle -> velocity, eastAngle and Jacobian (normalized)
+    std::vector<std::pair<double, int>> iterations; // Newton iterations per ground angle, in the order Brent asks
+    std::map<double, bool> converged;               // whether the solve of each ground angle landed on the target
+    TargetingStats stats;
+    // progress of the inner solves goes out with what the optimization knows so far
+    TargetingProgress known;
+    TargetingOptions inner = options;
+    auto report = [&](const TargetingProgress &progress)
+    {
+        TargetingProgress p = progress;
+        p.groundAngles = known.groundAngles;
+        p.haveBest = known.haveBest;
+        p.best = known.best;
+        options.onProgress(p);
+    };
+    if (options.onProgress)
+        inner.onProgress = report;
+    auto energy = [&](double groundAngle)
+    {
+        auto it = solved.find(groundAngle);
+        if (it == solved.end())
+        {
+            // natural parameter continuation: the inputs move smoothly with the ground angle, so a new angle starts
+            // from the line through its two nearest solved neighbours, with the Jacobian of the nearest; next to a
+            // single neighbour the first Broyden step from it with its Jacobian is the first order prediction itself
+            TargetingSeed seed;
+            seed.x = greatCircleGuess(initialPos, finalPos);
+            bool warm = false;
+            if (options.continuation and !solved.empty())
+            {
+                auto nearest = solved.begin(), second = solved.end();
+                for (auto s = solved.begin(); s != solved.end(); ++s)
+                    if (std::abs(s->first - groundAngle) < std::abs(nearest->first - groundAngle))
+                        nearest = s;
+                for (auto s = solved.begin(); s != solved.end(); ++s)
+                    if (s != nearest and (second == solved.end() or std::abs(s->first - groundAngle) < std::abs(second->first - groundAngle)))
+                        second = s;
+                seed = nearest->second;
+                seed.squaredError = -1; // unknown, so the first simulations still run coarse
+                if (second != solved.end())
+                {
+                    const double t = (groundAngle - nearest->first) / (second->first - nearest->first);
+                    seed.x.v += t * (second->second.x.v - nearest->second.x.v);
+                    seed.x.eastAngle += t * (second->second.x.eastAngle - nearest->second.x.eastAngle);
+                }
+                warm = true;
+            }
+            const int before = stats.iterations;
+            getInputsMixedPrecision(groundAngle, initialPos, finalPos, inner, &stats, &seed);
+            if (warm and !stats.converged)
+            {
+                std::cout << "Warning: warm started solve did not converge, starting over from the great circle guess\n";
+                seed = TargetingSeed();
+                seed.x = greatCircleGuess(initialPos, finalPos);
+                getInputsMixedPrecision(groundAngle, initialPos, finalPos, inner, &stats, &seed);
+            }
+            iterations.emplace_back(groundAngle, stats.iterations - before);
+            it = solved.emplace(groundAngle, seed).first;
+            converged[groundAngle] = stats.converged;
+
+            const vAngle x(seed.x.v / Physics::NORM_VEL, seed.x.eastAngle / Physics::NORM_DEG);
+            known.groundAngles++;
+            if (stats.converged and (!known.haveBest or x.v < known.best[0]))
+            {
+                known.haveBest = true;
+                known.best = Vector3<double>(x.v, x.eastAngle, groundAngle);
+            }
+            if (options.onProgress)
+            {
+                TargetingProgress progress;
+                progress.iteration = iterations.back().second;
+                progress.error = std::sqrt(std::max(0.0, seed.squaredError)) * Physics::EARTH_RADIUS;
+                progress.stepSize = seed.stepSize;
+                progress.current = x;
+                progress.groundAngle = groundAngle;
+                report(progress);
+            }
+        }
+        // a solve that did not land says nothing about the energy there, it must never be picked as the optimum
+        if (!converged.at(groundAngle))
+            return std::numeric_limits<double>::infinity();
+        const double v = it->second.x.v / Physics::NORM_VEL;
+        return m * v * v / 2;
+    };
+
+    const double bestAngle = brentMinimize(energy, Physics::MIN_GROUND_ANGLE, Physics::MAX_GROUND_ANGLE, Physics::GROUND_ANGLE_TOLERANCE, Physics::MAX_OPTIMIZATION_EVALUATIONS);
+    const vAngle best = solved.at(bestAngle).x;
+
+    std::cout << "\nOptimization evaluated " << solved.size() << " ground angles: "
+              << stats.iterations << " Newton iterations, " << stats.simulations << " simulations" << std::endl;
+    std::cout << "Iterations per ground angle" << (options.continuation ? " (warm started)" : "") << ":";
+    for (const auto &angle : iterations)
+        std::cout << " " << angle.first << ":" << angle.second;
+    std::cout << std::endl;
+    if (totalStats)
+    {
+        totalStats->iterations += stats.iterations;
+        totalStats->simulations += stats.simulations;
+        totalStats->integrationSteps += stats.integrationSteps;
+        totalStats->solves += stats.solves;
+        totalStats->converged = converged.at(bestAngle);
     }
-    while (energies[maxIndex] - energies[minIndex] > Physics::ENERGY_TOLERANCE)
+    return Vector3<double>(best.v / Physics::NORM_VEL, best.eastAngle / Physics::NORM_DEG, bestAngle);
+}
+
+Vector3<double> optimizeTrajectoryJoint(Vector3<double> initialPos, Vector3<double> finalPos, double m, TargetingStats *stats = nullptr)
+{
+    // minimizes the launch energy m v^2 / 2 over (v, eastAngle, groundAngle) subject to landing on finalPos,
+    // instead of nesting a targeting solve inside a ground angle search
+    // reduced-space SQP: with x = (v, eastAngle, groundAngle) and landing constraint c(x) = 0 (2 equations),
+    // A = dc/dx is 2x3 and its null space is spanned by z = A(0) x A(1). Every iteration takes
+    //   - a minimum-norm Newton step back onto the constraint, -A^T (A A^T)^-1 c
+    //   - a step along z that drives the reduced gradient dE/dz to 0 (secant inside a sign-change bracket)
+    // and the KKT conditions (c = 0, grad E = A^T lambda) hold when both vanish
+    // one Jacobian per iteration serves both steps
+    // near the optimum the landing point barely depends on the ground angle (that is what makes it optimal), so that
+    // column uses central differences and the simulations use ABM, whose impact refinement removes the step noise
+    const double eps = Precision<double>::DIFFERENTIATION_STEP;
+    const double tolerance = Precision<double>::LOCATION_TOLERANCE;
+    TargetingOptions options;
+    Vector3<double> inertialV, finalSimulatedPos;
+    RK4Solution<double> sol(0, 0, 0, Matrix<double>(1, 1));
+    Matrix<double> mm(2, 1), goal(2, 1), A(2, 3);
+    goal(0, 0) = Math::pi / 2 - finalPos.phi();
+    goal(1, 0) = finalPos.theta();
+
+    int simulations = 0;
+    long long integrationSteps = 0;
+    bool impacted = true; // whether the last simulation came back down
+    auto run = [&](const Vector3<double> &x, double stepSize)
     {
-        // obtain new guess
-        // this could be simplified but i do not want to
-        const double d01 = (energies[0] - energies[1]) / (bestAngles[0] - bestAngles[1]);
-        const double d02 = (energies[0] - energies[2]) / (bestAngles[0] - bestAngles[2]);
-        const double a = (d01 - d02) / (bestAngles[1] - bestAngles[2]);
-        double newAngle = (-d01 / a + bestAngles[0] + bestAngles[1]) / 2;
-        vAngle newvAngle = getInputs(newAngle, initialPos, finalPos);
+        simulations++;
+        Matrix<double> result = simulate<double, ABM>(vAngle(x[0], x[1]), x[2], initialPos, inertialV, sol, finalSimulatedPos, mm, stepSize);
+        integrationSteps += sol.steps;
+        if (sol.status == SolutionStatus::Cancelled)
+            throw SolveCancelled();
+        impacted = sol.status == SolutionStatus::EndCondition;
+        return result;
+    };
+
+    vAngle guess = greatCircleGuess(initialPos, finalPos);
+    Vector3<double> x(guess.v, guess.eastAngle, 0.5 * (Physics::MIN_GROUND_ANGLE + Physics::MAX_GROUND_ANGLE));
+    double stepSize = fidelityStepSize<double>(tolerance * RK4Constants::MAX_COARSENING * RK4Constants::MAX_COARSENING, tolerance, options);
+    Matrix<double> y = run(x, stepSize);
+
+    // the ground angle parametrizes the constraint manifold, the optimum is a root of the reduced gradient in it
+    double lowAngle = Physics::MIN_GROUND_ANGLE, highAngle = Physics::MAX_GROUND_ANGLE; // reduced gradient < 0 below, > 0 above
+    bool haveSecant = false;
+    double previousGroundAngle = 0, previousReducedGradient = 0;
+    double tangentStep = Physics::MAX_GROUND_ANGLE - Physics::MIN_GROUND_ANGLE;
+    bool converged = false;
+    int iterations = 0;
+
+    while (iterations < Physics::MAX_OPTIMIZATION_ITERATIONS)
+    {
+        const double wantedStepSize = fidelityStepSize<double>(squaredLocationError(y, goal), tolerance, options);
+        if (wantedStepSize < stepSize)
+        {
+            stepSize = wantedStepSize;
+            y = run(x, stepSize);
+            continue;
+        }
+        const double error2 = squaredLocationError(y, goal);
+        if (error2 <= tolerance and std::abs(tangentStep) <= Physics::GROUND_ANGLE_TOLERANCE)
+        {
+            converged = true;
+            break;
+        }
+        iterations++;
 
-        // run max to get replaceable angle
-        maxIndex = 0;
-        for (int i = 1; i < 3; i++)
+        // constraint Jacobian, forward differences in speed and east angle, central in ground angle
+        for (int j = 0; j < 2; j++)
         {
-            if (energies[i] > energies[maxIndex])
-                maxIndex = i;
+            Vector3<double> xj = x;
+            xj[j] += eps;
+            Matrix<double> dy = run(xj, stepSize) - y;
+            if (!impacted)
+            {
+                // backward difference when the forward point does not land
+                xj[j] -= 2 * eps;
+                dy = y - run(xj, stepSize);
+            }
+            A(0, j) = dy(0, 0) / eps;
+            A(1, j) = dy(1, 0) / eps;
         }
-        // replace it
-        if (energies[maxIndex] > m * newvAngle.v * newvAngle.v / 2)
         {
-            bestAngles[maxIndex] = newAngle;
-            inputs[maxIndex] = newvAngle;
-            energies[maxIndex] = m * newvAngle.v * newvAngle.v / 2;
+            const double h = Physics::GROUND_ANGLE_DIFFERENTIATION_STEP;
+            Matrix<double> dy = run(x + Vector3<double>(0, 0, h), stepSize) - run(x - Vector3<double>(0, 0, h), stepSize);
+            A(0, 2) = dy(0, 0) / (2 * h);
+            A(1, 2) = dy(1, 0) / (2 * h);
         }
-        else
+
+        // null space direction, scaled so that it moves the ground angle by one degree
+        Vector3<double> z = cross(Vector3<double>(A(0, 0), A(0, 1), A(0, 2)), Vector3<double>(A(1, 0), A(1, 1), A(1, 2)));
+        Matrix<double> AAt = A * A.transpose();
+        if (std::abs(AAt.det()) < Math::DETERMINANT_ZERO or std::abs(z[2]) < Math::DETERMINANT_ZERO)
         {
-            std::cout << "The minimum has been already found, could not optimize until required energy tolerance\n";
+            std::cout << "Warning: joint optimization encountered a degenerate constraint Jacobian\n";
             break;
         }
+        z = (1 / z[2]) * z;
 
-        // run max and min to check for tolerance
-        maxIndex = 0, minIndex = 0;
-        for (int i = 1; i < 3; i++)
+        // restoration step (damped like the targeting loop while far away)
+        double convCoeff = std::max(0.1, exp(-Physics::CONVERGENGE_COEFFICIENT * error2));
+        Matrix<double> normal = A.transpose() * (AAt.inverse() * (goal - y));
+        Vector3<double> step(normal(0, 0) * convCoeff, normal(1, 0) * convCoeff * convCoeff, normal(2, 0) * convCoeff);
+
+        // optimality step, only once the iterate is close to the constraint so the reduced gradient means something
+        tangentStep = Physics::MAX_GROUND_ANGLE - Physics::MIN_GROUND_ANGLE;
+        if (error2 < Physics::TANGENT_STEP_THRESHOLD)
+        {
+            // dE/dgroundAngle along the constraint (per unit mass)
+            const double g = x[2] + step[2];
+            const double reducedGradient = x[0] * z[0];
+            if (reducedGradient < 0)
+                lowAngle = std::max(lowAngle, g);
+            else
+                highAngle = std::min(highAngle, g);
+
+            double target = g + ((reducedGradient > 0) ? -Physics::MAX_GROUND_ANGLE_STEP : Physics::MAX_GROUND_ANGLE_STEP);
+            if (haveSecant and g != previousGroundAngle)
+            {
+                const double curvature = (reducedGradient - previousReducedGradient) / (g - previousGroundAngle);
+                if (curvature > 0)
+                    target = g - reducedGradient / curvature;
+            }
+            // keep the step inside the bracket and below the maximum move, bisect when the secant leaves it
+            if (target <= lowAngle or target >= highAngle)
+                target = (lowAngle > Physics::MIN_GROUND_ANGLE and highAngle < Physics::MAX_GROUND_ANGLE) ? 0.5 * (lowAngle + highAngle) : std::clamp(target, lowAngle, highAngle);
+            tangentStep = std::clamp(target - g, -Physics::MAX_GROUND_ANGLE_STEP, Physics::MAX_GROUND_ANGLE_STEP);
+
+            haveSecant = true;
+            previousGroundAngle = g;
+            previousReducedGradient = reducedGradient;
+            step = step + tangentStep * z;
+        }
+
+        // halve the step while the trajectory does not come back down (escape, orbit or too long a flight)
+        Vector3<double> next = x + step;
+        Matrix<double> trial(2, 1);
+        bool landed = false;
+        for (int backtrack = 0; backtrack <= Physics::MAX_BACKTRACKS; backtrack++)
+        {
+            next = x + step;
+            if (next[0] < 0)
+            {
+                std::cout << "Warning: negative speeds reached\n";
+                next[0] *= -1;
+                next[1] += 180 * Physics::NORM_DEG;
+            }
+            next[1] = std::fmod(next[1], 360 * Physics::NORM_DEG);
+            // the restoration step moves the ground angle too, keep it in range like the Brent search does
+            next[2] = std::clamp(next[2], Physics::MIN_GROUND_ANGLE, Physics::MAX_GROUND_ANGLE);
+            trial = run(next, stepSize);
+            if (impacted)
+            {
+                landed = true;
+                break;
+            }
+            std::cout << "Warning: trajectory does not come back down, backing off\n";
+            step = 0.5 * step;
+        }
+        if (!landed)
         {
-            if (energies[i] < energies[minIndex])
-                minIndex = i;
-            if (energies[i] > energies[maxIndex])
-                maxIndex = i;
+            // differentiating around a flight that never lands means nothing, stay at the last iterate that did
+            std::cout << "Warning: joint optimization found no step that lands\n";
+            break;
         }
+        x = next;
+        y = trial;
+
+        std::cout << "  Current error: " << std::sqrt(squaredLocationError(y, goal)) * Physics::EARTH_RADIUS << "m       ground angle: " << x[2]
+                  << "       speed: " << x[0] / Physics::NORM_VEL << "m/s" << std::endl;
     }
-    return Vector3<double>(inputs[minIndex].v, inputs[minIndex].eastAngle, bestAngles[minIndex]);
-}
\ No newline at end of file
+
+    const double v = x[0] / Physics::NORM_VEL;
+    std::cout << "\nJoint optimization: " << iterations << " iterations, " << simulations << " simulations, launch energy " << m * v * v / 2 << "J" << std::endl;
+    if (stats)
+    {
+        stats->iterations += iterations;
+        stats->simulations += simulations;
+        stats->integrationSteps += integrationSteps;
+        stats->solves++;
+        stats->converged = converged;
+    }
+    return Vector3<double>(v, x[1] / Physics::NORM_DEG, x[2]);
+}
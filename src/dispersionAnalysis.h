@@ -0,0 +1,52 @@
+#pragma once
+
+#include <iostream>
+#include "constants.h"
+#include "userinput.h"
+#include "montecarlo.h"
+
+void dispersionAnalysis()
+{
+    MonteCarloInputs inputs;
+    std::cout << "Enter launch coordinates in degrees:" << std::endl;
+    std::cout << "Latitude: ";
+    ccinDouble(inputs.latitude);
+    std::cout << "Longitude: ";
+    ccinDouble(inputs.longitude);
+    std::cout << "Enter nominal speed and angle relative to geographical east (counter-clockwise) and relative to ground (both in degrees):" << std::endl;
+    std::cout << "Speed: ";
+    ccinDouble(inputs.speed);
+    std::cout << "East angle: ";
+    ccinDouble(inputs.eastAngle);
+    std::cout << "Ground angle: ";
+    ccinDouble(inputs.groundAngle);
+    std::cout << "Enter the standard deviation of each error (normal distributions):" << std::endl;
+    std::cout << "Speed (m/s): ";
+    ccinDouble(inputs.speedError.spread);
+    std::cout << "East angle (degrees): ";
+    ccinDouble(inputs.eastAngleError.spread);
+    std::cout << "Ground angle (degrees): ";
+    ccinDouble(inputs.groundAngleError.spread);
+    double samples, seed;
+    std::cout << "Samples: ";
+    ccinDouble(samples);
+    std::cout << "Seed: ";
+    ccinDouble(seed);
+
+    try
+    {
+        DispersionStats stats = runMonteCarlo(inputs, (long long)samples, (std::uint64_t)seed);
+        std::cout << "\nNominal landing: " << stats.nominalLatitude << (char)248 << ", " << stats.nominalLongitude << (char)248
+                  << " after " << stats.nominalTime << "s" << std::endl;
+        std::cout << stats.landed << " of " << stats.samples << " samples land" << std::endl;
+        std::cout << "Mean offset: " << stats.moments.meanEast << "m east, " << stats.moments.meanNorth << "m north" << std::endl;
+        std::cout << "Dispersion ellipse (1 sigma): " << stats.ellipseMajor() << "m x " << stats.ellipseMinor() << "m, major axis at "
+                  << stats.ellipseAngle() << (char)248 << " from east" << std::endl;
+        std::cout << "CEP: " << stats.cep() << "m, 90%: " << stats.miss.percentile(0.9) << "m, 99%: " << stats.miss.percentile(0.99) << "m" << std::endl;
+        std::cout << "Flight time: " << stats.moments.meanTime << " +- " << stats.stdDevTime() << "s" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+}
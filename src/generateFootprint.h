@@ -0,0 +1,53 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include "constants.h"
+#include "userinput.h"
+#include "footprint.h"
+
+inline void ccinAxis(FootprintAxis &axis, const char *name)
+{
+    double count;
+    std::cout << name << " from: ";
+    ccinDouble(axis.min);
+    std::cout << name << " to: ";
+    ccinDouble(axis.max);
+    std::cout << name << " values: ";
+    ccinDouble(count);
+    axis.count = std::max(1, (int)count);
+}
+
+void generateFootprintGrid()
+{
+    FootprintGrid grid;
+    std::cout << "Enter launch coordinates in degrees:" << std::endl;
+    std::cout << "Latitude: ";
+    ccinDouble(grid.latitude);
+    std::cout << "Longitude: ";
+    ccinDouble(grid.longitude);
+    ccinAxis(grid.speed, "Speed (m/s)");
+    ccinAxis(grid.eastAngle, "East angle (degrees)");
+    ccinAxis(grid.groundAngle, "Ground angle (degrees)");
+
+    std::string path;
+    std::cout << "Output file (an unfinished sweep of the same grid is resumed): ";
+    std::cin >> path;
+
+    try
+    {
+        std::cout << "\nComputing " << grid.cells() << " landing points..." << std::endl;
+        int rows = generateFootprint(path, grid);
+        std::cout << rows << " of " << grid.rows() << " launch directions computed" << std::endl;
+
+        std::vector<FootprintCell> cells = readFootprint(path, grid);
+        long long landed = 0;
+        for (const FootprintCell &cell : cells)
+            landed += cell.lands();
+        std::cout << landed << " of " << cells.size() << " launches land, footprint written to " << path << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cout << e.what() << std::endl;
+    }
+}
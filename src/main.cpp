@@ -3,6 +3,8 @@
 #include "renderer.h"
 #include "simulateTrajectory.h"
 #include "solveTrajectory.h"
+#include "generateFootprint.h"
+#include "dispersionAnalysis.h"
 
 void displayTitle()
 {
@@ -10,6 +12,8 @@ void displayTitle()
     std::cout << "C++ trajectory simulator, solver and visualizer\n\n";
     std::cout << "1: Simulate a trajectory specifying the parameters\n";
     std::cout << "2: Find the optimal trajectory given certain parameters\n";
+    std::cout << "3: Generate the landing footprint of a launch site\n";
+    std::cout << "4: Analyse the landing dispersion of a launch (Monte Carlo)\n";
     std::cout << "Select functionality: ";
 }
 
@@ -19,7 +23,7 @@ void functionalityccin(int &d, int retriesLeft = 3)
     try
     {
         std::cin >> d;
-        if (d != 1 and d != 2)
+        if (d < 1 or d > 4)
             throw std::exception();
     }
     catch (...)
@@ -44,6 +48,12 @@ int main()
     case 2:
         solveTrajectory();
         break;
+    case 3:
+        generateFootprintGrid();
+        break;
+    case 4:
+        dispersionAnalysis();
+        break;
 
     default:
         break;
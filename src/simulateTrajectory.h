@@ -7,6 +7,7 @@
 #include "physics.h"
 #include "constants.h"
 #include "userinput.h"
+#include "liveview.h"
 #include <cmath>
 
 void simulateTrajectory()
@@ -15,10 +16,25 @@ void simulateTrajectory()
     Vector3<double> initialPos = getInitialPos();
     Vector3<double> initialV = getInitialV(Math::pi / 2 - initialPos.phi(), initialPos.theta());
 
-    RK4Solution sol = getFinalPosition(initialPos, initialV);
+    double animate;
+    std::cout << "Show the flight while it is computed? (1: yes, 0: no): ";
+    ccinDouble(animate);
+
+    RK4Solution<double> sol = (animate == 1) ? animateTrajectory(initialPos, initialV) : getFinalPosition(initialPos, initialV);
+    if (sol.status != SolutionStatus::EndCondition)
+    {
+        std::cout << std::endl;
+        if (sol.status == SolutionStatus::Escape)
+            std::cout << "The object escapes Earth's gravity and never lands." << std::endl;
+        else if (sol.status == SolutionStatus::Orbit)
+            std::cout << "The object reaches orbit and never lands." << std::endl;
+        else
+            std::cout << "The object does not land within " << RK4Constants::MAX_FLIGHT_TIME << "s." << std::endl;
+        return;
+    }
 
     Vector3<double> finalPos(sol.solutions(0, 0), sol.solutions(0, 1), sol.solutions(0, 2));
     std::cout << std::endl;
     std::cout << "Final latitude: " << 90 - 180 / Math::pi * (finalPos.phi()) << (char)248 << std::endl;
-    std::cout << "Final longitude: " << 180 / Math::pi * (finalPos.theta() - Physics::EARTH_ANGULAR_VELOCITY * sol.steps * RK4Constants::STEP_SIZE) << (char)248 << std::endl;
+    std::cout << "Final longitude: " << 180 / Math::pi * (finalPos.theta() - Physics::EARTH_ANGULAR_VELOCITY * sol.time) << (char)248 << std::endl;
 }
@@ -20,7 +20,14 @@ void solveTrajectory()
     std::cout << "Enter mass (kg): ";
     ccinDouble(m);
 
-    Vector3<double> minVelocity = optimizeTrajectory(initialPos, finalPos, m);
+    // the joint optimizer is much cheaper, the nested search is kept as a fallback
+    TargetingStats stats;
+    Vector3<double> minVelocity = optimizeTrajectoryJoint(initialPos, finalPos, m, &stats);
+    if (!stats.converged)
+    {
+        std::cout << "Joint optimization did not converge, falling back to the ground angle search\n";
+        minVelocity = optimizeTrajectory(initialPos, finalPos, m);
+    }
 
     std::cout << "\nMinimum velocity (local coordinates): " << std::endl;
     std::cout << "Speed: " << minVelocity[0] << "m/s" << std::endl;
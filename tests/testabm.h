@@ -0,0 +1,88 @@
+#pragma once
+
+#include <functional>
+#include "abm.h"
+#include "rk4.h"
+#include "linalg.h"
+#include "physics.h"
+
+void testABMonxist()
+{
+    std::function<void(Matrix<double>, Matrix<double> &)> der = [](Matrix<double>, Matrix<double> &retm)
+    {
+        retm(0, 0) = 1;
+    };
+    std::function<bool(Matrix<double>)> reachedhalf = [](Matrix<double> m)
+    { return m(0, 0) >= 0.5; };
+
+    ABM solver = ABM(0.001);
+    Matrix<double> init(1, 1);
+    init(0, 0) = 0.0;
+    RK4Solution sol = solver.solve(init, der, 1005, reachedhalf);
+    assert(std::abs(0.5 - sol.solutions(0, 0)) < 1e-6 and std::abs(sol.time - sol.solutions(0, 0)) < 1e-9);
+    std::cout << "  x=t passed" << std::endl;
+}
+
+void testABMCircularMotion()
+{
+    std::function<void(Matrix<double>, Matrix<double> &)> der = [](Matrix<double> m, Matrix<double> &retm)
+    {
+        retm(0, 0) = -2 * Math::pi * m(0, 1);
+        retm(0, 1) = 2 * Math::pi * m(0, 0);
+    };
+    std::function<bool(Matrix<double>)> never = [](Matrix<double>)
+    { return false; };
+
+    // one full period, PECE and PEC
+    for (bool pece : {true, false})
+    {
+        ABM solver = ABM(0.001, 4, pece);
+        Matrix<double> init(1, 2);
+        init(0, 0) = 1.0;
+        init(0, 1) = 0.0;
+        RK4Solution sol = solver.solve(init, der, 1000, never);
+        assert(std::abs(1 - sol.solutions(0, 0)) < 1e-6 and std::abs(sol.solutions(0, 1)) < 1e-6);
+    }
+    std::cout << "  x=cos(2pi t), y=sin(2pi t) passed" << std::endl;
+}
+
+void testABMEventRefinement()
+{
+    // the impact is located more finely than the base step
+    std::function<void(Matrix<double>, Matrix<double> &)> der = [](Matrix<double> m, Matrix<double> &retm)
+    {
+        retm(0, 0) = m(0, 1);
+        retm(0, 1) = -9.81;
+    };
+    std::function<bool(Matrix<double>)> ground = [](Matrix<double> m)
+    { return m(0, 0) < 0; };
+
+    ABM solver = ABM(0.01);
+    Matrix<double> init(1, 2);
+    init(0, 0) = 0.0;
+    init(0, 1) = 10.0;
+    RK4Solution sol = solver.solve(init, der, 100000, ground);
+    assert(std::abs(sol.time - 20 / 9.81) < 0.01 * 1e-2 and solver.getStepSize() == 0.01);
+    std::cout << "  event refinement passed" << std::endl;
+}
+
+void testABMMatchesRK4()
+{
+    // both integrators should land the same ballistic trajectory within a few metres
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 4);
+    Vector3<double> initialV = localToInertial(Math::pi / 4, 0.0, Vector3<double>(300, 300, 600));
+    RK4Solution rk4 = getFinalPosition<RK4>(initialPos, initialV);
+    RK4Solution abm = getFinalPosition<ABM>(initialPos, initialV);
+    Vector3<double> p1(rk4.solutions(0, 0), rk4.solutions(0, 1), rk4.solutions(0, 2));
+    Vector3<double> p2(abm.solutions(0, 0), abm.solutions(0, 1), abm.solutions(0, 2));
+    assert((p1 - p2).r() < 2 and std::abs(rk4.time - abm.time) < 2e-3);
+    std::cout << "  matches RK4 passed" << std::endl;
+}
+
+void runABMTests()
+{
+    testABMonxist();
+    testABMCircularMotion();
+    testABMEventRefinement();
+    testABMMatchesRK4();
+}
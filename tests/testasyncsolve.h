@@ -0,0 +1,122 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <sstream>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include "asyncsolve.h"
+#include "abm.h"
+
+void testCancelledSolvers()
+{
+    // under a cancelled token the solvers stop before their first step, outside of its scope they run as usual
+    const double lat = 0.5;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    CancelToken token;
+    token.cancel();
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    {
+        CancellationScope scope(token);
+        const RK4Solution<double> rk4 = getFinalPosition<RK4>(pos, v, 1e-2);
+        const RK4Solution<double> abm = getFinalPosition<ABM>(pos, v, 1e-2);
+        assert(rk4.status == SolutionStatus::Cancelled and rk4.steps == 0);
+        assert(abm.status == SolutionStatus::Cancelled and abm.steps == 0);
+        bool threw = false;
+        try
+        {
+            getInputs<float>(40, pos, Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.05, Math::pi / 2 - lat));
+        }
+        catch (const SolveCancelled &)
+        {
+            threw = true;
+        }
+        assert(threw);
+    }
+    std::cout.rdbuf(out);
+    assert(getFinalPosition<RK4>(pos, v, 1e-2).status == SolutionStatus::EndCondition);
+    std::cout << "  cancelled solvers passed" << std::endl;
+}
+
+void testAsyncSolve()
+{
+    // a solve on the executor gives what the blocking call does, with progress on the way
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    std::atomic<int> events(0);
+    TargetingOptions options;
+    options.onProgress = [&](const TargetingProgress &) { events++; };
+    vAngle x(0, 0), reference(0, 0);
+    TargetingProgress latest;
+    bool haveProgress;
+    TargetingStats stats;
+    {
+        SolveExecutor executor(2);
+        SolveHandle<vAngle> handle = getInputsAsync(executor, 40, initialPos, finalPos, options);
+        x = handle.get();
+        haveProgress = handle.progress(latest);
+        stats = handle.stats();
+    }
+    reference = getInputsMixedPrecision(40, initialPos, finalPos);
+    std::cout.rdbuf(out);
+    assert(x.v == reference.v and x.eastAngle == reference.eastAngle);
+    assert(events > 0 and haveProgress and latest.groundAngle == 40 and latest.iteration > 0 and latest.error < 100);
+    assert(stats.converged and stats.solves == 2);
+    std::cout << "  async solve passed" << std::endl;
+}
+
+void testAsyncCancel()
+{
+    // on a single worker: a queued solve that is cancelled never runs, a running one stops soon after
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.3, Math::pi / 2 - 0.7);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    std::atomic<int> queuedEvents(0);
+    TargetingOptions counted;
+    counted.onProgress = [&](const TargetingProgress &) { queuedEvents++; };
+    bool runningCancelled = false, queuedCancelled = false, stoppedInTime;
+    {
+        SolveExecutor executor(1);
+        SolveHandle<Vector3<double>> running = optimizeTrajectoryAsync(executor, initialPos, finalPos, 1.0);
+        SolveHandle<Vector3<double>> queued = optimizeTrajectoryAsync(executor, initialPos, finalPos, 1.0, counted);
+        queued.cancel();
+        TargetingProgress latest;
+        while (!running.progress(latest))
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        running.cancel();
+        stoppedInTime = running.waitFor(std::chrono::seconds(2));
+        try
+        {
+            running.get();
+        }
+        catch (const SolveCancelled &)
+        {
+            runningCancelled = true;
+        }
+        try
+        {
+            queued.get();
+        }
+        catch (const SolveCancelled &)
+        {
+            queuedCancelled = true;
+        }
+    }
+    std::cout.rdbuf(out);
+    assert(stoppedInTime and runningCancelled and queuedCancelled and queuedEvents == 0);
+    std::cout << "  async cancel passed" << std::endl;
+}
+
+void runAsyncSolveTests()
+{
+    testCancelledSolvers();
+    testAsyncSolve();
+    testAsyncCancel();
+}
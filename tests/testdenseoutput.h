@@ -0,0 +1,110 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include "denseoutput.h"
+#include "physics.h"
+
+void testHermiteInterpolation()
+{
+    // cubics are reproduced exactly, between knots and by their derivative
+    auto f = [](double t)
+    { return 2 * t * t * t - t * t + 3 * t - 5; };
+    auto df = [](double t)
+    { return 6 * t * t - 2 * t + 3; };
+    DenseTrajectory<double> cubic;
+    Matrix<double> y0(1, 1), dy0(1, 1);
+    for (double t : {0.0, 0.5, 1.75, 2.0, 4.0})
+    {
+        y0(0, 0) = f(t);
+        dy0(0, 0) = df(t);
+        cubic.append(t, y0, dy0);
+    }
+    assert(cubic.size() == 5 and cubic.dimensions() == 1 and cubic.endTime() == 4);
+    for (double t = 0; t <= 4; t += 0.01)
+    {
+        double y, dy;
+        cubic.state(t, &y);
+        cubic.derivative(t, &dy);
+        assert(std::abs(y - f(t)) < 1e-9 and std::abs(dy - df(t)) < 1e-9);
+    }
+    assert(cubic.segment(-1) == 0 and cubic.segment(0.5) == 1 and cubic.segment(1.9) == 2 and cubic.segment(4) == 3 and cubic.segment(9) == 3);
+
+    // roots of f - 10 (one, f is increasing)
+    std::vector<double> roots = cubic.roots([&](double, const double *y)
+                                            { return *y - 10; });
+    assert(roots.size() == 1 and std::abs(f(roots[0]) - 10) < 1e-6);
+    std::cout << "  Hermite interpolation passed" << std::endl;
+}
+
+void testDenseFlight()
+{
+    // the state at any time matches a fine integration stopped there, without integrating again
+    const double lat = 0.5;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 2000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    for (int abm : {0, 1})
+    {
+        DenseTrajectory<double> flight;
+        RK4Solution<double> sol = abm ? getFinalPosition<ABM, double>(pos, v, 0.1, RK4Constants::MAX_FLIGHT_TIME, flight)
+                                      : getFinalPosition<RK4, double>(pos, v, 0.1, RK4Constants::MAX_FLIGHT_TIME, flight);
+        assert(sol.status == SolutionStatus::EndCondition and flight.size() > 1000 and flight.dimensions() == 6);
+        assert(std::abs(flight.endTime() - sol.time) <= 0.1 + 1e-9);
+        for (int i = 0; i < 6; i++)
+            assert(flight.knotState(flight.size() - 1)[i] == sol.solutions(0, i));
+
+        const double t = 41.27, fine = 1e-3;
+        RK4<double> solver(fine);
+        Matrix<double> initial({{pos[0], pos[1], pos[2], v[0], v[1], v[2]}});
+        RK4Solution<double> reference = solver.solve(initial, gravitationalDerivatives<double>, (int)std::lround(t / fine), [&](Matrix<double>)
+                                                     { return false; });
+        Matrix<double> y = flight.state(t);
+        assert(std::abs(y(0, 0) - reference.solutions(0, 0)) < 1e-3 and std::abs(y(0, 2) - reference.solutions(0, 2)) < 1e-3);
+        assert(std::abs(y(0, 4) - reference.solutions(0, 4)) < 1e-5);
+
+        // batch queries, increasing or not, give the single ones
+        std::vector<double> times = {0, 3.3, 41.27, 41.27, 100, flight.endTime(), 12, 0.05};
+        std::vector<double> batch;
+        flight.states(times, batch);
+        for (size_t j = 0; j < times.size(); j++)
+        {
+            Matrix<double> single = flight.state(times[j]);
+            for (int i = 0; i < 6; i++)
+                assert(batch[6 * j + i] == single(0, i));
+        }
+    }
+    std::cout << "  dense flight passed" << std::endl;
+}
+
+void testApogee()
+{
+    // straight up, no spin: the top is where vis-viva puts it, 1/ra = 1/R - v^2 / (2 mu)
+    const double mu = Physics::G * Physics::EARTH_MASS, speed = 3000;
+    const Vector3<double> pos(Physics::EARTH_RADIUS, 0, 0), v(speed, 0, 0);
+    DenseTrajectory<double> flight;
+    RK4Solution<double> sol = getFinalPosition<RK4, double>(pos, v, 0.1, RK4Constants::MAX_FLIGHT_TIME, flight);
+    assert(sol.status == SolutionStatus::EndCondition);
+    Apogee<double> top = findApogee(flight);
+    const double ra = 1 / (1 / Physics::EARTH_RADIUS - speed * speed / (2 * mu));
+    assert(std::abs(top.altitude - (ra - Physics::EARTH_RADIUS)) < 1e-2);
+    // up and down take the same time
+    assert(std::abs(top.time - flight.endTime() / 2) < 0.1);
+    // nothing in the samples is higher
+    std::vector<double> times, states;
+    for (double t = 0; t <= flight.endTime(); t += 0.37)
+        times.push_back(t);
+    flight.states(times, states);
+    for (size_t j = 0; j < times.size(); j++)
+        assert(std::sqrt(states[6 * j] * states[6 * j] + states[6 * j + 1] * states[6 * j + 1] + states[6 * j + 2] * states[6 * j + 2]) - Physics::EARTH_RADIUS <= top.altitude + 1e-6);
+    std::cout << "  apogee passed" << std::endl;
+}
+
+void runDenseOutputTests()
+{
+    testHermiteInterpolation();
+    testDenseFlight();
+    testApogee();
+}
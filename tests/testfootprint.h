@@ -0,0 +1,98 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include "footprint.h"
+
+const char *FOOTPRINT_TEST_FILE = "testfootprint.bin";
+
+FootprintGrid testFootprintGrid()
+{
+    // the last speeds escape
+    return {40, 0, {500, 12000, 4}, {0, 90, 2}, {30, 60, 2}};
+}
+
+void testFootprintMatchesSimulation()
+{
+    std::remove(FOOTPRINT_TEST_FILE);
+    FootprintGrid grid = testFootprintGrid();
+    assert(generateFootprint(FOOTPRINT_TEST_FILE, grid, 3) == grid.rows());
+
+    FootprintGrid stored;
+    std::vector<FootprintCell> cells = readFootprint(FOOTPRINT_TEST_FILE, stored);
+    assert(stored == grid and (long long)cells.size() == grid.cells());
+
+    // every cell against a plain single launch
+    const double lat = grid.latitude * Math::pi / 180, lon = grid.longitude * Math::pi / 180;
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, lon, Math::pi / 2 - lat);
+    for (int g = 0; g < grid.groundAngle.count; g++)
+        for (int e = 0; e < grid.eastAngle.count; e++)
+            for (int s = 0; s < grid.speed.count; s++)
+            {
+                const double eastAngle = grid.eastAngle.at(e) * Math::pi / 180, groundAngle = grid.groundAngle.at(g) * Math::pi / 180;
+                Vector3<double> v = localToInertial(lat, lon, grid.speed.at(s) * Vector3<double>(std::cos(groundAngle) * std::cos(eastAngle),
+                                                                                                   std::cos(groundAngle) * std::sin(eastAngle),
+                                                                                                   std::sin(groundAngle)));
+                RK4Solution<double> sol = getFinalPosition<ABM>(initialPos, v, FootprintConstants::STEP_SIZE);
+                const FootprintCell &cell = cells[((long long)g * grid.eastAngle.count + e) * grid.speed.count + s];
+                assert(!cell.pending());
+                assert(cell.lands() == (sol.status == SolutionStatus::EndCondition));
+                if (cell.lands())
+                {
+                    Vector3<double> finalPos(sol.solutions(0, 0), sol.solutions(0, 1), sol.solutions(0, 2));
+                    assert(std::abs(cell.time - sol.time) < 1e-2);
+                    assert(std::abs(cell.latitude - (90 - 180 / Math::pi * finalPos.phi())) < 1e-4);
+                }
+            }
+    assert(!cells.back().lands());
+    std::remove(FOOTPRINT_TEST_FILE);
+    std::cout << "  footprint matches simulation passed" << std::endl;
+}
+
+void testFootprintResume()
+{
+    std::remove(FOOTPRINT_TEST_FILE);
+    FootprintGrid grid = testFootprintGrid();
+    generateFootprint(FOOTPRINT_TEST_FILE, grid, 2);
+    FootprintGrid stored;
+    std::vector<FootprintCell> complete = readFootprint(FOOTPRINT_TEST_FILE, stored);
+
+    // a finished sweep has nothing left to do
+    assert(generateFootprint(FOOTPRINT_TEST_FILE, grid) == 0);
+
+    // interrupt it by hand: row 2 goes back to pending
+    {
+        std::fstream file(FOOTPRINT_TEST_FILE, std::ios::binary | std::ios::in | std::ios::out);
+        const float pending[3] = {0, 0, FootprintConstants::PENDING};
+        file.seekp(FootprintFormat::HEADER_SIZE + 2 * grid.speed.count * FootprintFormat::CELL_SIZE + FootprintFormat::CELL_SIZE);
+        file.write(reinterpret_cast<const char *>(pending), FootprintFormat::CELL_SIZE);
+    }
+    assert(generateFootprint(FOOTPRINT_TEST_FILE, grid) == 1);
+    std::vector<FootprintCell> resumed = readFootprint(FOOTPRINT_TEST_FILE, stored);
+    for (size_t i = 0; i < complete.size(); i++)
+        assert(std::memcmp(&complete[i], &resumed[i], sizeof(FootprintCell)) == 0);
+
+    // a different grid must not be mixed into the file
+    grid.speed.max = 11000;
+    bool thrown = false;
+    try
+    {
+        generateFootprint(FOOTPRINT_TEST_FILE, grid);
+    }
+    catch (const std::invalid_argument &)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+    std::remove(FOOTPRINT_TEST_FILE);
+    std::cout << "  footprint resume passed" << std::endl;
+}
+
+void runFootprintTests()
+{
+    testFootprintMatchesSimulation();
+    testFootprintResume();
+}
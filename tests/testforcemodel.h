@@ -0,0 +1,113 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include "forcemodel.h"
+#include "gravityfield.h"
+
+void testPointMassModel()
+{
+    // the point mass alone is today's derivative function, to the bit, and flies the same flight
+    ForceModel<double, PointMass> model;
+    model.prepare();
+    Matrix<double> state(1, 6), expected(1, 6), derivatives(1, 6);
+    const double values[6] = {4.1e6, -2.3e6, 4.4e6, 1200, -300, 2500};
+    for (int i = 0; i < 6; i++)
+        state(0, i) = values[i];
+    gravitationalDerivatives(state, expected);
+    model(state, derivatives);
+    for (int i = 0; i < 6; i++)
+        assert(derivatives(0, i) == expected(0, i));
+
+    const double lat = 0.5, stepSize = 1e-2;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    const RK4Solution<double> reference = getFinalPosition<RK4>(pos, v, stepSize);
+    const RK4Solution<double> sol = getFinalPosition<RK4>(model, pos, v, stepSize);
+    assert(sol.status == SolutionStatus::EndCondition and sol.steps == reference.steps);
+    for (int i = 0; i < 6; i++)
+        assert(sol.solutions(0, i) == reference.solutions(0, i));
+    std::cout << "  point mass model passed" << std::endl;
+}
+
+void testJ2Term()
+{
+    // J2 against the degree 2 gravity field (axisymmetric, so Earth fixed and inertial agree)
+    const double mu = Physics::G * Physics::EARTH_MASS;
+    ForceModel<double, PointMass, J2> model;
+    model.prepare();
+    GravityField<double> field(2, 0, mu, GravityFieldConstants::RADIUS);
+    field.setCoefficient(2, 0, -GravityFieldConstants::J2 / std::sqrt(5.0), 0);
+    Matrix<double> state(1, 6), derivatives(1, 6);
+    const double points[3][3] = {{6.5e6, 1e5, -2e5}, {-3e6, 4e6, 4.5e6}, {1.0, -2.0, 6.9e6}};
+    for (const auto &p : points)
+    {
+        for (int i = 0; i < 3; i++)
+            state(0, i) = p[i];
+        model(state, derivatives);
+        double a[3];
+        field.acceleration(p[0], p[1], p[2], a);
+        const double r2 = p[0] * p[0] + p[1] * p[1] + p[2] * p[2];
+        for (int i = 0; i < 3; i++)
+            assert(std::abs(derivatives(0, 3 + i) - a[i]) < 1e-12 * mu / r2);
+    }
+
+    // terms can be swapped for others of their type, prepared again
+    model.term<J2>() = J2<double>(0);
+    model.prepare();
+    model(state, derivatives);
+    assert(std::abs(derivatives(0, 5) + mu / (6.9e6 * 6.9e6)) < 1e-9);
+    std::cout << "  J2 term passed" << std::endl;
+}
+
+void testExponentialDrag()
+{
+    ForceModel<double, ExponentialDrag> drag;
+    drag.prepare();
+    Matrix<double> state(1, 6), derivatives(1, 6);
+    const double omega = Physics::EARTH_ANGULAR_VELOCITY;
+
+    // air at rest on the ground: no drag for an object turning with the Earth
+    state(0, 0) = Physics::EARTH_RADIUS;
+    state(0, 4) = omega * Physics::EARTH_RADIUS;
+    drag(state, derivatives);
+    for (int i = 3; i < 6; i++)
+        assert(std::abs(derivatives(0, i)) < 1e-12);
+
+    // 1 km/s up through the air at sea level: rho v^2 / (2 beta) against the motion, e times less one scale height higher
+    state(0, 3) = 1000;
+    drag(state, derivatives);
+    const double deceleration = ForceModelConstants::SEA_LEVEL_DENSITY * 1e6 / (2 * ForceModelConstants::BALLISTIC_COEFFICIENT);
+    assert(std::abs(derivatives(0, 3) + deceleration) < 1e-9 * deceleration and std::abs(derivatives(0, 4)) < 1e-9);
+    state(0, 0) += ForceModelConstants::SCALE_HEIGHT;
+    state(0, 4) = omega * state(0, 0);
+    drag(state, derivatives);
+    assert(std::abs(derivatives(0, 3) + deceleration / std::exp(1.0)) < 1e-9 * deceleration);
+
+    // a draggier object falls short
+    const double lat = 0.5, stepSize = 1e-2;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 2000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    const RK4Solution<double> vacuum = getFinalPosition<RK4>(ForceModel<double, PointMass>(), pos, v, stepSize);
+    const RK4Solution<double> heavy = getFinalPosition<RK4>(ForceModel<double, PointMass, ExponentialDrag>(), pos, v, stepSize);
+    const RK4Solution<double> light = getFinalPosition<RK4>(ForceModel<double, PointMass, ExponentialDrag>(PointMass<double>(), ExponentialDrag<double>(500)),
+                                                            pos, v, stepSize);
+    auto range = [&](const RK4Solution<double> &sol)
+    {
+        const Vector3<double> end(sol.solutions(0, 0), sol.solutions(0, 1), sol.solutions(0, 2));
+        return std::acos(std::clamp(end * pos / (end.r() * pos.r()), -1.0, 1.0)) * Physics::EARTH_RADIUS;
+    };
+    assert(light.steps < heavy.steps and heavy.steps < vacuum.steps);
+    assert(range(light) < range(heavy) and range(heavy) < range(vacuum));
+    std::cout << "  exponential drag passed" << std::endl;
+}
+
+void runForceModelTests()
+{
+    testPointMassModel();
+    testJ2Term();
+    testExponentialDrag();
+}
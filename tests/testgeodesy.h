@@ -0,0 +1,151 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <vector>
+#include <random>
+#include "linalg.h"
+#include "geodesy.h"
+
+// geodetic latitude and height of an ECEF point by fixed point iteration to convergence, the reference for the closed form
+void iteratedGeodetic(double x, double y, double z, double &latitude, double &height)
+{
+    const double a = GeodesyConstants::WGS84_A, f = GeodesyConstants::WGS84_F;
+    const double e2 = f * (2 - f);
+    const double p = std::sqrt(x * x + y * y);
+    latitude = std::atan2(z, p * (1 - e2));
+    for (int i = 0; i < 100; i++)
+    {
+        const double N = a / std::sqrt(1 - e2 * std::sin(latitude) * std::sin(latitude));
+        height = p / std::cos(latitude) - N;
+        latitude = std::atan2(z, p * (1 - e2 * N / (N + height)));
+    }
+    const double N = a / std::sqrt(1 - e2 * std::sin(latitude) * std::sin(latitude));
+    height = std::abs(latitude) < 1 ? p / std::cos(latitude) - N : z / std::sin(latitude) - N * (1 - e2);
+}
+
+void testFastTrigonometry()
+{
+    std::mt19937 generator(5);
+    std::uniform_real_distribution<double> angle(-1e5, 1e5), small(-10, 10), coordinate(-1, 1);
+    double sinCosError = 0, atanError = 0;
+    for (int i = 0; i < 200000; i++)
+    {
+        const double x = i % 2 ? angle(generator) : small(generator);
+        double s, c;
+        fastSinCos(x, s, c);
+        sinCosError = std::max({sinCosError, std::abs(s - std::sin(x)), std::abs(c - std::cos(x))});
+
+        const double u = coordinate(generator), v = coordinate(generator) * (i % 3 ? 1 : 1e-6);
+        atanError = std::max({atanError, std::abs(fastAtan2(u, v) - std::atan2(u, v)), std::abs(fastAtan2(v, u) - std::atan2(v, u))});
+    }
+    assert(sinCosError < 2.3e-16);
+    assert(atanError < 4.5e-16);
+
+    // the quadrant edges and the axes
+    for (int k = -8; k <= 8; k++)
+    {
+        double s, c;
+        fastSinCos(k * Math::pi / 4, s, c);
+        assert(std::abs(s - std::sin(k * Math::pi / 4)) < 2.3e-16 and std::abs(c - std::cos(k * Math::pi / 4)) < 2.3e-16);
+    }
+    assert(fastAtan2(0, 0) == 0);
+    assert(fastAtan2(0, 1) == 0 and std::abs(fastAtan2(0, -1) - Math::pi) < 4.5e-16 and std::abs(fastAtan2(-0.0, -1) + Math::pi) < 4.5e-16);
+    assert(std::abs(fastAtan2(1, 0) - Math::pi / 2) < 4.5e-16 and std::abs(fastAtan2(-1, 0) + Math::pi / 2) < 4.5e-16);
+    assert(std::abs(fastAtan2(1, 1) - Math::pi / 4) < 4.5e-16 and std::abs(fastAtan2(-2, -2) + 3 * Math::pi / 4) < 4.5e-16);
+    std::cout << "  fast trigonometry passed (sin/cos within " << sinCosError << ", atan2 within " << atanError << ")" << std::endl;
+}
+
+void testBatchSpherical()
+{
+    std::mt19937 generator(7);
+    std::uniform_real_distribution<double> radius(1, 1e7), theta(-Math::pi, Math::pi), phi(0, Math::pi);
+    const std::size_t n = 1001; // not a multiple of any vector width
+    std::vector<double> r(n), t(n), p(n), x(n), y(n), z(n), r2(n), t2(n), p2(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        r[i] = radius(generator);
+        t[i] = theta(generator);
+        p[i] = phi(generator);
+    }
+    sphericalToCartesian(r.data(), t.data(), p.data(), x.data(), y.data(), z.data(), n);
+    cartesianToSpherical(x.data(), y.data(), z.data(), r2.data(), t2.data(), p2.data(), n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        const Vector3<double> v = Vector3<double>::fromSpherical(r[i], t[i], p[i]);
+        assert(std::abs(x[i] - v[0]) <= 1e-15 * r[i] and std::abs(y[i] - v[1]) <= 1e-15 * r[i] and std::abs(z[i] - v[2]) <= 1e-15 * r[i]);
+        assert(std::abs(r2[i] - v.r()) <= 1e-15 * r[i]);
+        assert(std::abs(t2[i] - v.theta()) < 1e-14 and std::abs(p2[i] - v.phi()) < 1e-7); // acos loses digits near the poles
+        assert(std::abs(t2[i] - t[i]) < 1e-9 and std::abs(p2[i] - p[i]) < 1e-14);
+    }
+
+    // geocentric is the same with latitude from the equator, and may be computed in place
+    std::vector<double> lat(n), lon = t, rad = r;
+    for (std::size_t i = 0; i < n; i++)
+        lat[i] = Math::pi / 2 - p[i];
+    geocentricToCartesian(lat.data(), lon.data(), rad.data(), lat.data(), lon.data(), rad.data(), n);
+    for (std::size_t i = 0; i < n; i++)
+        assert(std::abs(lat[i] - x[i]) <= 1e-15 * r[i] and std::abs(lon[i] - y[i]) <= 1e-15 * r[i] and std::abs(rad[i] - z[i]) <= 1e-15 * r[i]);
+    cartesianToGeocentric(lat.data(), lon.data(), rad.data(), lat.data(), lon.data(), rad.data(), n);
+    for (std::size_t i = 0; i < n; i++)
+        assert(std::abs(lat[i] - (Math::pi / 2 - p[i])) < 1e-14 and std::abs(lon[i] - t[i]) < 1e-9 and std::abs(rad[i] - r[i]) <= 1e-14 * r[i]);
+    std::cout << "  batch spherical passed" << std::endl;
+}
+
+void testWgs84()
+{
+    const double a = GeodesyConstants::WGS84_A, b = a * (1 - GeodesyConstants::WGS84_F);
+
+    // on the axes
+    const double lat[] = {0, 0, Math::pi / 2, -Math::pi / 2}, lon[] = {0, Math::pi / 2, 0, 0}, h[] = {0, 100, 0, -50};
+    double x[4], y[4], z[4];
+    geodeticToEcef(lat, lon, h, x, y, z, 4);
+    assert(std::abs(x[0] - a) < 1e-9 and std::abs(y[0]) < 1e-9 and std::abs(z[0]) < 1e-9);
+    assert(std::abs(x[1]) < 1e-9 and std::abs(y[1] - a - 100) < 1e-9 and std::abs(z[1]) < 1e-9);
+    assert(std::abs(x[2]) < 1e-9 and std::abs(z[2] - b) < 1e-9 and std::abs(z[3] + b - 50) < 1e-9);
+    double lat2[4], lon2[4], h2[4];
+    ecefToGeodetic(x, y, z, lat2, lon2, h2, 4);
+    for (int i = 0; i < 4; i++)
+        assert(std::abs(lat2[i] - lat[i]) < 1e-14 and std::abs(h2[i] - h[i]) < 1e-8);
+    assert(std::abs(lon2[1] - Math::pi / 2) < 1e-15);
+
+    // a known point: the Eiffel tower's foot (48.8583N 2.2945E, 35m) is at (4200967.2, 168324.4, 4780232.1)m
+    const double paris[] = {48.8583 * Math::pi / 180}, parisLon[] = {2.2945 * Math::pi / 180}, parisH[] = {35};
+    double px[1], py[1], pz[1];
+    geodeticToEcef(paris, parisLon, parisH, px, py, pz, 1);
+    assert(std::abs(px[0] - 4200967.2) < 0.1 and std::abs(py[0] - 168324.4) < 0.1 and std::abs(pz[0] - 4780232.1) < 0.1);
+
+    // round trips and the closed form against the iteration, from below the ellipsoid to far above it
+    std::mt19937 generator(11);
+    std::uniform_real_distribution<double> latitude(-Math::pi / 2, Math::pi / 2), longitude(-Math::pi, Math::pi), height(-1e4, 4e7);
+    const std::size_t n = 20000;
+    std::vector<double> la(n), lo(n), he(n), ex(n), ey(n), ez(n), la2(n), lo2(n), he2(n);
+    for (std::size_t i = 0; i < n; i++)
+    {
+        la[i] = latitude(generator);
+        lo[i] = longitude(generator);
+        he[i] = height(generator);
+    }
+    geodeticToEcef(la.data(), lo.data(), he.data(), ex.data(), ey.data(), ez.data(), n);
+    ecefToGeodetic(ex.data(), ey.data(), ez.data(), la2.data(), lo2.data(), he2.data(), n);
+    double latError = 0, heightError = 0;
+    for (std::size_t i = 0; i < n; i++)
+    {
+        double refLat, refHeight;
+        iteratedGeodetic(ex[i], ey[i], ez[i], refLat, refHeight);
+        latError = std::max(latError, std::abs(la2[i] - refLat));
+        heightError = std::max(heightError, std::abs(he2[i] - refHeight));
+        assert(std::abs(la2[i] - la[i]) < 1e-15 and std::abs(he2[i] - he[i]) < 1e-7);
+        assert(std::abs(lo2[i] - lo[i]) < 1e-14 or std::abs(std::abs(la[i]) - Math::pi / 2) < 1e-9);
+    }
+    assert(latError < 4.5e-16 and heightError < 3e-8);
+    std::cout << "  WGS84 passed (latitude within " << latError << "rad, height within " << heightError << "m)" << std::endl;
+}
+
+void runGeodesyTests()
+{
+    testFastTrigonometry();
+    testBatchSpherical();
+    testWgs84();
+}
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include "gravityfield.h"
+
+const char *GRAVITY_TEST_FILE = "testgravity.gfc";
+
+// a field with made up coefficients of Kaula's size (1e-5 / n^2) on top of J2
+GravityField<double> randomGravityField(int degree, int order, unsigned seed = 3)
+{
+    std::mt19937 generator(seed);
+    std::normal_distribution<double> normal(0, 1);
+    GravityField<double> field(degree, order);
+    for (int n = 2; n <= degree; n++)
+        for (int m = 0; m <= std::min(n, order); m++)
+            field.setCoefficient(n, m, 1e-5 / (n * n) * normal(generator), 1e-5 / (n * n) * normal(generator));
+    if (degree >= 2)
+        field.setCoefficient(2, 0, -GravityFieldConstants::J2 / std::sqrt(5.0), 0);
+    return field;
+}
+
+void testGravityPointMassAndJ2()
+{
+    const double x = 4.1e6, y = -2.3e6, z = 4.4e6, r = std::sqrt(x * x + y * y + z * z);
+    const double mu = GravityFieldConstants::MU, R = GravityFieldConstants::RADIUS;
+    double a[3];
+
+    // only C00: -mu r / r^3
+    GravityField<double> pointMass(6, 6);
+    pointMass.acceleration(x, y, z, a);
+    assert(std::abs(a[0] + mu * x / (r * r * r)) < 1e-12 * mu / (r * r));
+    assert(std::abs(a[1] + mu * y / (r * r * r)) < 1e-12 * mu / (r * r));
+    assert(std::abs(a[2] + mu * z / (r * r * r)) < 1e-12 * mu / (r * r));
+
+    // J2 against its closed form
+    GravityField<double> j2(2, 0);
+    j2.setCoefficient(2, 0, -GravityFieldConstants::J2 / std::sqrt(5.0), 0);
+    j2.acceleration(x, y, z, a);
+    const double k = 1.5 * GravityFieldConstants::J2 * mu * R * R / std::pow(r, 5), zz = 5 * z * z / (r * r);
+    const double expected[3] = {-mu * x / (r * r * r) - k * x * (1 - zz), -mu * y / (r * r * r) - k * y * (1 - zz),
+                                -mu * z / (r * r * r) - k * z * (3 - zz)};
+    for (int i = 0; i < 3; i++)
+        assert(std::abs(a[i] - expected[i]) < 1e-12 * mu / (r * r));
+    std::cout << "  point mass and J2 passed" << std::endl;
+}
+
+void testGravityAgainstLegendre()
+{
+    // the recursion's potential against the series written out with std::assoc_legendre, and its acceleration against
+    // the gradient of the potential, at a few places including right above a pole
+    const int degree = 8;
+    const GravityField<double> field = randomGravityField(degree, degree);
+    const double mu = field.gravitationalParameter(), R = field.referenceRadius();
+    const double points[4][3] = {{6.5e6, 1e5, -2e5}, {-3e6, 4e6, 4.5e6}, {1.0, -2.0, 6.9e6}, {2e6, -5e6, -4e6}};
+    for (const auto &p : points)
+    {
+        const double r = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        const double sinLat = p[2] / r, lon = std::atan2(p[1], p[0]);
+        double u = 0;
+        for (int n = 0; n <= degree; n++)
+            for (int m = 0; m <= n; m++)
+            {
+                const double norm = std::sqrt((m == 0 ? 1.0 : 2.0) * (2 * n + 1) * std::tgamma(n - m + 1.0) / std::tgamma(n + m + 1.0));
+                u += std::pow(R / r, n) * norm * std::assoc_legendre(n, m, sinLat) *
+                     (field.C(n, m) * std::cos(m * lon) + field.S(n, m) * std::sin(m * lon));
+            }
+        u *= mu / r;
+        assert(std::abs(field.potential(p[0], p[1], p[2]) - u) < 1e-13 * std::abs(u));
+
+        double a[3];
+        field.acceleration(p[0], p[1], p[2], a);
+        const double h = 1.0;
+        for (int i = 0; i < 3; i++)
+        {
+            double plus[3] = {p[0], p[1], p[2]}, minus[3] = {p[0], p[1], p[2]};
+            plus[i] += h;
+            minus[i] -= h;
+            const double gradient = (field.potential(plus[0], plus[1], plus[2]) - field.potential(minus[0], minus[1], minus[2])) / (2 * h);
+            assert(std::abs(a[i] - gradient) < 1e-7 * mu / (r * r));
+        }
+    }
+
+    // at a high degree the gradient still matches the potential
+    const GravityField<double> high = randomGravityField(70, 70);
+    double a[3];
+    high.acceleration(-3e6, 4e6, 4.5e6, a);
+    for (int i = 0; i < 3; i++)
+    {
+        double plus[3] = {-3e6, 4e6, 4.5e6}, minus[3] = {-3e6, 4e6, 4.5e6};
+        plus[i] += 1;
+        minus[i] -= 1;
+        assert(std::abs(a[i] - (high.potential(plus[0], plus[1], plus[2]) - high.potential(minus[0], minus[1], minus[2])) / 2) < 1e-6);
+    }
+    std::cout << "  gravity against Legendre series passed" << std::endl;
+}
+
+void testGravityFieldFile()
+{
+    std::remove(GRAVITY_TEST_FILE);
+    {
+        std::ofstream out(GRAVITY_TEST_FILE);
+        out << "product_type gravity_field\nmodelname test\nearth_gravity_constant 3.986004415E+14\nradius 6378136.3\n"
+            << "max_degree 3\nnorm fully_normalized\nkey n m C S sigmaC sigmaS\nend_of_head ==========\n"
+            << "gfc 0 0 1.0 0.0 0 0\ngfc 2 0 -0.484165143790815D-03 0.0 0 0\ngfc 2 2 2.43938357328313e-06 -1.40027370385934e-06 0 0\n"
+            << "gfc 3 1 2.03046201047864e-06 2.48200415856872e-07 0 0\ngfc 3 3 1.0e-7 2.0e-7 0 0\n";
+    }
+    GravityField<double> field(GRAVITY_TEST_FILE, 3);
+    assert(field.degree() == 3 and field.order() == 3 and field.gravitationalParameter() == 3.986004415e14);
+    assert(field.C(2, 0) == -0.484165143790815e-3 and field.S(2, 2) == -1.40027370385934e-06 and field.C(3, 3) == 1e-7);
+
+    // terms past the order asked for are left out
+    GravityField<double> truncated(GRAVITY_TEST_FILE, 3, 1);
+    assert(truncated.C(3, 1) == field.C(3, 1) and truncated.order() == 1);
+    bool threw = false;
+    try
+    {
+        truncated.setCoefficient(2, 2, 0, 0);
+    }
+    catch (const std::out_of_range &)
+    {
+        threw = true;
+    }
+    assert(threw);
+
+    // plain EGM2008 style lines, unnormalized in an ICGEM header
+    {
+        std::ofstream out(GRAVITY_TEST_FILE);
+        out << "    2    0   -0.484165143790815D-03    0.000000000000000D+00    0.0 0.0\n"
+            << "    2    1   -0.206615509074176D-09    0.138441389137979D-08    0.0 0.0\n";
+    }
+    GravityField<double> plain(GRAVITY_TEST_FILE, 2);
+    assert(plain.C(0, 0) == 1 and plain.C(2, 1) == -0.206615509074176e-9 and plain.S(2, 1) == 0.138441389137979e-8);
+    {
+        std::ofstream out(GRAVITY_TEST_FILE);
+        out << "norm unnormalized\nend_of_head\ngfc 2 0 -1.08262668e-3 0\n";
+    }
+    GravityField<double> unnormalized(GRAVITY_TEST_FILE, 2);
+    assert(std::abs(unnormalized.C(2, 0) + GravityFieldConstants::J2 / std::sqrt(5.0)) < 1e-18);
+
+    {
+        std::ofstream out(GRAVITY_TEST_FILE);
+        out << "gfc 2 3 1.0 0.0\n";
+    }
+    threw = false;
+    try
+    {
+        GravityField<double> broken(GRAVITY_TEST_FILE, 4);
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    std::remove(GRAVITY_TEST_FILE);
+    threw = false;
+    try
+    {
+        GravityField<double> missing(GRAVITY_TEST_FILE, 4);
+    }
+    catch (const std::runtime_error &)
+    {
+        threw = true;
+    }
+    assert(threw);
+    std::cout << "  gravity field file passed" << std::endl;
+}
+
+void testGravityFieldFlight()
+{
+    // with the repo's point mass as the field the flight lands where getFinalPosition does, J2 moves it by kilometres
+    const double lat = 0.5;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    const double stepSize = 1e-2;
+
+    const RK4Solution<double> reference = getFinalPosition<RK4>(pos, v, stepSize);
+    GravityField<double> pointMass(2, 2, Physics::G * Physics::EARTH_MASS, Physics::EARTH_RADIUS);
+    const RK4Solution<double> field = getFinalPosition<RK4>(pointMass, pos, v, stepSize);
+    assert(field.status == SolutionStatus::EndCondition and field.steps == reference.steps);
+    assert(field.solutions.getCols() == 7 and std::abs(field.solutions(0, 6) - (field.steps + 1) * stepSize) < 1e-6);
+    for (int i = 0; i < 6; i++)
+        assert(std::abs(field.solutions(0, i) - reference.solutions(0, i)) < 1e-6 * (i < 3 ? Physics::EARTH_RADIUS : 1e3));
+
+    pointMass.setCoefficient(2, 0, -GravityFieldConstants::J2 / std::sqrt(5.0), 0);
+    const RK4Solution<double> j2 = getFinalPosition<RK4>(pointMass, pos, v, stepSize);
+    const double shift = std::sqrt(std::pow(j2.solutions(0, 0) - reference.solutions(0, 0), 2) +
+                                   std::pow(j2.solutions(0, 1) - reference.solutions(0, 1), 2) +
+                                   std::pow(j2.solutions(0, 2) - reference.solutions(0, 2), 2));
+    assert(shift > 1e3);
+    std::cout << "  gravity field flight passed (J2 moves the impact " << shift / 1e3 << "km)" << std::endl;
+}
+
+void runGravityFieldTests()
+{
+    testGravityPointMassAndJ2();
+    testGravityAgainstLegendre();
+    testGravityFieldFile();
+    testGravityFieldFlight();
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <thread>
+#include <chrono>
+#include "ringbuffer.h"
+#include "liveview.h"
+
+void testRingBuffer()
+{
+    SPSCRing<int> ring(5);
+    assert(ring.capacity() == 8);
+    int value;
+    assert(!ring.tryPop(value));
+    for (int i = 0; i < 8; i++)
+        assert(ring.tryPush(i));
+    assert(!ring.tryPush(8));
+    for (int i = 0; i < 8; i++)
+        assert(ring.tryPop(value) and value == i);
+    assert(!ring.tryPop(value));
+
+    // across threads every value arrives, in order
+    SPSCRing<int> shared(64);
+    const int n = 200000;
+    auto produce = [&]()
+    {
+        for (int i = 0; i < n; i++)
+            while (!shared.tryPush(i))
+                std::this_thread::yield();
+    };
+    std::thread producer(produce);
+    for (int expected = 0; expected < n; expected++)
+    {
+        while (!shared.tryPop(value))
+            std::this_thread::yield();
+        assert(value == expected);
+    }
+    producer.join();
+    std::cout << "  ring buffer passed" << std::endl;
+}
+
+void testTrailProjection()
+{
+    // the path drawn a few points at a time, rescaling along the way, looks the same as drawn from scratch at the end
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 4);
+    const Vector3<double> initialV = localToInertial(Math::pi / 4, 0.0, Vector3<double>(300, 300, 600));
+    TrajectoryProjection projection(LiveViewConstants::WIDTH, LiveViewConstants::HEIGHT, initialPos, initialV);
+    Renderer renderer(LiveViewConstants::WIDTH, LiveViewConstants::HEIGHT);
+    std::vector<Vector3<double>> path = {initialPos};
+    int rescales = 0;
+    double lastEarth = -1;
+    for (int chunk = 1; path.size() < 2000; chunk++)
+    {
+        for (int k = 0; k < chunk; k++)
+        {
+            const double t = path.size() * 0.1;
+            path.push_back(Vector3<double>::fromSpherical(Physics::EARTH_RADIUS + 600 * t - 4.9 * t * t + 1e3, 2e-6 * t, Math::pi / 4 - 2e-6 * t));
+        }
+        projection.update(path);
+        RenderObject earth = projection.earth(), head = projection.head(path.back());
+        renderer.addObjectToBuffer(&earth);
+        renderer.addObjectToBuffer(&projection.trail());
+        renderer.addObjectToBuffer(&head);
+        const std::vector<unsigned char> incremental = renderer.drawFrame().pixels;
+
+        RenderObject whole = projection.path(path);
+        renderer.addObjectToBuffer(&earth);
+        renderer.addObjectToBuffer(&whole);
+        assert(renderer.drawFrame().pixels == incremental);
+
+        rescales += earth.getRendist(0, LiveViewConstants::HEIGHT - 1) != lastEarth;
+        lastEarth = earth.getRendist(0, LiveViewConstants::HEIGHT - 1);
+    }
+    assert(rescales > 1);
+    std::cout << "  trail projection passed" << std::endl;
+}
+
+void testLiveView()
+{
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, 3.141592653589793238 / 4);
+    Vector3<double> initialV = localToInertial(3.141592653589793238 / 4, 0.0, Vector3<double>(300, 300, 600));
+    LiveViewOptions options;
+    options.stepSize = 1e-2;
+    RK4Solution<double> reference = getFinalPosition<RK4>(initialPos, initialV, options.stepSize);
+
+    // the animation does not change the result
+    LiveViewStats stats;
+    size_t bytes = 0;
+    auto count = [&](const std::string &frame)
+    {
+        bytes += frame.size();
+    };
+    RK4Solution<double> animated = animateTrajectory(initialPos, initialV, options, &stats, count);
+    assert(animated.solutions == reference.solutions and animated.time == reference.time and animated.status == SolutionStatus::EndCondition);
+    assert(stats.frames >= 1 and bytes > 0);
+    assert(stats.samples + stats.droppedSamples == (long long)std::floor(animated.time / options.sampleInterval + 1e-9));
+
+    // a slow renderer with a tiny ring loses samples and frames, the integrator is not held back
+    options.ringCapacity = 2;
+    options.framesPerSecond = 1000;
+    options.stepSize = 1e-3; // long enough an integration for the renderer to fall behind
+    reference = getFinalPosition<RK4>(initialPos, initialV, options.stepSize);
+    auto slow = [](const std::string &)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    };
+    RK4Solution<double> throttled = animateTrajectory(initialPos, initialV, options, &stats, slow);
+    assert(throttled.solutions == reference.solutions);
+    assert(stats.droppedSamples > 0 and stats.samples >= 2 and stats.droppedFrames > 0);
+    std::cout << "  live view passed" << std::endl;
+}
+
+void runLiveViewTests()
+{
+    testRingBuffer();
+    testTrailProjection();
+    testLiveView();
+}
@@ -3,7 +3,9 @@
 #include <iostream>
 #include <cassert>
 #include <vector>
+#include <thread>
 #include "linalg.h"
+#include "arena.h"
 
 void testMatrixEquality()
 {
@@ -177,6 +179,88 @@ void testMatrixVectorMultiplication()
     std::cout << "  matrix-vector multiplication passed" << std::endl;
 }
 
+void testMatrixArena()
+{
+    // outside a scope every matrix takes a heap buffer
+    long long before = matrixHeapAllocations();
+    Matrix<double> a({{1, 2}, {3, 4}}), b(2, 2), kept(1, 1);
+    assert(matrixHeapAllocations() == before + 3);
+
+    // inside one, temporaries come from the arena and are all given back at the end
+    MonotonicArena &arena = threadArena();
+    const MonotonicArena::Mark start = arena.mark();
+    before = matrixHeapAllocations();
+    {
+        ArenaScope scope;
+        for (int i = 0; i < 1000; i++)
+        {
+            ArenaScope iteration;
+            b = a * a + 2.0 * a.transpose() - a.inverse();
+            Matrix<double> c = b * (double)i;
+            assert(c(1, 1) == b(1, 1) * i);
+        }
+        // results escape by copy, a new size for a matrix made outside comes from the heap
+        kept = a * b;
+        assert(matrixHeapAllocations() == before + 1);
+    }
+    assert(arena.mark().block == start.block and arena.mark().used == start.used and activeArena() == nullptr);
+    assert(b == Matrix<double>({{11, 15}, {17.5, 30.5}}) and kept == Matrix<double>({{46, 76}, {103, 167}}));
+
+    // same size assignment and moves of heap matrices need no new buffer
+    before = matrixHeapAllocations();
+    b = a;
+    Matrix<double> moved(std::move(b));
+    b = std::move(moved);
+    assert(matrixHeapAllocations() == before and b == a);
+
+    // a given arena, whatever is active; the arena reuses its blocks once rewound
+    MonotonicArena own(256);
+    std::size_t capacity = 0;
+    for (int round = 0; round < 3; round++)
+    {
+        own.reset();
+        for (int i = 0; i < 20; i++)
+        {
+            Matrix<double> m(3, 3, own);
+            assert(m(2, 2) == 0);
+        }
+        assert(round == 0 or own.capacity() == capacity);
+        capacity = own.capacity();
+    }
+    assert(matrixHeapAllocations() == before);
+
+    // moving out of an arena that is not the active one copies to the heap, the arena may be rewound first; in the
+    // active arena (or under a HeapScope) the buffer is taken over as usual
+    {
+        own.reset();
+        Matrix<double> inOwn(2, 2, own);
+        inOwn(0, 1) = 5;
+        Matrix<double> escaped(std::move(inOwn));
+        own.reset();
+        Matrix<double> reused(2, 2, own);
+        reused(0, 1) = 7;
+        assert(matrixHeapAllocations() == before + 1 and escaped(0, 1) == 5);
+
+        ArenaScope scope(own);
+        Matrix<double> local(2, 2);
+        Matrix<double> adopted(std::move(local));
+        assert(matrixHeapAllocations() == before + 1);
+        HeapScope heap;
+        Matrix<double> member(2, 2);
+        assert(matrixHeapAllocations() == before + 2);
+    }
+    assert(activeArena() == nullptr);
+    before = matrixHeapAllocations();
+
+    // every thread has an arena of its own
+    MonotonicArena *other = nullptr;
+    std::thread t([&]()
+                  { other = &threadArena(); });
+    t.join();
+    assert(other != &threadArena());
+    std::cout << "  arena passed" << std::endl;
+}
+
 void runMatrixTests()
 {
     testMatrixEquality();
@@ -191,6 +275,7 @@ void runMatrixTests()
     testMatrixDeterminant();
     testMatrixInverse();
     testMatrixExceptions();
+    testMatrixArena();
 
     std::cout << "Running Matrix and Vector3 combined tests" << std::endl;
     testMatrixVectorMultiplication();
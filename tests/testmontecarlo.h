@@ -0,0 +1,114 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include "montecarlo.h"
+
+MonteCarloInputs testMonteCarloInputs()
+{
+    MonteCarloInputs inputs;
+    inputs.latitude = 40;
+    inputs.longitude = 0;
+    inputs.speed = 800;
+    inputs.eastAngle = 45;
+    inputs.groundAngle = 45;
+    inputs.speedError = {DistributionKind::Normal, 5};
+    inputs.eastAngleError = {DistributionKind::Uniform, 0.5};
+    inputs.groundAngleError = {DistributionKind::Normal, 0.2};
+    return inputs;
+}
+
+void testCounterRNG()
+{
+    CounterRNG rng(42), other(43);
+    // same counter, same number; different seed or counter, different number
+    assert(rng.bits(7, 3) == CounterRNG(42).bits(7, 3));
+    assert(rng.bits(7, 3) != other.bits(7, 3) and rng.bits(7, 3) != rng.bits(8, 3) and rng.bits(7, 3) != rng.bits(7, 4));
+
+    double mean = 0, var = 0;
+    const int n = 100000;
+    for (int i = 0; i < n; i++)
+    {
+        double x = rng.normal(i, 0);
+        mean += x / n;
+        var += x * x / n;
+    }
+    assert(std::abs(mean) < 0.02 and std::abs(var - 1) < 0.02);
+    std::cout << "  counter rng passed" << std::endl;
+}
+
+void testLandingMomentsMerge()
+{
+    // merging blocks gives the same moments as one sequential pass
+    LandingMoments all, first, second;
+    for (int i = 0; i < 1000; i++)
+    {
+        double e = std::sin(i * 0.37) * 100 + 5, n = std::cos(i * 0.11) * 30 + e / 10, t = 200 + i % 7;
+        all.add(e, n, t);
+        (i < 300 ? first : second).add(e, n, t);
+    }
+    first.merge(second);
+    assert(first.n == all.n);
+    assert(std::abs(first.meanEast - all.meanEast) < 1e-9 and std::abs(first.meanNorth - all.meanNorth) < 1e-9);
+    assert(std::abs(first.m2East - all.m2East) < 1e-6 * all.m2East and std::abs(first.cEastNorth - all.cEastNorth) < 1e-6 * std::abs(all.cEastNorth));
+    assert(std::abs(first.m2Time - all.m2Time) < 1e-6 * all.m2Time);
+    std::cout << "  landing moments merge passed" << std::endl;
+}
+
+void testMonteCarloReproducible()
+{
+    // the same seed gives the same statistics bit for bit whatever the thread count
+    MonteCarloInputs inputs = testMonteCarloInputs();
+    DispersionStats one = runMonteCarlo(inputs, 300, 7, 1);
+    DispersionStats three = runMonteCarlo(inputs, 300, 7, 3);
+    assert(one.landed == 300 and three.landed == 300);
+    assert(std::memcmp(&one.moments, &three.moments, sizeof(LandingMoments)) == 0);
+    assert(one.miss.counts == three.miss.counts);
+    DispersionStats otherSeed = runMonteCarlo(inputs, 300, 8, 1);
+    assert(otherSeed.moments.meanEast != one.moments.meanEast);
+    std::cout << "  monte carlo reproducible passed" << std::endl;
+}
+
+void testMonteCarloStatistics()
+{
+    // streaming statistics against the stored samples
+    MonteCarloInputs inputs = testMonteCarloInputs();
+    const long long n = 200;
+    DispersionStats stats = runMonteCarlo(inputs, n, 11, 2);
+
+    const DispersionFrame frame = dispersionFrame(inputs, MonteCarloConstants::STEP_SIZE);
+    CounterRNG rng(11);
+    std::vector<double> miss;
+    double meanEast = 0;
+    for (long long i = 0; i < n; i++)
+    {
+        LandingSample s = dispersionSample(inputs, frame, rng, i, MonteCarloConstants::STEP_SIZE);
+        meanEast += s.east / n;
+        miss.push_back(std::sqrt(s.east * s.east + s.north * s.north));
+    }
+    std::sort(miss.begin(), miss.end());
+    const double median = (miss[n / 2 - 1] + miss[n / 2]) / 2;
+    assert(std::abs(stats.moments.meanEast - meanEast) < 1e-6);
+    // the histogram resolves percentiles to ~4%
+    assert(std::abs(stats.cep() - median) < 0.05 * median);
+    assert(stats.ellipseMajor() >= stats.ellipseMinor() and stats.ellipseMinor() > 0);
+
+    // without errors every sample lands on the nominal point
+    MonteCarloInputs exact = inputs;
+    exact.speedError.spread = exact.eastAngleError.spread = exact.groundAngleError.spread = 0;
+    DispersionStats none = runMonteCarlo(exact, 10, 11, 2);
+    assert(none.landed == 10 and none.ellipseMajor() < 1e-6 and none.cep() <= MonteCarloConstants::MIN_MISS);
+    std::cout << "  monte carlo statistics passed" << std::endl;
+}
+
+void runMonteCarloTests()
+{
+    testCounterRNG();
+    testLandingMomentsMerge();
+    testMonteCarloReproducible();
+    testMonteCarloStatistics();
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include "physics.h"
+#include "observers.h"
+#include "denseoutput.h"
+
+// counts the states it sees and checks they come in order
+struct CountingObserver
+{
+    int states = 0, lasts = 0;
+    double time = -1;
+
+    void onStep(const SolverStep<double> &step)
+    {
+        assert(step.index == states and step.time >= time);
+        states++;
+        lasts += step.last;
+        time = step.time;
+    }
+};
+
+void testObserversSeeEveryState()
+{
+    // observers change nothing in the solution, and see the initial state, every step and the last state once
+    const double lat = 0.5;
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, Math::pi / 2 - lat);
+    const Vector3<double> spin = spinningv(lat, 0.0);
+    const Vector3<double> v = 2000 * (localToInertial(lat, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    for (int abm : {0, 1})
+    {
+        CountingObserver counter;
+        DenseTrajectory<double> flight;
+        RK4Solution<double> plain = abm ? getFinalPosition<ABM>(pos, v, 0.1) : getFinalPosition<RK4>(pos, v, 0.1);
+        RK4Solution<double> observed = abm ? getFinalPosition<ABM, double>(pos, v, 0.1, RK4Constants::MAX_FLIGHT_TIME, counter, flight)
+                                           : getFinalPosition<RK4, double>(pos, v, 0.1, RK4Constants::MAX_FLIGHT_TIME, counter, flight);
+        assert(observed.solutions == plain.solutions and observed.time == plain.time and observed.steps == plain.steps);
+        assert(counter.lasts == 1 and counter.states == flight.size());
+        if (!abm)
+            assert(counter.states == plain.steps + 2);
+        assert(counter.states >= plain.steps + 2);
+    }
+
+    // running out of steps: the last state seen is the last one integrated
+    CountingObserver counter;
+    RK4<double> solver(0.1);
+    Matrix<double> initial({{Physics::EARTH_RADIUS + 1e5, 0, 0, 0, 7000, 0}});
+    solver.solve(initial, gravitationalDerivatives<double>, 50, objectInsideEarth<double>, counter);
+    assert(counter.states == 51 and counter.lasts == 1 and std::abs(counter.time - 5) < 1e-12);
+    std::cout << "  observers see every state passed" << std::endl;
+}
+
+void testBuiltInObservers()
+{
+    // straight up and down, no spin: the top from vis-viva, 1/ra = 1/R - v^2 / (2 mu)
+    const double mu = Physics::G * Physics::EARTH_MASS, speed = 3000;
+    const Vector3<double> pos(Physics::EARTH_RADIUS, 0, 0), v(speed, 0, 0);
+    const double ra = 1 / (1 / Physics::EARTH_RADIUS - speed * speed / (2 * mu));
+
+    ApogeeObserver<double> apogee;
+    auto speeds = makeMinMaxObserver<double>(stepSpeed<double>);
+    EnergyObserver<double> energy;
+    DecimatingRecorder<double> track(100);
+    DenseTrajectory<double> flight;
+    for (double stepSize : {0.1, 0.37})
+    {
+        RK4Solution<double> sol = getFinalPosition<RK4, double>(pos, v, stepSize, RK4Constants::MAX_FLIGHT_TIME, apogee, speeds, energy, track, flight);
+        assert(sol.status == SolutionStatus::EndCondition);
+        // the top does not depend on where the steps fall
+        assert(std::abs(apogee.radius - ra) < 1e-2);
+        assert(std::abs(apogee.time - flight.endTime() / 2) < stepSize);
+        Apogee<double> dense = findApogee(flight);
+        assert(std::abs(dense.altitude - apogee.altitude()) < 1e-3 and std::abs(dense.time - apogee.time) < 1e-3);
+
+        // fastest at launch or impact (which is a little below the surface), slowest at the top
+        assert(speeds.max >= speed and speeds.max < speed + 10 and (speeds.maxTime == 0 or speeds.maxTime == flight.endTime()));
+        assert(speeds.min < 10 * stepSize and std::abs(speeds.minTime - apogee.time) < stepSize);
+
+        assert(std::abs(energy.initial - (speed * speed / 2 - mu / Physics::EARTH_RADIUS)) < 1e-6);
+        assert(energy.relativeDrift() < 1e-9 and energy.maxDrift >= std::abs(energy.latest - energy.initial));
+
+        // every 100th state and the last one
+        const int states = flight.size();
+        assert(track.size() == (states - 1) / 100 + 1 + ((states - 1) % 100 != 0));
+        assert(track.times[1] == flight.knotTime(100) and track.times.back() == flight.endTime());
+        assert(track.states[6] == flight.knotState(100)[0]);
+    }
+    std::cout << "  built-in observers passed" << std::endl;
+}
+
+void runObserverTests()
+{
+    testObserversSeeEveryState();
+    testBuiltInObservers();
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <sstream>
+#include <limits>
+#include "trajectoryoptimization.h"
+#include "anytimeoptimization.h"
+
+void testBrentParabola()
+{
+    int calls = 0;
+    auto f = [&](double x)
+    {
+        calls++;
+        return (x - 41.3) * (x - 41.3) + 2;
+    };
+    int evaluations = 0;
+    double x = brentMinimize(f, 15, 75, 1e-3, 30, &evaluations);
+    assert(std::abs(x - 41.3) < 2e-3 and evaluations == calls and evaluations < 10);
+    std::cout << "  brent parabola passed" << std::endl;
+}
+
+void testBrentBounds()
+{
+    // the minimum lies outside the interval, the search must stay inside and end at the closest end
+    double lowest = 100, highest = -100;
+    auto f = [&](double x)
+    {
+        lowest = std::min(lowest, x);
+        highest = std::max(highest, x);
+        return std::exp(x);
+    };
+    int evaluations = 0;
+    double x = brentMinimize(f, 15, 75, 1e-2, 40, &evaluations);
+    assert(lowest >= 15 and highest <= 75 and x - 15 < 5e-2 and evaluations <= 40);
+    std::cout << "  brent bounds passed" << std::endl;
+}
+
+void testBrentNonSmooth()
+{
+    // |x - c| defeats parabolic steps, golden section must still converge within the evaluation cap
+    auto f = [](double x)
+    { return std::abs(x - 33.3); };
+    int evaluations = 0;
+    double x = brentMinimize(f, 15, 75, 1e-2, 60, &evaluations);
+    assert(std::abs(x - 33.3) < 5e-2 and evaluations < 60);
+    std::cout << "  brent non-smooth passed" << std::endl;
+}
+
+void testBrentInfeasible()
+{
+    // optimizeTrajectory gives the angles whose solve failed an infinite energy, the search must keep away from them
+    auto f = [](double x)
+    { return (x > 55) ? std::numeric_limits<double>::infinity() : (x - 41.3) * (x - 41.3); };
+    int evaluations = 0;
+    double x = brentMinimize(f, 15, 75, 1e-2, 40, &evaluations);
+    assert(std::abs(x - 41.3) < 5e-2 and evaluations < 40);
+    std::cout << "  brent infeasible passed" << std::endl;
+}
+
+void testMixedPrecisionSolve()
+{
+    // the float stage lands within the float tolerance at the float step, and the double stage started from it ends
+    // where a double solve from scratch does
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    TargetingOptions floatOnly;
+    floatOnly.floatOnly = true;
+    TargetingStats floatStats, mixedStats, doubleStats;
+    TargetingSeed seed;
+    seed.x = greatCircleGuess(initialPos, finalPos);
+    getInputsMixedPrecision(40, initialPos, finalPos, floatOnly, &floatStats, &seed);
+    const vAngle mixed = getInputsMixedPrecision(40, initialPos, finalPos, TargetingOptions(), &mixedStats);
+    const vAngle reference = getInputs<double>(40, initialPos, finalPos, TargetingOptions(), &doubleStats);
+    std::cout.rdbuf(out);
+    assert(floatStats.converged and seed.squaredError <= Precision<float>::LOCATION_TOLERANCE and seed.stepSize == Precision<float>::STEP_SIZE);
+    assert(mixedStats.converged and doubleStats.converged);
+    // both land within sqrt(LOCATION_TOLERANCE) (~6m) of the target, so they can be ~13m apart: ~0.02m/s, ~4e-4 degrees
+    assert(std::abs(mixed.v - reference.v) < 5e-2 and std::abs(mixed.eastAngle - reference.eastAngle) < 1e-3);
+    Vector3<double> inertialV, landing;
+    RK4Solution<double> sol(0, 0, 0, Matrix<double>(1, 1));
+    Matrix<double> y(2, 1), goal(2, 1);
+    goal(0, 0) = Math::pi / 2 - finalPos.phi();
+    goal(1, 0) = finalPos.theta();
+    simulate(vAngle(mixed.v * Physics::NORM_VEL, mixed.eastAngle * Physics::NORM_DEG), 40, initialPos, inertialV, sol, landing, y);
+    assert(squaredLocationError(y, goal) <= Precision<double>::LOCATION_TOLERANCE);
+    std::cout << "  mixed precision solve passed (float stage within " << std::sqrt(seed.squaredError) * Physics::EARTH_RADIUS << "m)" << std::endl;
+}
+
+void testMultiFidelitySolve()
+{
+    // coarse steps far from the target cost fewer integration steps, and the last simulation still runs at the full step
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    TargetingOptions single;
+    single.multiFidelity = false;
+    TargetingStats multi, full;
+    TargetingSeed seed;
+    seed.x = greatCircleGuess(initialPos, finalPos);
+    getInputs<double>(40, initialPos, finalPos, TargetingOptions(), &multi, &seed);
+    getInputs<double>(40, initialPos, finalPos, single, &full);
+    std::cout.rdbuf(out);
+    assert(multi.converged and full.converged);
+    assert(seed.squaredError <= Precision<double>::LOCATION_TOLERANCE and seed.stepSize == RK4Constants::STEP_SIZE);
+    assert(multi.integrationSteps < full.integrationSteps);
+    std::cout << "  multi-fidelity solve passed (" << multi.integrationSteps << " integration steps against " << full.integrationSteps << ")" << std::endl;
+}
+
+void testJointOptimization()
+{
+    // the reduced SQP lands on the target and finds the same optimum as the ground angle search
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    TargetingStats stats, nestedStats;
+    const Vector3<double> joint = optimizeTrajectoryJoint(initialPos, finalPos, 1.0, &stats);
+    const Vector3<double> nested = optimizeTrajectory(initialPos, finalPos, 1.0, &nestedStats);
+    std::cout.rdbuf(out);
+    assert(stats.converged and stats.solves == 1 and nestedStats.converged);
+    Vector3<double> inertialV, landing;
+    RK4Solution<double> sol(0, 0, 0, Matrix<double>(1, 1));
+    Matrix<double> y(2, 1), goal(2, 1);
+    goal(0, 0) = Math::pi / 2 - finalPos.phi();
+    goal(1, 0) = finalPos.theta();
+    simulate<double, ABM>(vAngle(joint[0] * Physics::NORM_VEL, joint[1] * Physics::NORM_DEG), joint[2], initialPos, inertialV, sol, landing, y);
+    assert(squaredLocationError(y, goal) <= Precision<double>::LOCATION_TOLERANCE);
+    // the energy is flat around the optimum, so the speeds agree far better than the ground angles
+    assert(std::abs(joint[0] - nested[0]) < 5e-2 and std::abs(joint[2] - nested[2]) < 0.1);
+    std::cout << "  joint optimization passed (" << joint[0] << "m/s at " << joint[2] << " degrees against " << nested[0] << "m/s at " << nested[2] << ")" << std::endl;
+}
+
+void testTargetingStrategies()
+{
+    // every strategy lands on the target, and Broyden's rank one updates save simulations over Newton's differences
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    const TargetingStrategy strategies[] = {TargetingStrategy::Newton, TargetingStrategy::Broyden, TargetingStrategy::LevenbergMarquardt};
+    TargetingStats stats[3];
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    for (int i = 0; i < 3; i++)
+    {
+        TargetingOptions options;
+        options.strategy = strategies[i];
+        TargetingSeed seed;
+        seed.x = greatCircleGuess(initialPos, finalPos);
+        getInputs<double>(40, initialPos, finalPos, options, &stats[i], &seed);
+        assert(stats[i].converged and seed.squaredError <= Precision<double>::LOCATION_TOLERANCE);
+    }
+    std::cout.rdbuf(out);
+    assert(stats[1].simulations < stats[0].simulations);
+    std::cout << "  targeting strategies passed (simulations: Newton " << stats[0].simulations << ", Broyden " << stats[1].simulations << ", LM " << stats[2].simulations << ")"
+              << std::endl;
+}
+
+void testWarmStartedSolve()
+{
+    // a solve seeded with its neighbour's solution and Jacobian lands on the same inputs as a cold one, in
+    // one or two Newton iterations per precision stage
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    TargetingSeed seed;
+    seed.x = greatCircleGuess(initialPos, finalPos);
+    getInputsMixedPrecision(40, initialPos, finalPos, TargetingOptions(), nullptr, &seed);
+    TargetingStats cold, warm;
+    const vAngle reference = getInputsMixedPrecision(40.5, initialPos, finalPos, TargetingOptions(), &cold);
+    seed.squaredError = 0;
+    const vAngle x = getInputsMixedPrecision(40.5, initialPos, finalPos, TargetingOptions(), &warm, &seed);
+    std::cout.rdbuf(out);
+    assert(cold.converged and warm.converged and warm.iterations <= 3 and warm.iterations < cold.iterations);
+    assert(std::abs(x.v - reference.v) < 1e-2 and std::abs(x.eastAngle - reference.eastAngle) < 1e-4);
+    std::cout << "  warm started solve passed (" << warm.iterations << " iterations against " << cold.iterations << ")" << std::endl;
+}
+
+void testAnytimeBudgets()
+{
+    // a budget of one ground angle or a few milliseconds still gives a landing, without running the whole search
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    OptimizationBudget oneAngle, shortDeadline;
+    oneAngle.evaluations = 1;
+    shortDeadline.seconds = 0.05;
+    const AnytimeResult first = optimizeTrajectoryAnytime(initialPos, finalPos, 1.0, oneAngle);
+    const AnytimeResult quick = optimizeTrajectoryAnytime(initialPos, finalPos, 1.0, shortDeadline);
+    std::cout.rdbuf(out);
+    assert(first.found and !first.converged and first.evaluations == 1);
+    assert(first.energy == first.best[0] * first.best[0] / 2 and first.stepSize > 0);
+    assert(quick.found and !quick.converged and quick.seconds < 0.5 and quick.error < Physics::FEASIBLE_LANDING_ERROR);
+    std::cout << "  anytime budgets passed" << std::endl;
+}
+
+void testAnytimeUnlimited()
+{
+    // without a budget the full optimization runs out, and converged is what its last solve reports
+    const Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.2, Math::pi / 2 - 0.8);
+    const Vector3<double> finalPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.25, Math::pi / 2 - 0.79);
+    std::ostringstream log;
+    std::streambuf *out = std::cout.rdbuf(log.rdbuf());
+    TargetingStats stats;
+    const AnytimeResult full = optimizeTrajectoryAnytime(initialPos, finalPos, 1.0, OptimizationBudget(), TargetingOptions(), &stats);
+    std::cout.rdbuf(out);
+    assert(full.found and full.converged == stats.converged and full.converged);
+    assert(stats.solves > 0 and stats.simulations > 0);
+    std::cout << "  anytime unlimited passed" << std::endl;
+}
+
+void runOptimizationTests()
+{
+    testBrentParabola();
+    testBrentBounds();
+    testBrentNonSmooth();
+    testBrentInfeasible();
+    testMixedPrecisionSolve();
+    testMultiFidelitySolve();
+    testTargetingStrategies();
+    testWarmStartedSolve();
+    testAnytimeBudgets();
+    testAnytimeUnlimited();
+    testJointOptimization();
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include "physics.h"
+
+void testImpactStatus()
+{
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, 3.141592653589793238 / 4);
+    Vector3<double> initialV = localToInertial(3.141592653589793238 / 4, 0.0, Vector3<double>(300, 300, 600));
+    RK4Solution<double> sol = getFinalPosition<ABM>(initialPos, initialV, 1e-2);
+    assert(sol.status == SolutionStatus::EndCondition and sol.time > 0);
+    std::cout << "  impact status passed" << std::endl;
+}
+
+void testEscapeStatus()
+{
+    // well above escape speed, straight up: rejected without integrating
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, 3.141592653589793238 / 4);
+    Vector3<double> initialV = localToInertial(3.141592653589793238 / 4, 0.0, Vector3<double>(0, 0, 12000));
+    RK4Solution<double> sol = getFinalPosition(initialPos, initialV);
+    assert(sol.status == SolutionStatus::Escape and sol.steps == 0);
+    std::cout << "  escape status passed" << std::endl;
+}
+
+void testOrbitStatus()
+{
+    // circular orbit 500km up never reaches the surface
+    const double r = Physics::EARTH_RADIUS + 5e5;
+    Vector3<double> initialPos(r, 0, 0);
+    Vector3<double> initialV(0, std::sqrt(Physics::G * Physics::EARTH_MASS / r), 0);
+    RK4Solution<double> sol = getFinalPosition(initialPos, initialV);
+    assert(sol.status == SolutionStatus::Orbit and sol.steps == 0);
+    std::cout << "  orbit status passed" << std::endl;
+}
+
+void testFlightTimeCap()
+{
+    // lands after ~2500s, so a 1000s cap rejects it up front and a 3000s cap integrates it
+    Vector3<double> initialPos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0.0, 3.141592653589793238 / 4);
+    Vector3<double> initialV = localToInertial(3.141592653589793238 / 4, 0.0, 7000 * Vector3<double>(0.5, 0.5, std::sqrt(0.5)));
+    RK4Solution<double> capped = getFinalPosition<ABM>(initialPos, initialV, 1e-1, 1000);
+    RK4Solution<double> landed = getFinalPosition<ABM>(initialPos, initialV, 1e-1, 3000);
+    assert(capped.status == SolutionStatus::MaxSteps and capped.steps == 0);
+    assert(landed.status == SolutionStatus::EndCondition and landed.time > 1000 and landed.time < 3000);
+    std::cout << "  flight time cap passed" << std::endl;
+}
+
+void runPhysicsTests()
+{
+    testImpactStatus();
+    testEscapeStatus();
+    testOrbitStatus();
+    testFlightTimeCap();
+}
@@ -3,12 +3,17 @@
 #include <iostream>
 #include <cassert>
 #include <vector>
-#include <windows.h>
+#include <string>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+#include <chrono>
 #include "renderer.h"
+#include "framewriter.h"
 
 
-#define pi 3.141592653589793238
+const double pi = 3.141592653589793238;
 
 void displayFadingWhite()
 {
@@ -26,7 +31,7 @@ void displayFadingWhite()
         }
         renderer.addObjectToBuffer(o);
         renderer.render();
-        Sleep(100);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
     delete o;
@@ -40,7 +45,7 @@ void displayMovingCircle()
         renderer.addObjectToBuffer(o);
         renderer.render();
         delete o;
-        Sleep(50);
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
     }
 }
 
@@ -89,7 +94,7 @@ void displayMovingLineThroughCircle()
         renderer.addObjectToBuffer(w);
         renderer.addObjectToBuffer(v);
         renderer.render();
-        Sleep(10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
     delete w;
     delete v;
@@ -121,6 +126,262 @@ void testRendererCompatibility()
     std::cout << "  renderer compatibility passed" << std::endl;
 }
 
+// minimal terminal: applies renderer output (clear, cursor jumps, glyphs and newlines) to a character grid
+struct VirtualTerminal
+{
+    int columns, rows;
+    std::vector<std::string> screen;
+    int row = 0, column = 0;
+
+    VirtualTerminal(int c, int r) : columns(c), rows(r), screen(r + 1, std::string(c, ' ')) {}
+
+    void apply(const std::string &bytes)
+    {
+        for (size_t k = 0; k < bytes.size(); k++)
+        {
+            if (bytes[k] == '\033')
+            {
+                size_t end = bytes.find_first_of("HJ", k);
+                std::string arguments = bytes.substr(k + 2, end - k - 2);
+                if (bytes[end] == 'J')
+                    screen.assign(rows + 1, std::string(columns, ' '));
+                else
+                {
+                    size_t semicolon = arguments.find(';');
+                    row = std::stoi(arguments.substr(0, semicolon)) - 1;
+                    column = std::stoi(arguments.substr(semicolon + 1)) - 1;
+                }
+                k = end;
+            }
+            else if (bytes[k] == '\n')
+            {
+                row++;
+                column = 0;
+            }
+            else
+                screen[row][column++] = bytes[k];
+        }
+    }
+};
+
+void testDifferentialOutput()
+{
+    // an animation sent as differences leaves the same screen as drawing every frame in full
+    Renderer differential(50, 30), full(50, 30);
+    VirtualTerminal terminal(100, 30);
+    RenderObject circle = RenderObject::Circle(50, 30, 15, 10, 9, 5);
+    size_t fullBytes = 0, differentialBytes = 0;
+    for (int i = 0; i < 20; i++)
+    {
+        RenderObject line = RenderObject::Line(50, 30, 3, 4 + 5 * std::sin(2 * pi * i / 20), 30, 20 + 5 * std::sin(2 * pi * i / 20), 0, 10);
+        differential.addObjectToBuffer(&line);
+        differential.addObjectToBuffer(&circle);
+        std::string bytes = differential.composeFrame();
+        terminal.apply(bytes);
+        if (i > 0)
+            differentialBytes += bytes.size();
+
+        full.addObjectToBuffer(&line);
+        full.addObjectToBuffer(&circle);
+        full.invalidate();
+        VirtualTerminal reference(100, 30);
+        bytes = full.composeFrame();
+        reference.apply(bytes);
+        if (i > 0)
+            fullBytes += bytes.size();
+        assert(terminal.screen == reference.screen);
+        assert(terminal.row == 30 and terminal.column == 0);
+    }
+    // only the line moves
+    assert(differentialBytes * 5 < fullBytes);
+
+    // nothing changed, nothing sent
+    differential.addObjectToBuffer(&circle);
+    differential.composeFrame();
+    differential.addObjectToBuffer(&circle);
+    assert(differential.composeFrame().empty());
+    std::cout << "  differential output passed" << std::endl;
+}
+
+void testSharedDepthBuffer()
+{
+    // objects meet in one canvas: the closest wins, the first drawn keeps ties
+    RenderObject far = RenderObject::Circle(30, 30, 15, 15, 5, 10);
+    RenderObject near = RenderObject::Line(30, 30, 0, 15.5, 30, 15.5, 5, 5);
+    RenderObject tie = RenderObject::Circle(30, 30, 15, 15, 8, 10);
+    Canvas canvas(30, 30);
+    far.draw(canvas);
+    near.draw(canvas);
+    tie.draw(canvas);
+    assert(canvas.getData(15, 15) == 3 and canvas.getRendist(15, 15) == 5);
+    assert(canvas.getData(15, 12) == 1 and canvas.getRendist(15, 12) == 10);
+    assert(canvas.getData(15, 8) == 1 and canvas.getRendist(15, 8) == 10); // only the second circle reaches here
+    assert(canvas.getRendist(0, 0) < 0);
+
+    // pixels set by hand replace the object's own primitives, a transparent one reveals what is behind
+    RenderObject holed = RenderObject::Circle(30, 30, 15, 15, 5, 1);
+    holed.set(15, 15, 5, -1);
+    holed.set(16, 15, 5, 2);
+    assert(holed.getRendist(15, 15) < 0 and holed.getData(16, 15) == 5);
+    canvas.clear();
+    far.draw(canvas);
+    holed.draw(canvas);
+    assert(canvas.getData(15, 15) == 1 and canvas.getRendist(15, 15) == 10);
+    assert(canvas.getData(16, 15) == 5 and canvas.getRendist(16, 15) == 2);
+
+    // a merged object draws the same as the two objects in a row
+    RenderObject merged = RenderObject::Circle(30, 30, 15, 15, 5, 10);
+    merged.merge(&near);
+    Renderer one(30, 30), two(30, 30);
+    one.addObjectToBuffer(&merged);
+    two.addObjectToBuffer(&far);
+    two.addObjectToBuffer(&near);
+    assert(one.composeFrame() == two.composeFrame());
+    std::cout << "  shared depth buffer passed" << std::endl;
+}
+
+void testLineCoverage()
+{
+    // the walk covers exactly the pixels whose center lies within reach of the segment, tested here against every pixel
+    const int w = 40, h = 30;
+    for (int t = 0; t < 500; t++)
+    {
+        // deterministic mix of long, short, steep, flat and off screen segments
+        const double x1 = -3 + std::fmod(t * 7.31, 46.0), y1 = -3 + std::fmod(t * 3.77, 36.0);
+        const double scale = (t % 3 == 0) ? 0.4 : 25.0;
+        const double x2 = x1 + scale * std::cos(t * 0.91), y2 = y1 + (t % 5 == 0 ? 0.0 : scale * std::sin(t * 0.91));
+        RenderObject line = RenderObject::Line(w, h, x1, y1, x2, y2, 1, 2);
+        for (int j = 0; j < h; j++)
+        {
+            for (int i = 0; i < w; i++)
+            {
+                const double frac = ((x2 - x1) * (i + 0.5 - x1) + (y2 - y1) * (j + 0.5 - y1)) / ((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+                const double closestx = x1 + frac * (x2 - x1), closesty = y1 + frac * (y2 - y1);
+                const double dist2 = (closestx - i - 0.5) * (closestx - i - 0.5) + (closesty - j - 0.5) * (closesty - j - 0.5);
+                int expected = 0;
+                if (frac >= 0 and frac <= 1)
+                    expected = (dist2 <= 0.25) ? 3 : (dist2 <= 0.75) ? 4 : 0;
+                if (expected == 0)
+                    assert(line.getRendist(i, j) < 0);
+                else
+                    assert(line.getData(i, j) == expected and line.getRendist(i, j) == 1 + frac);
+            }
+        }
+    }
+    std::cout << "  line coverage passed" << std::endl;
+}
+
+void testTiledRendering()
+{
+    // tiles drawn on several threads give exactly the serial frame, over several frames of a moving scene
+    const int w = 150, h = 70;
+    RenderObject planet = RenderObject::Sphere(w, h, 75, 60, 30, 80);
+    RenderObject circle = RenderObject::Circle(w, h, 31.7, 33, 31.5, 40);
+    RenderObject dots(w, h);
+    for (int i = 0; i < 40; i++)
+        dots.set((i * 37) % w, (i * 13) % h, 1 + i % 5, (i % 4 == 0) ? -1 : 20 + i);
+    circle.merge(&dots);
+    std::vector<double> x, y, rndt;
+    for (int i = 0; i < 400; i++)
+    {
+        x.push_back(75 + 70 * std::cos(i * 0.05));
+        y.push_back(35 + 34 * std::sin(i * 0.07));
+        rndt.push_back(60 + 30 * std::sin(i * 0.05));
+    }
+    RenderObject path = RenderObject::Multiline(w, h, x, y, rndt);
+
+    for (int threads : {2, 3, 8})
+    {
+        Renderer serial(w, h), tiled(w, h);
+        tiled.setThreads(threads);
+        for (int frame = 0; frame < 3; frame++)
+        {
+            RenderObject line = RenderObject::Line(w, h, 0, frame * 20.3, w, h - frame * 20.3, 10, 90);
+            for (Renderer *r : {&serial, &tiled})
+            {
+                r->addObjectToBuffer(&planet);
+                r->addObjectToBuffer(&circle);
+                r->addObjectToBuffer(&path);
+                r->addObjectToBuffer(&line);
+            }
+            assert(serial.composeFrame() == tiled.composeFrame());
+        }
+    }
+    std::cout << "  tiled rendering passed" << std::endl;
+}
+
+const char *FRAME_TEST_FILE = "testframes.bin";
+
+void testHeadlessFrames()
+{
+    // frames drawn without a terminal hold the same pixels the terminal shows, and survive a round trip through a file
+    const int w = 40, h = 25;
+    RenderObject circle = RenderObject::Circle(w, h, 10, 12, 8, 5);
+    Renderer renderer(w, h), terminal(w, h);
+    FramebufferTarget memory(3);
+    std::remove(FRAME_TEST_FILE);
+    {
+        FrameFileWriter writer(FRAME_TEST_FILE, FrameFileFormat::Packed, 100); // a buffer smaller than a frame
+        for (int i = 0; i < 5; i++)
+        {
+            RenderObject line = RenderObject::Line(w, h, 0, i * 5, w, h - i * 5, 0, 10);
+            renderer.addObjectToBuffer(&line);
+            renderer.addObjectToBuffer(&circle);
+            const Framebuffer &frame = renderer.drawFrame();
+            memory.present(frame);
+            writer.present(frame);
+
+            terminal.addObjectToBuffer(&line);
+            terminal.addObjectToBuffer(&circle);
+            VirtualTerminal screen(2 * w, h);
+            screen.apply(terminal.composeFrame(false));
+            for (int j = 0; j < h; j++)
+                for (int k = 0; k < w; k++)
+                    assert(screen.screen[j][2 * k] == PIXEL_GLYPHS[frame.at(k, j)]);
+        }
+        assert(writer.count() == 5);
+    }
+    assert(memory.count() == 5);
+    std::vector<Framebuffer> frames = readPackedFrames(FRAME_TEST_FILE);
+    assert(frames.size() == 5);
+    for (int i = 0; i < 3; i++)
+        assert(frames[4 - i].pixels == memory.frame(i).pixels and frames[4 - i].width == w and frames[4 - i].height == h);
+    assert(frames[0].pixels != frames[4].pixels);
+
+    // render(target) is drawFrame() handed to the target
+    FramebufferTarget last;
+    renderer.addObjectToBuffer(&circle);
+    renderer.render(last);
+    assert(last.count() == 1 and last.frame().at(10, 12 - 8) != 0 and last.frame().at(0, 0) == 0);
+
+    // PGM frames are concatenated P5 images
+    {
+        FrameFileWriter writer(FRAME_TEST_FILE, FrameFileFormat::PGM);
+        writer.present(last.frame());
+        writer.present(last.frame());
+    }
+    std::ifstream in(FRAME_TEST_FILE, std::ios::binary);
+    const std::string header = "P5\n40 25\n255\n";
+    std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    assert(bytes.size() == 2 * (header.size() + w * h));
+    assert(bytes.compare(0, header.size(), header) == 0);
+    assert(bytes.compare(header.size() + w * h, header.size(), header) == 0);
+    assert((unsigned char)bytes[header.size() + (12 - 8) * w + 10] == PIXEL_GRAY[last.frame().at(10, 4)]);
+    in.close();
+    std::remove(FRAME_TEST_FILE);
+    std::cout << "  headless frames passed" << std::endl;
+}
+
+void runRendererOutputTests()
+{
+    testRendererCompatibility();
+    testSharedDepthBuffer();
+    testLineCoverage();
+    testTiledRendering();
+    testDifferentialOutput();
+    testHeadlessFrames();
+}
+
 void runRendererTests()
 {
     testRendererCompatibility();
@@ -40,8 +40,34 @@ void testCircularMotion()
     std::cout << "  x=cos(2pi t), y=sin(2pi t) passed" << std::endl;
 }
 
+void testRK4HeapTraffic()
+{
+    // the temporaries of every step come from the arena: a solve takes the same few heap buffers however long it is
+    std::function<void(const Matrix<double> &, Matrix<double> &)> der = [](const Matrix<double> &m, Matrix<double> &retm)
+    {
+        retm(0, 0) = -m(0, 1);
+        retm(0, 1) = m(0, 0);
+    };
+    std::function<bool(Matrix<double>)> never = [](Matrix<double>)
+    { return false; };
+    Matrix<double> init(1, 2);
+    init(0, 0) = 1.0;
+    RK4<double> solver(0.001);
+    long long counts[2];
+    for (int k = 0; k < 2; k++)
+    {
+        const long long before = matrixHeapAllocations();
+        RK4Solution<double> sol = solver.solve(init, der, k == 0 ? 100 : 10000, never);
+        counts[k] = matrixHeapAllocations() - before;
+        assert(sol.steps == (k == 0 ? 100 : 10000));
+    }
+    assert(counts[0] == counts[1] and counts[0] <= 8);
+    std::cout << "  RK4 heap traffic passed" << std::endl;
+}
+
 void runRK4Tests()
 {
     testRK4onxist();
     testCircularMotion();
+    testRK4HeapTraffic();
 }
\ No newline at end of file
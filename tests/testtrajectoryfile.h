@@ -0,0 +1,99 @@
+#pragma once
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <vector>
+#include "trajectoryfile.h"
+
+const char *TRAJECTORY_TEST_FILE = "testtrajectory.bin";
+
+void testTrajectoryRoundTrip()
+{
+    // every value comes back bit for bit, smooth or not
+    const int n = 2500, dims = 3;
+    std::vector<double> times, states;
+    std::remove(TRAJECTORY_TEST_FILE);
+    {
+        TrajectoryWriter writer(TRAJECTORY_TEST_FILE, dims, 1000);
+        for (int k = 0; k < n; k++)
+        {
+            const double t = k * 0.01;
+            const double state[dims] = {6.4e6 * std::cos(t * 1e-3), (k % 97 == 0) ? -0.0 : std::sin(k * 1.7) * 1e-300,
+                                        (k == 1234) ? std::numeric_limits<double>::infinity() : -3.5 * k};
+            writer.append(t, state);
+            times.push_back(t);
+            states.insert(states.end(), state, state + dims);
+        }
+        assert(writer.states() == n);
+    }
+    TrajectoryReader reader(TRAJECTORY_TEST_FILE);
+    assert(reader.dimensions() == dims and reader.states() == n and reader.chunks() == 3);
+    assert(reader.startTime() == 0 and reader.endTime() == times.back());
+    std::vector<double> readTimes, readStates;
+    for (int c = 0; c < reader.chunks(); c++)
+        reader.readChunk(c, readTimes, readStates);
+    assert(readTimes.size() == times.size() and readStates.size() == states.size());
+    for (size_t k = 0; k < times.size(); k++)
+        assert(doubleBits(readTimes[k]) == doubleBits(times[k]));
+    for (size_t k = 0; k < states.size(); k++)
+        assert(doubleBits(readStates[k]) == doubleBits(states[k]));
+
+    // seeks go to the right chunk and sample
+    assert(reader.findChunk(-1) == 0 and reader.findChunk(9.99) == 0 and reader.findChunk(10) == 1 and reader.findChunk(1e9) == 2);
+    double at;
+    std::vector<double> state = reader.stateAt(12.345, &at);
+    assert(at == times[1234] and std::isinf(state[2]));
+    reader.read(9.5, 10.5, readTimes, readStates);
+    assert(readTimes.size() == 101 and readTimes.front() == times[950] and readTimes.back() == times[1050]);
+    assert(readStates[dims * 50] == states[dims * 1000]);
+    std::remove(TRAJECTORY_TEST_FILE);
+    std::cout << "  trajectory round trip passed" << std::endl;
+}
+
+void testRecordTrajectory()
+{
+    // a recorded flight ends where getFinalPosition lands, and compresses well below raw doubles
+    const Vector3<double> pos = Vector3<double>::fromSpherical(Physics::EARTH_RADIUS, 0, Math::pi / 2 - 0.5);
+    const Vector3<double> spin = spinningv(0.5, 0.0);
+    const Vector3<double> v = 3000 * (localToInertial(0.5, 0.0, Vector3<double>(0.6, 0, 0.8)) - spin) + spin;
+    for (int abm : {0, 1})
+    {
+        std::remove(TRAJECTORY_TEST_FILE);
+        RK4Solution<double> recorded = abm ? recordTrajectory<ABM>(TRAJECTORY_TEST_FILE, pos, v, 1e-2) : recordTrajectory<RK4>(TRAJECTORY_TEST_FILE, pos, v, 1e-2);
+        RK4Solution<double> plain = abm ? getFinalPosition<ABM>(pos, v, 1e-2) : getFinalPosition<RK4>(pos, v, 1e-2);
+        assert(recorded.status == SolutionStatus::EndCondition and recorded.time == plain.time);
+
+        TrajectoryReader reader(TRAJECTORY_TEST_FILE);
+        assert(reader.dimensions() == 6 and std::abs(reader.endTime() - plain.time) < 1e-6);
+        double at;
+        std::vector<double> last = reader.stateAt(reader.endTime(), &at);
+        for (int i = 0; i < 6; i++)
+            assert(last[i] == plain.solutions(0, i));
+        std::vector<double> first = reader.stateAt(0);
+        assert(first[0] == pos[0] and first[5] == v[2]);
+
+        // one state per accepted step at the solver's own times, ending with the impact at the solution's time
+        std::vector<double> times, states;
+        for (int c = 0; c < reader.chunks(); c++)
+            reader.readChunk(c, times, states);
+        assert((long long)times.size() == reader.states() and times.front() == 0);
+        for (size_t i = 1; i < times.size(); i++)
+            assert(times[i] > times[i - 1]);
+        assert(times.back() == recorded.time);
+
+        std::ifstream file(TRAJECTORY_TEST_FILE, std::ios::binary | std::ios::ate);
+        assert((double)file.tellg() < 0.5 * reader.states() * 7 * sizeof(double));
+    }
+    std::remove(TRAJECTORY_TEST_FILE);
+    std::cout << "  recorded trajectory passed" << std::endl;
+}
+
+void runTrajectoryFileTests()
+{
+    testTrajectoryRoundTrip();
+    testRecordTrajectory();
+}
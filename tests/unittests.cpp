@@ -3,6 +3,19 @@
 #include "testvector3.h"
 #include "testrenderer.h"
 #include "testrk4.h"
+#include "testabm.h"
+#include "testoptimization.h"
+#include "testphysics.h"
+#include "testfootprint.h"
+#include "testmontecarlo.h"
+#include "testliveview.h"
+#include "testtrajectoryfile.h"
+#include "testdenseoutput.h"
+#include "testobservers.h"
+#include "testgravityfield.h"
+#include "testforcemodel.h"
+#include "testasyncsolve.h"
+#include "testgeodesy.h"
 
 int main()
 {
@@ -10,9 +23,37 @@ int main()
     runVector3Tests();
     std::cout << "Running Matrix tests" << std::endl;
     runMatrixTests();
+    std::cout << "Running Renderer output tests" << std::endl;
+    runRendererOutputTests();
     /*std::cout << "Running Renderer tests" << std::endl;
     runRendererTests();*/
     std::cout << "Running RK4 tests" << std::endl;
     runRK4Tests();
+    std::cout << "Running ABM tests" << std::endl;
+    runABMTests();
+    std::cout << "Running optimization tests" << std::endl;
+    runOptimizationTests();
+    std::cout << "Running physics tests" << std::endl;
+    runPhysicsTests();
+    std::cout << "Running footprint tests" << std::endl;
+    runFootprintTests();
+    std::cout << "Running Monte Carlo tests" << std::endl;
+    runMonteCarloTests();
+    std::cout << "Running live view tests" << std::endl;
+    runLiveViewTests();
+    std::cout << "Running trajectory file tests" << std::endl;
+    runTrajectoryFileTests();
+    std::cout << "Running dense output tests" << std::endl;
+    runDenseOutputTests();
+    std::cout << "Running observer tests" << std::endl;
+    runObserverTests();
+    std::cout << "Running gravity field tests" << std::endl;
+    runGravityFieldTests();
+    std::cout << "Running force model tests" << std::endl;
+    runForceModelTests();
+    std::cout << "Running async solve tests" << std::endl;
+    runAsyncSolveTests();
+    std::cout << "Running geodesy tests" << std::endl;
+    runGeodesyTests();
     return 0;
 }